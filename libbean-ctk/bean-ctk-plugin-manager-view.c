@@ -135,16 +135,14 @@ get_dependant_plugins (BeanCtkPluginManagerView *view,
                        BeanPluginInfo           *info)
 {
   BeanCtkPluginManagerViewPrivate *priv = GET_PRIV (view);
-  const gchar *module_name;
-  const GList *plugins;
+  GList *dependants, *l;
   GList *dep_plugins = NULL;
 
-  module_name = bean_plugin_info_get_module_name (info);
-  plugins = bean_engine_get_plugin_list (priv->engine);
+  dependants = bean_engine_get_plugin_dependants (priv->engine, info);
 
-  for (; plugins != NULL; plugins = plugins->next)
+  for (l = dependants; l != NULL; l = l->next)
     {
-      BeanPluginInfo *plugin = (BeanPluginInfo *) plugins->data;
+      BeanPluginInfo *plugin = (BeanPluginInfo *) l->data;
 
       if (bean_plugin_info_is_hidden (plugin) ||
           !bean_plugin_info_is_loaded (plugin))
@@ -154,10 +152,11 @@ get_dependant_plugins (BeanCtkPluginManagerView *view,
       if (!priv->show_builtin && bean_plugin_info_is_builtin (plugin))
         continue;
 
-      if (bean_plugin_info_has_dependency (plugin, module_name))
-        dep_plugins = g_list_prepend (dep_plugins, plugin);
+      dep_plugins = g_list_prepend (dep_plugins, plugin);
     }
 
+  g_list_free (dependants);
+
   return dep_plugins;
 }
 
@@ -38,6 +38,7 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC (BeanEngine, g_object_unref)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (BeanExtension, g_object_unref)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (BeanExtensionBase, g_object_unref)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (BeanExtensionSet, g_object_unref)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (BeanExtensionFactory, bean_extension_factory_unref)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (BeanObjectModule, g_object_unref)
 
 #endif /* __GI_SCANNER__ */
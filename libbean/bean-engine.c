@@ -23,20 +23,45 @@
 
 #include "config.h"
 
+#include <errno.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_OPENAT
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#endif
+
+#include <glib/gstdio.h>
 
 #include "bean-i18n-priv.h"
 #include "bean-engine.h"
 #include "bean-engine-priv.h"
 #include "bean-plugin-info-priv.h"
+#include "bean-plugin-cache.h"
+#include "bean-provider-index.h"
+#include "bean-load-profile.h"
+#include "bean-plugin-graph.h"
+#include "bean-plugin-list.h"
+#include "bean-string-pool.h"
 #include "bean-plugin-loader.h"
 #include "bean-plugin-loader-c.h"
-#include "bean-object-module.h"
-#include "bean-extension.h"
+#include "bean-object-module-priv.h"
+#include "bean-extension-priv.h"
 #include "bean-dirs.h"
 #include "bean-debug.h"
 #include "bean-utils.h"
 
+#ifndef S_ISDIR
+#define S_ISDIR(m) (((m) & S_IFMT) == S_IFDIR)
+#endif
+
 /**
  * SECTION:bean-engine
  * @short_description: Engine at the heart of the Bean plugin system.
@@ -64,6 +89,7 @@
 enum {
   LOAD_PLUGIN,
   UNLOAD_PLUGIN,
+  LOADED_PLUGINS_CHANGED,
   LAST_SIGNAL
 };
 
@@ -73,6 +99,14 @@ enum {
   PROP_PLUGIN_LIST,
   PROP_LOADED_PLUGINS,
   PROP_NONGLOBAL_LOADERS,
+  PROP_CACHE_DIR,
+  PROP_PARALLEL_SCAN,
+  PROP_PARALLEL_LOAD,
+  PROP_LAZY_LOAD,
+  PROP_PREFETCH_MODULES,
+  PROP_LOAD_PROFILE,
+  PROP_PREINIT_LOADERS,
+  PROP_MONITOR_SEARCH_PATHS,
   N_PROPERTIES
 };
 
@@ -85,28 +119,129 @@ typedef struct _GlobalLoaderInfo {
 
   guint enabled : 1;
   guint failed : 1;
+
+  /* Set while a thread creates the loader without holding the lock */
+  guint initializing : 1;
 } GlobalLoaderInfo;
 
 typedef struct _LoaderInfo {
   BeanPluginLoader *loader;
 
+  /* Joined when the engine is disposed */
+  GThread *init_thread;
+
   guint enabled : 1;
   guint failed : 1;
 } LoaderInfo;
 
+typedef struct _PrefetchData {
+  /* Of BeanPluginInfo, in the order they are prefetched */
+  GPtrArray *infos;
+
+  /* Set to stop before the next plugin */
+  gint cancelled;
+} PrefetchData;
+
 typedef struct _SearchPath {
   gchar *module_dir;
   gchar *data_dir;
+
+  /* Owned by the engine, for the plugins found in this path */
+  BeanStringPool *strings;
+
+  /* Filename -> PluginFile, only used by file search paths */
+  GHashTable *files;
+
+  /* Of the PluginFiles, in the order they were found */
+  GQueue file_order;
+
+  /* Of GFileMonitor, the first one is for module_dir */
+  GPtrArray *monitors;
+
+  guint needs_update : 1;
+  guint needs_monitors : 1;
 } SearchPath;
 
+typedef struct _PluginFile {
+  gint64 mtime;
+  guint64 size;
+
+  /* %NULL if the file is not a valid plugin */
+  BeanPluginInfo *info;
+
+  /* In SearchPath.file_order */
+  GList link;
+} PluginFile;
+
+typedef struct _ScanItem {
+  gchar *filename;
+  gchar *module_dir;
+
+  GStatBuf buf;
+  gboolean have_stat;
+
+  BeanPluginInfo *info;
+  GError *error;
+} ScanItem;
+
 struct _BeanEnginePrivate {
   LoaderInfo loaders[BEAN_UTILS_N_LOADERS];
 
   GQueue search_paths;
-  GQueue plugin_list;
+  BeanPluginGraph *plugin_graph;
+
+  /* Of the plugins in the graph, as returned by
+   * bean_engine_get_plugin_list(), see bean-plugin-list.c
+   */
+  BeanPluginList *plugin_list;
+
+  /* Of the plugin info strings, see bean-string-pool.c */
+  BeanStringPool *strings;
+
+  /* Of the plugins loaded by their loader in a worker thread,
+   * see bean_engine_load_plugins_async()
+   */
+  GMutex prepare_lock;
+  GCond prepare_cond;
+  GHashTable *preparing_plugins;
+  GHashTable *prepared_plugins;
+
+  /* Of the plugins loaded or preloaded in a worker thread to how long
+   * that took, until they are recorded in the load profile
+   */
+  GHashTable *load_timings;
+
+  /* Of the plugins loaded or unloaded since the changes were
+   * last emitted, to whether they were loaded before
+   */
+  GHashTable *changed_plugins;
+  GPtrArray *changed_order;
+  guint batch_depth;
+
+  gchar *cache_dir;
+  GSource *update_source;
+
+  /* Created when first used, if there is a cache directory */
+  BeanProviderIndex *providers;
+
+  /* Created when first used, if there is a load profile file */
+  gchar *load_profile;
+  BeanLoadProfile *profile;
+
+  /* Reading the modules of the plugins about to be loaded,
+   * see prefetch_plugins()
+   */
+  GThread *prefetch_thread;
+  PrefetchData *prefetch_data;
 
   guint in_dispose : 1;
   guint use_nonglobal_loaders : 1;
+  guint parallel_scan : 1;
+  guint parallel_load : 1;
+  guint lazy_load : 1;
+  guint prefetch_modules : 1;
+  guint preinit_loaders : 1;
+  guint monitor_search_paths : 1;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (BeanEngine, bean_engine, G_TYPE_OBJECT)
@@ -118,52 +253,34 @@ static gboolean shutdown = FALSE;
 static BeanEngine *default_engine = NULL;
 
 static GMutex loaders_lock;
+static GCond loaders_cond;
 static GlobalLoaderInfo loaders[BEAN_UTILS_N_LOADERS];
 
 static void bean_engine_load_plugin_real   (BeanEngine     *engine,
                                             BeanPluginInfo *info);
 static void bean_engine_unload_plugin_real (BeanEngine     *engine,
                                             BeanPluginInfo *info);
+static gboolean take_load_timing           (BeanEngine     *engine,
+                                            BeanPluginInfo *info,
+                                            BeanLoadTiming *timing);
+static void     stop_prefetch              (BeanEngine     *engine);
 
-static void
-plugin_info_add_sorted (GQueue         *plugin_list,
-                        BeanPluginInfo *info)
+/* Takes ownership of info */
+static gboolean
+add_plugin_info (BeanEngine     *engine,
+                 BeanPluginInfo *info)
 {
-  guint i;
-  GList *furthest_dep = NULL;
-  const gchar **dependencies;
-
-  dependencies = bean_plugin_info_get_dependencies (info);
-
-  for (i = 0; dependencies[i] != NULL; ++i)
-    {
-      GList *pos = furthest_dep != NULL ? furthest_dep : plugin_list->head;
+  BeanEnginePrivate *priv = GET_PRIV (engine);
 
-      for (; pos != NULL; pos = pos->next)
-        {
-          if (strcmp (dependencies[i],
-                      bean_plugin_info_get_module_name (pos->data)) == 0)
-            {
-              furthest_dep = pos;
-              break;
-            }
-        }
-    }
+  if (!bean_plugin_graph_add (priv->plugin_graph, info))
+    return FALSE;
 
-  /* GLib changed only accepts NULL for
-   * g_queue_insert_after() at version 2.44
-   */
-  if (furthest_dep == NULL)
-    {
-      g_queue_push_head (plugin_list, info);
-      return;
-    }
+  bean_plugin_list_add (priv->plugin_list, info);
 
-  g_debug ("Adding '%s' after '%s' due to dependencies",
-           bean_plugin_info_get_module_name (info),
-           bean_plugin_info_get_module_name (furthest_dep->data));
+  g_object_notify_by_pspec (G_OBJECT (engine),
+                            properties[PROP_PLUGIN_LIST]);
 
-  g_queue_insert_after (plugin_list, furthest_dep, info);
+  return TRUE;
 }
 
 static gboolean
@@ -174,42 +291,232 @@ load_plugin_info (BeanEngine  *engine,
 {
   BeanEnginePrivate *priv = GET_PRIV (engine);
   BeanPluginInfo *info;
-  const gchar *module_name;
+  GError *error = NULL;
 
-  info = _bean_plugin_info_new (filename,
+  info = _bean_plugin_info_new (priv->strings,
+                                filename,
                                 module_dir,
-                                data_dir);
+                                data_dir,
+                                &error);
 
   if (info == NULL)
     {
+      g_warning ("%s", error->message);
       g_warning ("Error loading '%s'", filename);
+      g_error_free (error);
       return FALSE;
     }
 
-  module_name = bean_plugin_info_get_module_name (info);
-  if (bean_engine_get_plugin_info (engine, module_name) != NULL)
+  return add_plugin_info (engine, info);
+}
+
+static void
+plugin_file_free (PluginFile *file)
+{
+  if (file->info != NULL)
+    _bean_plugin_info_unref (file->info);
+
+  g_slice_free (PluginFile, file);
+}
+
+/* Remembers what was found so that later rescans only apply the changes,
+ * a modified file keeps its position in the order the files were found
+ */
+static void
+search_path_add_file (SearchPath     *sp,
+                      const gchar    *filename,
+                      gint64          mtime,
+                      guint64         size,
+                      BeanPluginInfo *info)
+{
+  PluginFile *file;
+
+  file = g_hash_table_lookup (sp->files, filename);
+
+  if (file == NULL)
     {
-      _bean_plugin_info_unref (info);
-      return FALSE;
+      file = g_slice_new0 (PluginFile);
+      file->link.data = file;
+
+      g_queue_push_tail_link (&sp->file_order, &file->link);
+      g_hash_table_insert (sp->files, g_strdup (filename), file);
+    }
+  else if (file->info != NULL)
+    {
+      _bean_plugin_info_unref (file->info);
     }
 
-  plugin_info_add_sorted (&priv->plugin_list, info);
-  g_object_notify_by_pspec (G_OBJECT (engine),
-                            properties[PROP_PLUGIN_LIST]);
+  file->mtime = mtime;
+  file->size = size;
+  file->info = info != NULL ? _bean_plugin_info_ref (info) : NULL;
+}
 
-  return TRUE;
+static void
+search_path_remove_file (SearchPath  *sp,
+                         const gchar *filename)
+{
+  PluginFile *file;
+
+  file = g_hash_table_lookup (sp->files, filename);
+  if (file == NULL)
+    return;
+
+  g_queue_unlink (&sp->file_order, &file->link);
+  g_hash_table_remove (sp->files, filename);
 }
 
 static gboolean
-load_file_dir_real (BeanEngine  *engine,
-                    const gchar *module_dir,
-                    const gchar *data_dir,
-                    guint        recursions)
+search_path_is_resource (SearchPath *sp)
+{
+  return g_str_has_prefix (sp->module_dir, "resource://");
+}
+
+static void
+scan_item_clear (ScanItem *item)
+{
+  g_free (item->filename);
+  g_free (item->module_dir);
+
+  if (item->info != NULL)
+    _bean_plugin_info_unref (item->info);
+
+  g_clear_error (&item->error);
+}
+
+static void
+scan_item_add (GArray      *items,
+               const gchar *module_dir,
+               const gchar *name,
+               GStatBuf    *buf,
+               gboolean     have_stat)
+{
+  ScanItem item = { NULL, };
+
+  item.filename = g_build_filename (module_dir, name, NULL);
+  item.module_dir = g_strdup (module_dir);
+  item.have_stat = have_stat;
+
+  if (have_stat)
+    item.buf = *buf;
+
+  g_array_append_val (items, item);
+}
+
+#ifdef HAVE_OPENAT
+
+/* Entries are looked up relative to the directory and most of
+ * them are skipped by their name and type, so only plugin files
+ * and directories need a stat() and a path to be built
+ */
+static void
+scan_dir_fd (GArray          *items,
+             BeanPluginCache *cache,
+             gint             fd,
+             const gchar     *module_dir,
+             guint            recursions)
+{
+  DIR *d;
+  struct dirent *dirent;
+
+  d = fdopendir (fd);
+
+  if (d == NULL)
+    {
+      g_debug ("Error opening directory '%s': %s",
+               module_dir, g_strerror (errno));
+      close (fd);
+      return;
+    }
+
+  while ((dirent = readdir (d)) != NULL)
+    {
+      const gchar *name = dirent->d_name;
+      gboolean is_plugin;
+      GStatBuf buf;
+      gboolean have_stat;
+
+      if (name[0] == '.' &&
+          (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+        continue;
+
+      is_plugin = g_str_has_suffix (name, ".plugin");
+
+      if (!is_plugin && recursions == 0)
+        continue;
+
+#ifdef HAVE_STRUCT_DIRENT_D_TYPE
+      /* Symlinks and unknown types need a stat() to be resolved */
+      if (!is_plugin && dirent->d_type != DT_DIR &&
+          dirent->d_type != DT_LNK && dirent->d_type != DT_UNKNOWN)
+        continue;
+#endif
+
+      have_stat = fstatat (dirfd (d), name, &buf, 0) == 0;
+
+      if (have_stat && S_ISDIR (buf.st_mode))
+        {
+          gchar *path;
+          gint child_fd;
+
+          if (recursions == 0)
+            continue;
+
+          path = g_build_filename (module_dir, name, NULL);
+
+          if (cache != NULL)
+            bean_plugin_cache_add_dir (cache, path, &buf);
+
+          g_debug ("Loading %s/*.plugin...", path);
+
+          child_fd = openat (dirfd (d), name,
+                             O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+          if (child_fd != -1)
+            scan_dir_fd (items, cache, child_fd, path, recursions - 1);
+          else
+            g_debug ("Error opening directory '%s': %s",
+                     path, g_strerror (errno));
+
+          g_free (path);
+        }
+      else if (is_plugin)
+        {
+          scan_item_add (items, module_dir, name, &buf, have_stat);
+        }
+    }
+
+  /* Also closes fd */
+  closedir (d);
+}
+
+#endif /* HAVE_OPENAT */
+
+/* Only collects the plugin files, they are parsed by parse_scan_items() */
+static void
+scan_file_dir (GArray          *items,
+               BeanPluginCache *cache,
+               const gchar     *module_dir,
+               guint            recursions)
 {
+#ifdef HAVE_OPENAT
+  gint fd;
+
+  g_debug ("Loading %s/*.plugin...", module_dir);
+
+  fd = open (module_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  if (fd == -1)
+    {
+      g_debug ("Error opening directory '%s': %s",
+               module_dir, g_strerror (errno));
+      return;
+    }
+
+  scan_dir_fd (items, cache, fd, module_dir, recursions);
+#else
   GDir *d;
   const gchar *dirent;
   GError *error = NULL;
-  gboolean found = FALSE;
 
   g_debug ("Loading %s/*.plugin...", module_dir);
 
@@ -219,31 +526,153 @@ load_file_dir_real (BeanEngine  *engine,
     {
       g_debug ("%s", error->message);
       g_error_free (error);
-      return FALSE;
+      return;
     }
 
   while ((dirent = g_dir_read_name (d)))
     {
-      gchar *filename = g_build_filename (module_dir, dirent, NULL);
+      gboolean is_plugin;
+      gchar *filename;
+      GStatBuf buf;
+      gboolean have_stat;
+
+      is_plugin = g_str_has_suffix (dirent, ".plugin");
 
-      if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+      /* Only plugin files and directories matter */
+      if (!is_plugin && recursions == 0)
+        continue;
+
+      filename = g_build_filename (module_dir, dirent, NULL);
+      have_stat = g_stat (filename, &buf) == 0;
+
+      if (have_stat && S_ISDIR (buf.st_mode))
         {
           if (recursions > 0)
             {
-              found |= load_file_dir_real (engine, filename,
-                                           data_dir, recursions - 1);
+              if (cache != NULL)
+                bean_plugin_cache_add_dir (cache, filename, &buf);
+
+              scan_file_dir (items, cache, filename, recursions - 1);
             }
         }
-      else if (g_str_has_suffix (dirent, ".plugin"))
+      else if (is_plugin)
         {
-          found |= load_plugin_info (engine, filename,
-                                     module_dir, data_dir);
+          scan_item_add (items, module_dir, dirent, &buf, have_stat);
         }
 
       g_free (filename);
     }
 
   g_dir_close (d);
+#endif
+}
+
+typedef struct _ParseData {
+  BeanStringPool *strings;
+  const gchar *data_dir;
+} ParseData;
+
+static void
+parse_scan_item (ScanItem  *item,
+                 ParseData *data)
+{
+  item->info = _bean_plugin_info_new (data->strings,
+                                      item->filename,
+                                      item->module_dir,
+                                      data->data_dir,
+                                      &item->error);
+}
+
+static void
+parse_scan_items (GArray         *items,
+                  BeanStringPool *strings,
+                  const gchar    *data_dir,
+                  gboolean        parallel)
+{
+  ParseData data = { strings, data_dir };
+  GThreadPool *pool = NULL;
+  guint i;
+
+  if (parallel && items->len > 1)
+    {
+      pool = g_thread_pool_new ((GFunc) parse_scan_item, &data,
+                                MIN (g_get_num_processors (), items->len),
+                                FALSE, NULL);
+    }
+
+  for (i = 0; i < items->len; ++i)
+    {
+      ScanItem *item = &g_array_index (items, ScanItem, i);
+
+      /* Parse it ourselves if a thread could not be spawned */
+      if (pool == NULL || !g_thread_pool_push (pool, item, NULL))
+        parse_scan_item (item, &data);
+    }
+
+  /* Waits for all of the items to be parsed */
+  if (pool != NULL)
+    g_thread_pool_free (pool, FALSE, TRUE);
+}
+
+/* Merged in the order the files were found so that
+ * the result does not depend on how they were parsed
+ */
+static gboolean
+merge_scan_items (BeanEngine      *engine,
+                  SearchPath      *sp,
+                  GArray          *items,
+                  BeanPluginCache *cache)
+{
+  guint i;
+  gboolean found = FALSE;
+
+  for (i = 0; i < items->len; ++i)
+    {
+      ScanItem *item = &g_array_index (items, ScanItem, i);
+
+      if (cache != NULL)
+        {
+          bean_plugin_cache_add_file (cache, item->filename, item->module_dir,
+                                      item->have_stat ? &item->buf : NULL,
+                                      item->info);
+        }
+
+      search_path_add_file (sp, item->filename,
+                            item->have_stat ?
+                              bean_plugin_cache_get_mtime (&item->buf) : -1,
+                            item->have_stat ? item->buf.st_size : 0,
+                            item->info);
+
+      if (item->info == NULL)
+        {
+          g_warning ("%s", item->error->message);
+          g_warning ("Error loading '%s'", item->filename);
+          continue;
+        }
+
+      found |= add_plugin_info (engine, g_steal_pointer (&item->info));
+    }
+
+  return found;
+}
+
+static gboolean
+load_file_dir_real (BeanEngine      *engine,
+                    BeanPluginCache *cache,
+                    SearchPath      *sp)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GArray *items;
+  gboolean found;
+
+  items = g_array_new (FALSE, FALSE, sizeof (ScanItem));
+  g_array_set_clear_func (items, (GDestroyNotify) scan_item_clear);
+
+  scan_file_dir (items, cache, sp->module_dir, 1);
+  parse_scan_items (items, sp->strings, sp->data_dir, priv->parallel_scan);
+  found = merge_scan_items (engine, sp, items, cache);
+
+  g_array_unref (items);
 
   return found;
 }
@@ -307,12 +736,83 @@ load_resource_dir_real (BeanEngine  *engine,
   return found;
 }
 
+static gboolean
+load_cached_file_dir (BeanEngine      *engine,
+                      BeanPluginCache *cache,
+                      SearchPath      *sp)
+{
+  const BeanPluginCacheEntry *entries;
+  guint i, n_entries;
+  gboolean found = FALSE;
+
+  entries = bean_plugin_cache_get_entries (cache, &n_entries);
+
+  for (i = 0; i < n_entries; ++i)
+    {
+      const BeanPluginCacheEntry *entry = &entries[i];
+
+      search_path_add_file (sp, entry->filename,
+                            entry->mtime, entry->size, entry->info);
+
+      /* Reparse invalid plugin files so that they are still warned about */
+      if (entry->info == NULL)
+        {
+          found |= load_plugin_info (engine, entry->filename,
+                                     entry->module_dir, sp->data_dir);
+        }
+      else
+        {
+          found |= add_plugin_info (engine,
+                                    _bean_plugin_info_ref (entry->info));
+        }
+    }
+
+  return found;
+}
+
+static gboolean
+load_file_dir (BeanEngine *engine,
+               SearchPath *sp)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  BeanPluginCache *cache;
+  GStatBuf buf;
+  gboolean found;
+
+  if (priv->cache_dir == NULL)
+    return load_file_dir_real (engine, NULL, sp);
+
+  cache = bean_plugin_cache_load (priv->strings, priv->cache_dir,
+                                  sp->module_dir, sp->data_dir);
+
+  if (cache != NULL)
+    {
+      found = load_cached_file_dir (engine, cache, sp);
+      bean_plugin_cache_free (cache);
+      return found;
+    }
+
+  /* Don't cache search paths that do not exist */
+  if (g_stat (sp->module_dir, &buf) != 0 || !S_ISDIR (buf.st_mode))
+    return load_file_dir_real (engine, NULL, sp);
+
+  cache = bean_plugin_cache_new (sp->module_dir, sp->data_dir);
+  bean_plugin_cache_add_dir (cache, sp->module_dir, &buf);
+
+  found = load_file_dir_real (engine, cache, sp);
+
+  bean_plugin_cache_save (cache, priv->cache_dir);
+  bean_plugin_cache_free (cache);
+
+  return found;
+}
+
 static gboolean
 load_dir_real (BeanEngine *engine,
                SearchPath *sp)
 {
-  if (!g_str_has_prefix (sp->module_dir, "resource://"))
-    return load_file_dir_real (engine, sp->module_dir, sp->data_dir, 1);
+  if (!search_path_is_resource (sp))
+    return load_file_dir (engine, sp);
 
   return load_resource_dir_real (engine, sp->module_dir, sp->data_dir, 1);
 }
@@ -329,7 +829,8 @@ plugin_list_changed (BeanEngine *engine)
 
   msg = g_string_new ("Plugins: ");
 
-  for (pos = priv->plugin_list.head; pos != NULL; pos = pos->next)
+  pos = bean_plugin_graph_get_sorted (priv->plugin_graph)->head;
+  for (; pos != NULL; pos = pos->next)
     {
       if (pos->prev != NULL)
         g_string_append (msg, ", ");
@@ -341,1301 +842,4205 @@ plugin_list_changed (BeanEngine *engine)
   g_string_free (msg, TRUE);
 }
 
-/**
- * bean_engine_rescan_plugins:
- * @engine: A #BeanEngine.
- *
- * Rescan all the registered directories to find new or updated plugins.
- *
- * Calling this function will make the newly installed plugin infos
- * be loaded by the engine, so the new plugins can be used without
- * restarting the application.
+/* Only the plugin info that is actually part of the engine is removed,
+ * the loaded plugins are unloaded first and reloaded by the caller
  */
-void
-bean_engine_rescan_plugins (BeanEngine *engine)
+static gboolean
+remove_plugin_file (BeanEngine *engine,
+                    PluginFile *file)
 {
   BeanEnginePrivate *priv = GET_PRIV (engine);
-  GList *item;
-  gboolean found = FALSE;
+  BeanPluginInfo *info = file->info;
 
-  g_return_if_fail (BEAN_IS_ENGINE (engine));
+  if (info == NULL ||
+      bean_plugin_graph_lookup (priv->plugin_graph,
+                                bean_plugin_info_get_module_name (info)) != info)
+    return FALSE;
 
-  if (priv->search_paths.length == 0)
-    {
-      g_debug ("No search paths where provided");
-      return;
-    }
+  if (bean_plugin_info_is_loaded (info))
+    bean_engine_unload_plugin (engine, info);
 
-  g_object_freeze_notify (G_OBJECT (engine));
+  /* The plugin might not provide the same extensions anymore */
+  if (priv->providers != NULL)
+    bean_provider_index_remove (priv->providers, info->filename);
 
-  /* Go and read everything from the provided search paths */
-  for (item = priv->search_paths.head; item != NULL; item = item->next)
-    found |= load_dir_real (engine, (SearchPath *) item->data);
+  bean_plugin_list_remove (priv->plugin_list, info);
+  take_load_timing (engine, info, NULL);
+  bean_plugin_graph_remove (priv->plugin_graph, info);
 
-  if (found)
-    plugin_list_changed (engine);
+  g_object_notify_by_pspec (G_OBJECT (engine),
+                            properties[PROP_PLUGIN_LIST]);
 
-  g_object_thaw_notify (G_OBJECT (engine));
+  return TRUE;
 }
 
-static void
-bean_engine_insert_search_path (BeanEngine  *engine,
-                                gboolean     prepend,
-                                const gchar *module_dir,
-                                const gchar *data_dir)
+/* Plugins with the same module name as a removed
+ * plugin were ignored and might now be used instead.
+ * Like when loading the search paths, the first one found wins.
+ */
+static gboolean
+add_shadowed_plugin_files (BeanEngine *engine)
 {
   BeanEnginePrivate *priv = GET_PRIV (engine);
-  SearchPath *sp;
+  GList *item, *pos;
+  gboolean added = FALSE;
 
-  g_return_if_fail (BEAN_IS_ENGINE (engine));
-  g_return_if_fail (module_dir != NULL);
+  for (item = priv->search_paths.head; item != NULL; item = item->next)
+    {
+      SearchPath *sp = (SearchPath *) item->data;
 
-  sp = g_slice_new (SearchPath);
-  sp->module_dir = g_strdup (module_dir);
-  sp->data_dir = g_strdup (data_dir ? data_dir : module_dir);
+      for (pos = sp->file_order.head; pos != NULL; pos = pos->next)
+        {
+          PluginFile *file = (PluginFile *) pos->data;
 
-  if (prepend)
-    g_queue_push_head (&priv->search_paths, sp);
-  else
-    g_queue_push_tail (&priv->search_paths, sp);
+          if (file->info != NULL)
+            added |= add_plugin_info (engine,
+                                      _bean_plugin_info_ref (file->info));
+        }
+    }
 
-  g_object_freeze_notify (G_OBJECT (engine));
+  return added;
+}
 
-  if (load_dir_real (engine, sp))
-    plugin_list_changed (engine);
+typedef struct _SearchPathUpdate {
+  SearchPath *sp;
 
-  g_object_thaw_notify (G_OBJECT (engine));
-}
+  /* Filename -> PluginFile, as they were when the update was created */
+  GHashTable *known_files;
 
-/**
- * bean_engine_add_search_path:
- * @engine: A #BeanEngine.
- * @module_dir: the plugin module directory.
- * @data_dir: (allow-none): the plugin data directory.
- *
- * This function appends a search path to the list of paths where to
- * look for plugins.
- *
- * A so-called "search path" actually consists of both a
- * module directory (where the shared libraries or language modules
- * lie) and a data directory (where the plugin data is).
- *
- * The plugin will be able to use a correct data dir depending on
- * where it is installed, hence allowing to keep the plugin agnostic
- * when it comes to installation location: the same plugin can be
- * installed either in the system path or in the user's home directory,
- * without taking other special care than using
- * bean_plugin_info_get_data_dir() when looking for its data files.
- *
- * If @data_dir is %NULL, then it is set to the same value as
- * @module_dir.
- */
-void
-bean_engine_add_search_path (BeanEngine  *engine,
-                             const gchar *module_dir,
-                             const gchar *data_dir)
-{
-  bean_engine_insert_search_path (engine, FALSE, module_dir, data_dir);
-}
+  /* Only the items for files that were added or modified */
+  GArray *items;
+  GPtrArray *removed_files;
 
-/**
- * bean_engine_prepend_search_path:
- * @engine: A #BeanEngine.
- * @module_dir: the plugin module directory.
- * @data_dir: (allow-none): the plugin data directory.
- *
- * This function prepends a search path to the list of paths where to
- * look for plugins.
- *
- * See Also: bean_engine_add_search_path()
- *
- * Since: 1.6
+  /* Of the strings of the modified plugins, so that they can be freed
+   * with them rather than with the engine, see bean-string-pool.c
+   */
+  BeanStringPool *strings;
+
+  /* Unless the search paths are monitored, only new plugin files
+   * are added and the known ones are left alone like they used to be
+   */
+  gboolean add_only;
+} SearchPathUpdate;
+
+/* The known files are copied if the update is
+ * scanned while the engine can still be used
  */
-void
-bean_engine_prepend_search_path (BeanEngine  *engine,
-                                 const gchar *module_dir,
-                                 const gchar *data_dir)
+static SearchPathUpdate *
+search_path_update_new (SearchPath *sp,
+                        gboolean    copy_files,
+                        gboolean    add_only)
 {
-  bean_engine_insert_search_path (engine, TRUE, module_dir, data_dir);
-}
+  SearchPathUpdate *update;
 
-static void
-default_engine_weak_notify (gpointer    unused G_GNUC_UNUSED,
-                            BeanEngine *engine)
-{
-  g_warn_if_fail (g_atomic_pointer_compare_and_exchange (&default_engine,
-                                                         engine, NULL));
-}
+  update = g_slice_new0 (SearchPathUpdate);
+  update->sp = sp;
+  update->add_only = add_only;
+  update->items = g_array_new (FALSE, FALSE, sizeof (ScanItem));
+  g_array_set_clear_func (update->items, (GDestroyNotify) scan_item_clear);
+  update->removed_files = g_ptr_array_new_with_free_func (g_free);
 
-static void
-bean_engine_init (BeanEngine *engine)
-{
-  BeanEnginePrivate *priv = GET_PRIV (engine);
+  if (search_path_is_resource (sp))
+    return update;
 
-  /* Don't need to use atomics as bean_engine_shutdown()
-   * is private API and as such is not multithread-safe
-   */
-  if (shutdown)
+  if (!copy_files)
     {
-      g_error ("libbean cannot create a plugin engine "
-               "as it has been shutdown.");
+      update->known_files = g_hash_table_ref (sp->files);
     }
-
-  /* Set the default engine here to make sure that if a
-   * plugin is loaded and calls bean_engine_get_default()
-   * that this engine is returned and not another.
-   *
-   * While bean_engine_get_default() is not thread-safe
-   * we are using atomics here to try and prevent bad
-   * things from happening.
-   */
-  if (g_atomic_pointer_compare_and_exchange (&default_engine, NULL, engine))
+  else
     {
-      g_object_weak_ref (G_OBJECT (engine),
-                         (GWeakNotify) default_engine_weak_notify,
-                         NULL);
-    }
-
-  priv->in_dispose = FALSE;
+      GHashTableIter iter;
+      const gchar *filename;
+      PluginFile *file;
 
-  g_queue_init (&priv->search_paths);
-  g_queue_init (&priv->plugin_list);
-
-  /* The C plugin loader is always enabled */
-  priv->loaders[BEAN_UTILS_C_LOADER_ID].enabled = TRUE;
-}
-
-/**
- * bean_engine_garbage_collect:
- * @engine: A #BeanEngine.
- *
- * This function triggers garbage collection on all the loaders currently
- * owned by the #BeanEngine.  This can be used to force the loaders to destroy
- * managed objects that still hold references to objects that are about to
- * disappear.
- */
-void
-bean_engine_garbage_collect (BeanEngine *engine)
-{
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-  gint i;
+      update->known_files =
+        g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                               (GDestroyNotify) plugin_file_free);
 
-  g_return_if_fail (BEAN_IS_ENGINE (engine));
+      g_hash_table_iter_init (&iter, sp->files);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &filename,
+                                     (gpointer *) &file))
+        {
+          PluginFile *copy = g_slice_new0 (PluginFile);
 
-  for (i = 0; i < G_N_ELEMENTS (loaders); ++i)
-    {
-      LoaderInfo *loader_info = &priv->loaders[i];
+          copy->mtime = file->mtime;
+          copy->size = file->size;
+          copy->info = NULL;
 
-      if (loader_info->loader != NULL)
-        bean_plugin_loader_garbage_collect (loader_info->loader);
+          g_hash_table_insert (update->known_files, g_strdup (filename), copy);
+        }
     }
+
+  return update;
 }
 
 static void
-bean_engine_set_property (GObject      *object,
-                          guint         prop_id,
-                          const GValue *value,
-                          GParamSpec   *pspec)
+search_path_update_free (SearchPathUpdate *update)
 {
-  BeanEngine *engine = BEAN_ENGINE (object);
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-
-  switch (prop_id)
-    {
-    case PROP_LOADED_PLUGINS:
-      bean_engine_set_loaded_plugins (engine,
-                                      (const gchar **) g_value_get_boxed (value));
-      break;
-    case PROP_NONGLOBAL_LOADERS:
-      priv->use_nonglobal_loaders = g_value_get_boolean (value);
-      break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-      break;
-    }
+  g_clear_pointer (&update->known_files, g_hash_table_unref);
+  g_clear_pointer (&update->strings, bean_string_pool_unref);
+  g_array_unref (update->items);
+  g_ptr_array_unref (update->removed_files);
+  g_slice_free (SearchPathUpdate, update);
 }
 
-static void
-bean_engine_get_property (GObject    *object,
-                          guint       prop_id,
-                          GValue     *value,
-                          GParamSpec *pspec)
+static gboolean
+plugin_file_is_unchanged (PluginFile *file,
+                          ScanItem   *item)
 {
-  BeanEngine *engine = BEAN_ENGINE (object);
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-
-  switch (prop_id)
-    {
-    case PROP_PLUGIN_LIST:
-      g_value_set_pointer (value,
-                           (gpointer) bean_engine_get_plugin_list (engine));
-      break;
-    case PROP_LOADED_PLUGINS:
-      g_value_take_boxed (value,
-                          (gconstpointer) bean_engine_get_loaded_plugins (engine));
-      break;
-    case PROP_NONGLOBAL_LOADERS:
-      g_value_set_boolean (value, priv->use_nonglobal_loaders);
-      break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-      break;
-    }
+  return file != NULL && item->have_stat &&
+         file->mtime == bean_plugin_cache_get_mtime (&item->buf) &&
+         file->size == (guint64) item->buf.st_size;
 }
 
+/* Only does I/O, so it can be used from any thread */
 static void
-bean_engine_dispose (GObject *object)
+search_path_update_scan (SearchPathUpdate *update,
+                         gboolean          parallel)
 {
-  BeanEngine *engine = BEAN_ENGINE (object);
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-  GList *item;
-  gint i;
+  SearchPath *sp = update->sp;
+  GArray *items;
+  GHashTable *found_files;
+  GHashTableIter iter;
+  const gchar *filename;
+  guint i;
 
-  /* See bean_engine_unload_plugin_real() */
-  priv->in_dispose = TRUE;
+  if (update->known_files == NULL)
+    return;
 
-  /* First unload all the plugins */
-  for (item = priv->plugin_list.tail; item != NULL; item = item->prev)
-    {
-      BeanPluginInfo *info = BEAN_PLUGIN_INFO (item->data);
+  items = g_array_new (FALSE, FALSE, sizeof (ScanItem));
+  g_array_set_clear_func (items, (GDestroyNotify) scan_item_clear);
 
-      if (bean_plugin_info_is_loaded (info))
-        bean_engine_unload_plugin (engine, info);
-    }
+  /* The filenames are owned by the items */
+  found_files = g_hash_table_new (g_str_hash, g_str_equal);
 
-  /* Then destroy the plugin loaders */
-  for (i = 0; i < G_N_ELEMENTS (priv->loaders); ++i)
+  scan_file_dir (items, NULL, sp->module_dir, 1);
+
+  for (i = 0; i < items->len; ++i)
     {
-      LoaderInfo *loader_info = &priv->loaders[i];
+      ScanItem *item = &g_array_index (items, ScanItem, i);
 
-      g_clear_object (&loader_info->loader);
-    }
+      PluginFile *file;
 
-  G_OBJECT_CLASS (bean_engine_parent_class)->dispose (object);
-}
+      g_hash_table_add (found_files, item->filename);
 
-static void
-bean_engine_finalize (GObject *object)
-{
-  BeanEngine *engine = BEAN_ENGINE (object);
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-  GList *item;
+      file = g_hash_table_lookup (update->known_files, item->filename);
 
-  /* free the infos */
-  for (item = priv->plugin_list.head; item != NULL; item = item->next)
-    {
-      BeanPluginInfo *info = (BeanPluginInfo *) item->data;
+      if (update->add_only ? file != NULL :
+                             plugin_file_is_unchanged (file, item))
+        continue;
 
-      _bean_plugin_info_unref (info);
+      g_array_append_val (update->items, *item);
+      memset (item, 0, sizeof (ScanItem));
     }
 
-  /* free the search path list */
-  for (item = priv->search_paths.head; item != NULL; item = item->next)
+  if (!update->add_only)
     {
-      SearchPath *sp = (SearchPath *) item->data;
+      g_hash_table_iter_init (&iter, update->known_files);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &filename, NULL))
+        {
+          if (!g_hash_table_contains (found_files, filename))
+            g_ptr_array_add (update->removed_files, g_strdup (filename));
+        }
+    }
 
-      g_free (sp->module_dir);
-      g_free (sp->data_dir);
-      g_slice_free (SearchPath, sp);
+  if (update->items->len > 0 || update->removed_files->len > 0)
+    {
+      g_debug ("Updating %s/*.plugin: %u changed, %u removed",
+               sp->module_dir, update->items->len,
+               update->removed_files->len);
     }
 
-  g_queue_clear (&priv->search_paths);
-  g_queue_clear (&priv->plugin_list);
+  if (update->items->len > 0)
+    {
+      update->strings = bean_string_pool_new ();
+      parse_scan_items (update->items, update->strings, sp->data_dir,
+                        parallel);
+    }
 
-  G_OBJECT_CLASS (bean_engine_parent_class)->finalize (object);
+  g_hash_table_unref (found_files);
+  g_array_unref (items);
 }
 
-static void
-bean_engine_class_init (BeanEngineClass *klass)
+/* Unlike load_file_dir(), only the plugin files which were
+ * added, removed or modified since the last scan are handled
+ */
+static gboolean
+search_path_update_apply (BeanEngine       *engine,
+                          SearchPathUpdate *update)
 {
-  GType the_type = G_TYPE_FROM_CLASS (klass);
-  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  SearchPath *sp = update->sp;
+  PluginFile *file;
+  gchar **loaded_plugins;
+  gboolean removed = FALSE, added = FALSE;
+  guint i;
 
-  object_class->set_property = bean_engine_set_property;
+  if (search_path_is_resource (sp))
+    return load_dir_real (engine, sp);
+
+  if (update->items->len == 0 && update->removed_files->len == 0)
+    return FALSE;
+
+  /* Replaced plugins and their dependants are loaded again afterwards */
+  loaded_plugins = bean_engine_get_loaded_plugins (engine);
+
+  for (i = 0; i < update->removed_files->len; ++i)
+    {
+      const gchar *filename = g_ptr_array_index (update->removed_files, i);
+
+      /* Another update might have been applied in the meantime */
+      file = g_hash_table_lookup (sp->files, filename);
+      if (file == NULL)
+        continue;
+
+      removed |= remove_plugin_file (engine, file);
+      search_path_remove_file (sp, filename);
+    }
+
+  /* The entries of modified files are replaced before the shadowed
+   * plugins are added, otherwise their old info would be added again
+   */
+  for (i = 0; i < update->items->len; ++i)
+    {
+      ScanItem *item = &g_array_index (update->items, ScanItem, i);
+
+      file = g_hash_table_lookup (sp->files, item->filename);
+
+      if (plugin_file_is_unchanged (file, item))
+        {
+          g_clear_pointer (&item->info, _bean_plugin_info_unref);
+          g_clear_error (&item->error);
+          continue;
+        }
+
+      if (file != NULL)
+        removed |= remove_plugin_file (engine, file);
+
+      search_path_add_file (sp, item->filename,
+                            item->have_stat ?
+                              bean_plugin_cache_get_mtime (&item->buf) : -1,
+                            item->have_stat ? item->buf.st_size : 0,
+                            item->info);
+
+      if (item->info == NULL)
+        {
+          g_warning ("%s", item->error->message);
+          g_warning ("Error loading '%s'", item->filename);
+        }
+    }
+
+  /* Also adds the new plugins, in the order they were found */
+  if (removed)
+    {
+      added = add_shadowed_plugin_files (engine);
+    }
+  else
+    {
+      for (i = 0; i < update->items->len; ++i)
+        {
+          ScanItem *item = &g_array_index (update->items, ScanItem, i);
+
+          if (item->info != NULL)
+            added |= add_plugin_info (engine, g_steal_pointer (&item->info));
+        }
+    }
+
+  for (i = 0; loaded_plugins[i] != NULL; ++i)
+    {
+      BeanPluginInfo *info;
+
+      info = bean_engine_get_plugin_info (engine, loaded_plugins[i]);
+
+      if (info != NULL && !bean_plugin_info_is_loaded (info))
+        bean_engine_load_plugin (engine, info);
+    }
+
+  g_strfreev (loaded_plugins);
+
+  return removed || added;
+}
+
+static gboolean
+update_dir (BeanEngine *engine,
+            SearchPath *sp)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  SearchPathUpdate *update;
+  gboolean changed;
+
+  update = search_path_update_new (sp, FALSE, !priv->monitor_search_paths);
+  search_path_update_scan (update, priv->parallel_scan);
+  changed = search_path_update_apply (engine, update);
+  search_path_update_free (update);
+
+  return changed;
+}
+
+static void monitor_changed_cb (GFileMonitor      *monitor,
+                                GFile             *file,
+                                GFile             *other_file,
+                                GFileMonitorEvent  event_type,
+                                BeanEngine        *engine);
+
+static void
+monitor_free (GFileMonitor *monitor)
+{
+  g_signal_handlers_disconnect_matched (monitor, G_SIGNAL_MATCH_FUNC,
+                                        0, 0, NULL, monitor_changed_cb, NULL);
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static void
+search_path_add_monitor (BeanEngine  *engine,
+                         SearchPath  *sp,
+                         const gchar *path)
+{
+  GFile *file;
+  GFileMonitor *monitor;
+  GError *error = NULL;
+
+  file = g_file_new_for_path (path);
+  monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE,
+                                      NULL, &error);
+  g_object_unref (file);
+
+  if (monitor == NULL)
+    {
+      g_debug ("Cannot monitor '%s': %s", path, error->message);
+      g_error_free (error);
+      return;
+    }
+
+  g_object_set_data (G_OBJECT (monitor), "bean-search-path", sp);
+  g_signal_connect (monitor, "changed",
+                    G_CALLBACK (monitor_changed_cb), engine);
+
+  g_ptr_array_add (sp->monitors, monitor);
+}
+
+/* Monitors the same directories that scan_file_dir() reads */
+static void
+search_path_start_monitoring (BeanEngine *engine,
+                              SearchPath *sp)
+{
+  GDir *d;
+  const gchar *dirent;
+
+  if (search_path_is_resource (sp))
+    return;
+
+  g_clear_pointer (&sp->monitors, g_ptr_array_unref);
+  sp->monitors = g_ptr_array_new_with_free_func ((GDestroyNotify) monitor_free);
+  sp->needs_monitors = FALSE;
+
+  /* Also works when the directory does not exist yet */
+  search_path_add_monitor (engine, sp, sp->module_dir);
+
+  d = g_dir_open (sp->module_dir, 0, NULL);
+  if (d == NULL)
+    return;
+
+  while ((dirent = g_dir_read_name (d)))
+    {
+      gchar *path = g_build_filename (sp->module_dir, dirent, NULL);
+
+      if (g_file_test (path, G_FILE_TEST_IS_DIR))
+        search_path_add_monitor (engine, sp, path);
+
+      g_free (path);
+    }
+
+  g_dir_close (d);
+}
+
+static void
+search_path_stop_monitoring (SearchPath *sp)
+{
+  g_clear_pointer (&sp->monitors, g_ptr_array_unref);
+  sp->needs_update = FALSE;
+  sp->needs_monitors = FALSE;
+}
+
+static gboolean
+update_search_paths_cb (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GList *item;
+  gboolean changed = FALSE;
+
+  g_clear_pointer (&priv->update_source, g_source_unref);
+
+  g_object_freeze_notify (G_OBJECT (engine));
+
+  for (item = priv->search_paths.head; item != NULL; item = item->next)
+    {
+      SearchPath *sp = (SearchPath *) item->data;
+
+      if (!sp->needs_update)
+        continue;
+
+      sp->needs_update = FALSE;
+      changed |= update_dir (engine, sp);
+
+      /* A subdirectory might have been added or removed */
+      if (sp->needs_monitors)
+        search_path_start_monitoring (engine, sp);
+    }
+
+  if (changed)
+    plugin_list_changed (engine);
+
+  g_object_thaw_notify (G_OBJECT (engine));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+monitor_changed_cb (GFileMonitor      *monitor,
+                    GFile             *file       G_GNUC_UNUSED,
+                    GFile             *other_file G_GNUC_UNUSED,
+                    GFileMonitorEvent  event_type,
+                    BeanEngine        *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  SearchPath *sp;
+
+  switch (event_type)
+    {
+    /* A CHANGES_DONE_HINT follows once the file is written */
+    case G_FILE_MONITOR_EVENT_CHANGED:
+    case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+    case G_FILE_MONITOR_EVENT_PRE_UNMOUNT:
+    case G_FILE_MONITOR_EVENT_UNMOUNTED:
+      return;
+    default:
+      break;
+    }
+
+  sp = g_object_get_data (G_OBJECT (monitor), "bean-search-path");
+  sp->needs_update = TRUE;
+
+  if (g_ptr_array_index (sp->monitors, 0) == monitor)
+    sp->needs_monitors = TRUE;
+
+  /* Coalesce the events until the main loop is idle again */
+  if (priv->update_source == NULL)
+    {
+      priv->update_source = g_idle_source_new ();
+      g_source_set_callback (priv->update_source,
+                             (GSourceFunc) update_search_paths_cb,
+                             engine, NULL);
+      g_source_attach (priv->update_source,
+                       g_main_context_get_thread_default ());
+    }
+}
+
+/**
+ * bean_engine_rescan_plugins:
+ * @engine: A #BeanEngine.
+ *
+ * Rescan all the registered directories to find new or updated plugins.
+ *
+ * Calling this function will make the newly installed plugin infos
+ * be loaded by the engine, so the new plugins can be used without
+ * restarting the application.
+ *
+ * Only the plugin files which were not found before are read, the
+ * infos of the plugins which are already known are kept as they are.
+ *
+ * If #BeanEngine:monitor-search-paths is set, the plugin files which
+ * were removed or modified since the last scan are handled as well.
+ * The infos of removed plugins are dropped from the engine and the
+ * infos of modified plugins are replaced, plugins which were loaded
+ * are loaded again afterwards.
+ */
+void
+bean_engine_rescan_plugins (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GList *item;
+  gboolean found = FALSE;
+
+  g_return_if_fail (BEAN_IS_ENGINE (engine));
+
+  if (priv->search_paths.length == 0)
+    {
+      g_debug ("No search paths where provided");
+      return;
+    }
+
+  g_object_freeze_notify (G_OBJECT (engine));
+
+  /* Go and read everything from the provided search paths */
+  for (item = priv->search_paths.head; item != NULL; item = item->next)
+    found |= update_dir (engine, (SearchPath *) item->data);
+
+  if (found)
+    plugin_list_changed (engine);
+
+  g_object_thaw_notify (G_OBJECT (engine));
+}
+
+typedef struct _RescanData {
+  /* Of SearchPathUpdate, in the order of the search paths */
+  GPtrArray *updates;
+  gboolean parallel;
+} RescanData;
+
+static void
+rescan_data_free (RescanData *data)
+{
+  g_ptr_array_unref (data->updates);
+  g_slice_free (RescanData, data);
+}
+
+static void
+rescan_plugins_thread (GTask        *task,
+                       gpointer      source_object G_GNUC_UNUSED,
+                       RescanData   *data,
+                       GCancellable *cancellable G_GNUC_UNUSED)
+{
+  guint i;
+
+  for (i = 0; i < data->updates->len; ++i)
+    {
+      if (g_task_return_error_if_cancelled (task))
+        return;
+
+      search_path_update_scan (g_ptr_array_index (data->updates, i),
+                               data->parallel);
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/* Called in the main context of bean_engine_rescan_plugins_async() */
+static void
+rescan_plugins_scanned_cb (BeanEngine   *engine,
+                           GAsyncResult *result,
+                           GTask        *task)
+{
+  RescanData *data = g_task_get_task_data (G_TASK (result));
+  GError *error = NULL;
+  gboolean found = FALSE;
+  guint i;
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
+    }
+
+  g_object_freeze_notify (G_OBJECT (engine));
+
+  for (i = 0; i < data->updates->len; ++i)
+    found |= search_path_update_apply (engine,
+                                       g_ptr_array_index (data->updates, i));
+
+  if (found)
+    plugin_list_changed (engine);
+
+  g_object_thaw_notify (G_OBJECT (engine));
+
+  g_task_return_boolean (task, TRUE);
+  g_object_unref (task);
+}
+
+/**
+ * bean_engine_rescan_plugins_async:
+ * @engine: A #BeanEngine.
+ * @cancellable: (allow-none): A #GCancellable, or %NULL.
+ * @callback: (scope async): A #GAsyncReadyCallback to call when done.
+ * @user_data: (closure): The data to pass to @callback.
+ *
+ * Asynchronously does the same as bean_engine_rescan_plugins().
+ *
+ * The search paths are read and the modified plugin files are parsed
+ * in a worker thread. The changes are then applied in the thread-default
+ * main context of the caller, which is where #BeanEngine:plugin-list is
+ * notified and plugins are loaded or unloaded, right before @callback
+ * is called.
+ *
+ * If @cancellable is cancelled before the changes are applied,
+ * none of them are.
+ *
+ * Since: 2.4
+ */
+void
+bean_engine_rescan_plugins_async (BeanEngine          *engine,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GTask *task, *scan_task;
+  RescanData *data;
+  GList *item;
+
+  g_return_if_fail (BEAN_IS_ENGINE (engine));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (engine, cancellable, callback, user_data);
+  g_task_set_source_tag (task, bean_engine_rescan_plugins_async);
+
+  if (priv->search_paths.length == 0)
+    {
+      g_debug ("No search paths where provided");
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  data = g_slice_new (RescanData);
+  data->parallel = priv->parallel_scan;
+  data->updates =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) search_path_update_free);
+
+  for (item = priv->search_paths.head; item != NULL; item = item->next)
+    {
+      g_ptr_array_add (data->updates,
+                       search_path_update_new ((SearchPath *) item->data,
+                                               TRUE,
+                                               !priv->monitor_search_paths));
+    }
+
+  scan_task = g_task_new (engine, cancellable,
+                          (GAsyncReadyCallback) rescan_plugins_scanned_cb,
+                          task);
+  g_task_set_source_tag (scan_task, bean_engine_rescan_plugins_async);
+  g_task_set_task_data (scan_task, data, (GDestroyNotify) rescan_data_free);
+  g_task_run_in_thread (scan_task, (GTaskThreadFunc) rescan_plugins_thread);
+  g_object_unref (scan_task);
+}
+
+/**
+ * bean_engine_rescan_plugins_finish:
+ * @engine: A #BeanEngine.
+ * @result: A #GAsyncResult.
+ * @error: A location for a #GError, or %NULL.
+ *
+ * Finishes an operation started with bean_engine_rescan_plugins_async().
+ *
+ * Returns: %TRUE if the search paths were rescanned, or %FALSE
+ * if the operation was cancelled.
+ *
+ * Since: 2.4
+ */
+gboolean
+bean_engine_rescan_plugins_finish (BeanEngine    *engine,
+                                   GAsyncResult  *result,
+                                   GError       **error)
+{
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, engine), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+bean_engine_insert_search_path (BeanEngine  *engine,
+                                gboolean     prepend,
+                                const gchar *module_dir,
+                                const gchar *data_dir)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  SearchPath *sp;
+
+  g_return_if_fail (BEAN_IS_ENGINE (engine));
+  g_return_if_fail (module_dir != NULL);
+
+  sp = g_slice_new0 (SearchPath);
+  sp->module_dir = g_strdup (module_dir);
+  sp->data_dir = g_strdup (data_dir ? data_dir : module_dir);
+  sp->strings = priv->strings;
+  sp->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                     (GDestroyNotify) plugin_file_free);
+
+  if (prepend)
+    g_queue_push_head (&priv->search_paths, sp);
+  else
+    g_queue_push_tail (&priv->search_paths, sp);
+
+  /* Before scanning so that no change can be missed */
+  if (priv->monitor_search_paths)
+    search_path_start_monitoring (engine, sp);
+
+  g_object_freeze_notify (G_OBJECT (engine));
+
+  if (load_dir_real (engine, sp))
+    plugin_list_changed (engine);
+
+  g_object_thaw_notify (G_OBJECT (engine));
+}
+
+/**
+ * bean_engine_add_search_path:
+ * @engine: A #BeanEngine.
+ * @module_dir: the plugin module directory.
+ * @data_dir: (allow-none): the plugin data directory.
+ *
+ * This function appends a search path to the list of paths where to
+ * look for plugins.
+ *
+ * A so-called "search path" actually consists of both a
+ * module directory (where the shared libraries or language modules
+ * lie) and a data directory (where the plugin data is).
+ *
+ * The plugin will be able to use a correct data dir depending on
+ * where it is installed, hence allowing to keep the plugin agnostic
+ * when it comes to installation location: the same plugin can be
+ * installed either in the system path or in the user's home directory,
+ * without taking other special care than using
+ * bean_plugin_info_get_data_dir() when looking for its data files.
+ *
+ * If @data_dir is %NULL, then it is set to the same value as
+ * @module_dir.
+ */
+void
+bean_engine_add_search_path (BeanEngine  *engine,
+                             const gchar *module_dir,
+                             const gchar *data_dir)
+{
+  bean_engine_insert_search_path (engine, FALSE, module_dir, data_dir);
+}
+
+/**
+ * bean_engine_prepend_search_path:
+ * @engine: A #BeanEngine.
+ * @module_dir: the plugin module directory.
+ * @data_dir: (allow-none): the plugin data directory.
+ *
+ * This function prepends a search path to the list of paths where to
+ * look for plugins.
+ *
+ * See Also: bean_engine_add_search_path()
+ *
+ * Since: 1.6
+ */
+void
+bean_engine_prepend_search_path (BeanEngine  *engine,
+                                 const gchar *module_dir,
+                                 const gchar *data_dir)
+{
+  bean_engine_insert_search_path (engine, TRUE, module_dir, data_dir);
+}
+
+static void
+default_engine_weak_notify (gpointer    unused G_GNUC_UNUSED,
+                            BeanEngine *engine)
+{
+  g_warn_if_fail (g_atomic_pointer_compare_and_exchange (&default_engine,
+                                                         engine, NULL));
+}
+
+static void
+bean_engine_init (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  /* Don't need to use atomics as bean_engine_shutdown()
+   * is private API and as such is not multithread-safe
+   */
+  if (shutdown)
+    {
+      g_error ("libbean cannot create a plugin engine "
+               "as it has been shutdown.");
+    }
+
+  /* Set the default engine here to make sure that if a
+   * plugin is loaded and calls bean_engine_get_default()
+   * that this engine is returned and not another.
+   *
+   * While bean_engine_get_default() is not thread-safe
+   * we are using atomics here to try and prevent bad
+   * things from happening.
+   */
+  if (g_atomic_pointer_compare_and_exchange (&default_engine, NULL, engine))
+    {
+      g_object_weak_ref (G_OBJECT (engine),
+                         (GWeakNotify) default_engine_weak_notify,
+                         NULL);
+    }
+
+  priv->in_dispose = FALSE;
+
+  g_queue_init (&priv->search_paths);
+  priv->plugin_graph = bean_plugin_graph_new ();
+  priv->plugin_list = bean_plugin_list_new ();
+  priv->strings = bean_string_pool_new ();
+
+  g_mutex_init (&priv->prepare_lock);
+  g_cond_init (&priv->prepare_cond);
+  priv->preparing_plugins = g_hash_table_new (NULL, NULL);
+  priv->prepared_plugins = g_hash_table_new (NULL, NULL);
+  priv->load_timings = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  priv->changed_plugins =
+    g_hash_table_new_full (NULL, NULL,
+                           (GDestroyNotify) _bean_plugin_info_unref, NULL);
+  priv->changed_order = g_ptr_array_new ();
+
+  /* The C plugin loader is always enabled */
+  priv->loaders[BEAN_UTILS_C_LOADER_ID].enabled = TRUE;
+}
+
+/**
+ * bean_engine_garbage_collect:
+ * @engine: A #BeanEngine.
+ *
+ * This function triggers garbage collection on all the loaders currently
+ * owned by the #BeanEngine.  This can be used to force the loaders to destroy
+ * managed objects that still hold references to objects that are about to
+ * disappear.
+ */
+void
+bean_engine_garbage_collect (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  gint i;
+
+  g_return_if_fail (BEAN_IS_ENGINE (engine));
+
+  for (i = 0; i < G_N_ELEMENTS (loaders); ++i)
+    {
+      LoaderInfo *loader_info = &priv->loaders[i];
+
+      if (loader_info->loader != NULL)
+        bean_plugin_loader_garbage_collect (loader_info->loader);
+    }
+}
+
+static void
+bean_engine_set_monitor_search_paths (BeanEngine *engine,
+                                      gboolean    monitor_search_paths)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GList *item;
+
+  monitor_search_paths = monitor_search_paths != FALSE;
+
+  if (priv->monitor_search_paths == monitor_search_paths)
+    return;
+
+  priv->monitor_search_paths = monitor_search_paths;
+
+  for (item = priv->search_paths.head; item != NULL; item = item->next)
+    {
+      SearchPath *sp = (SearchPath *) item->data;
+
+      if (monitor_search_paths)
+        search_path_start_monitoring (engine, sp);
+      else
+        search_path_stop_monitoring (sp);
+    }
+
+  if (!monitor_search_paths && priv->update_source != NULL)
+    {
+      g_source_destroy (priv->update_source);
+      g_clear_pointer (&priv->update_source, g_source_unref);
+    }
+}
+
+static void
+bean_engine_set_property (GObject      *object,
+                          guint         prop_id,
+                          const GValue *value,
+                          GParamSpec   *pspec)
+{
+  BeanEngine *engine = BEAN_ENGINE (object);
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  switch (prop_id)
+    {
+    case PROP_LOADED_PLUGINS:
+      bean_engine_set_loaded_plugins (engine,
+                                      (const gchar **) g_value_get_boxed (value));
+      break;
+    case PROP_NONGLOBAL_LOADERS:
+      priv->use_nonglobal_loaders = g_value_get_boolean (value);
+      break;
+    case PROP_CACHE_DIR:
+      g_free (priv->cache_dir);
+      priv->cache_dir = g_value_dup_string (value);
+      break;
+    case PROP_PARALLEL_SCAN:
+      priv->parallel_scan = g_value_get_boolean (value);
+      break;
+    case PROP_PARALLEL_LOAD:
+      priv->parallel_load = g_value_get_boolean (value);
+      break;
+    case PROP_LAZY_LOAD:
+      priv->lazy_load = g_value_get_boolean (value);
+      break;
+    case PROP_PREFETCH_MODULES:
+      priv->prefetch_modules = g_value_get_boolean (value);
+      break;
+    case PROP_LOAD_PROFILE:
+      g_free (priv->load_profile);
+      priv->load_profile = g_value_dup_string (value);
+      break;
+    case PROP_PREINIT_LOADERS:
+      priv->preinit_loaders = g_value_get_boolean (value);
+      break;
+    case PROP_MONITOR_SEARCH_PATHS:
+      bean_engine_set_monitor_search_paths (engine,
+                                            g_value_get_boolean (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+bean_engine_get_property (GObject    *object,
+                          guint       prop_id,
+                          GValue     *value,
+                          GParamSpec *pspec)
+{
+  BeanEngine *engine = BEAN_ENGINE (object);
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  switch (prop_id)
+    {
+    case PROP_PLUGIN_LIST:
+      g_value_set_pointer (value,
+                           (gpointer) bean_engine_get_plugin_list (engine));
+      break;
+    case PROP_LOADED_PLUGINS:
+      g_value_take_boxed (value,
+                          (gconstpointer) bean_engine_get_loaded_plugins (engine));
+      break;
+    case PROP_NONGLOBAL_LOADERS:
+      g_value_set_boolean (value, priv->use_nonglobal_loaders);
+      break;
+    case PROP_CACHE_DIR:
+      g_value_set_string (value, priv->cache_dir);
+      break;
+    case PROP_PARALLEL_SCAN:
+      g_value_set_boolean (value, priv->parallel_scan);
+      break;
+    case PROP_PARALLEL_LOAD:
+      g_value_set_boolean (value, priv->parallel_load);
+      break;
+    case PROP_LAZY_LOAD:
+      g_value_set_boolean (value, priv->lazy_load);
+      break;
+    case PROP_PREFETCH_MODULES:
+      g_value_set_boolean (value, priv->prefetch_modules);
+      break;
+    case PROP_LOAD_PROFILE:
+      g_value_set_string (value, priv->load_profile);
+      break;
+    case PROP_PREINIT_LOADERS:
+      g_value_set_boolean (value, priv->preinit_loaders);
+      break;
+    case PROP_MONITOR_SEARCH_PATHS:
+      g_value_set_boolean (value, priv->monitor_search_paths);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+bean_engine_dispose (GObject *object)
+{
+  BeanEngine *engine = BEAN_ENGINE (object);
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GList *item;
+  gint i;
+
+  /* See bean_engine_unload_plugin_real() */
+  priv->in_dispose = TRUE;
+
+  /* Plugins must not be loaded again while being disposed */
+  bean_engine_set_monitor_search_paths (engine, FALSE);
+
+  /* It refs the plugins it prefetches */
+  stop_prefetch (engine);
+
+  /* Their loaders are unreffed below */
+  for (i = 0; i < G_N_ELEMENTS (priv->loaders); ++i)
+    {
+      LoaderInfo *loader_info = &priv->loaders[i];
+
+      if (loader_info->init_thread != NULL)
+        g_thread_join (g_steal_pointer (&loader_info->init_thread));
+    }
+
+  /* First unload all the plugins, as dependants are sorted after
+   * their dependencies each unload only has to check its dependants
+   */
+  item = bean_plugin_graph_get_sorted (priv->plugin_graph)->tail;
+  for (; item != NULL; item = item->prev)
+    {
+      BeanPluginInfo *info = BEAN_PLUGIN_INFO (item->data);
+
+      if (bean_plugin_info_is_loaded (info))
+        bean_engine_unload_plugin (engine, info);
+    }
+
+  if (priv->providers != NULL && priv->cache_dir != NULL)
+    bean_provider_index_save (priv->providers, priv->cache_dir);
+
+  if (priv->profile != NULL && priv->load_profile != NULL)
+    bean_load_profile_save (priv->profile, priv->load_profile);
+
+  /* Then destroy the plugin loaders */
+  for (i = 0; i < G_N_ELEMENTS (priv->loaders); ++i)
+    {
+      LoaderInfo *loader_info = &priv->loaders[i];
+
+      g_clear_object (&loader_info->loader);
+    }
+
+  G_OBJECT_CLASS (bean_engine_parent_class)->dispose (object);
+}
+
+static void
+bean_engine_finalize (GObject *object)
+{
+  BeanEngine *engine = BEAN_ENGINE (object);
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GList *item;
+
+  /* free the infos */
+  bean_plugin_list_free (priv->plugin_list);
+  bean_plugin_graph_free (priv->plugin_graph);
+
+  /* free the search path list */
+  for (item = priv->search_paths.head; item != NULL; item = item->next)
+    {
+      SearchPath *sp = (SearchPath *) item->data;
+
+      g_free (sp->module_dir);
+      g_free (sp->data_dir);
+      g_hash_table_unref (sp->files);
+      g_clear_pointer (&sp->monitors, g_ptr_array_unref);
+      g_slice_free (SearchPath, sp);
+    }
+
+  g_queue_clear (&priv->search_paths);
+
+  g_free (priv->cache_dir);
+  bean_provider_index_free (priv->providers);
+  g_free (priv->load_profile);
+  bean_load_profile_free (priv->profile);
+
+  /* The plugin infos which are still used keep their strings */
+  bean_string_pool_unref (priv->strings);
+
+  /* Asynchronous loads keep the engine alive */
+  g_mutex_clear (&priv->prepare_lock);
+  g_cond_clear (&priv->prepare_cond);
+  g_hash_table_unref (priv->preparing_plugins);
+  g_hash_table_unref (priv->prepared_plugins);
+  g_hash_table_unref (priv->load_timings);
+
+  g_ptr_array_unref (priv->changed_order);
+  g_hash_table_unref (priv->changed_plugins);
+
+  G_OBJECT_CLASS (bean_engine_parent_class)->finalize (object);
+}
+
+static void
+bean_engine_class_init (BeanEngineClass *klass)
+{
+  GType the_type = G_TYPE_FROM_CLASS (klass);
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->set_property = bean_engine_set_property;
   object_class->get_property = bean_engine_get_property;
   object_class->dispose = bean_engine_dispose;
   object_class->finalize = bean_engine_finalize;
 
-  klass->load_plugin = bean_engine_load_plugin_real;
-  klass->unload_plugin = bean_engine_unload_plugin_real;
+  klass->load_plugin = bean_engine_load_plugin_real;
+  klass->unload_plugin = bean_engine_unload_plugin_real;
+
+  /**
+   * BeanEngine:plugin-list:
+   *
+   * The list of found plugins.
+   *
+   * This will be modified when bean_engine_rescan_plugins() is called.
+   *
+   * Note: the list belongs to the engine and should not be modified or freed.
+   */
+  properties[PROP_PLUGIN_LIST] =
+    g_param_spec_pointer ("plugin-list",
+                          "Plugin list",
+                          "The list of found plugins",
+                          G_PARAM_READABLE |
+                          G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:loaded-plugins:
+   *
+   * The list of loaded plugins.
+   *
+   * This will be modified when bean_engine_load_plugin() or
+   * bean_engine_unload_plugin() is called.
+   *
+   * This can be used with GSettings to save the loaded plugins by binding
+   * to this property after instantiating the engine by doing:
+   * |[
+   *   g_settings_bind (gsettings_object,
+   *                    LOADED_PLUGINS_KEY,
+   *                    engine,
+   *                    "loaded-plugins",
+   *                    G_SETTINGS_BIND_DEFAULT);
+   * ]|
+   *
+   * Note: notify will not be called when the engine is being destroyed.
+   */
+  properties[PROP_LOADED_PLUGINS] =
+    g_param_spec_boxed ("loaded-plugins",
+                        "Loaded plugins",
+                        "The list of loaded plugins",
+                        G_TYPE_STRV,
+                        G_PARAM_READWRITE |
+                        G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:nonglobal-loaders:
+   *
+   * If non-global plugin loaders should be used.
+   *
+   * See bean_engine_new_with_nonglobal_loaders() for more information.
+   *
+   * Since: 1.14
+   */
+  properties[PROP_NONGLOBAL_LOADERS] =
+    g_param_spec_boolean ("nonglobal-loaders",
+                          "Non-global Loaders",
+                          "Use non-global plugin loaders",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_CONSTRUCT_ONLY |
+                          G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:cache-dir:
+   *
+   * The directory where the plugin cache is stored, or %NULL
+   * to disable the plugin cache.
+   *
+   * When set, the plugin information found in each search path is
+   * stored in a single file in this directory. Later scans of the
+   * search path reuse it as long as none of the directories or
+   * plugin files have been modified, instead of reading and parsing
+   * every plugin file. Resource search paths are never cached.
+   *
+   * Which extension types the loaded plugins were found to provide
+   * by bean_engine_provides_extension() is also kept there, and
+   * saved when the engine is disposed.
+   *
+   * Changing the cache directory only affects search paths that are
+   * scanned afterwards, so it should usually be set at construction.
+   *
+   * Since: 2.4
+   */
+  properties[PROP_CACHE_DIR] =
+    g_param_spec_string ("cache-dir",
+                         "Cache directory",
+                         "The directory where the plugin cache is stored",
+                         NULL,
+                         G_PARAM_READWRITE |
+                         G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:parallel-scan:
+   *
+   * If the plugin files of a search path should be read and parsed
+   * using a pool of worker threads.
+   *
+   * The resulting plugin infos are still added to the engine on the
+   * calling thread and in the same order as when this is disabled.
+   * This mostly helps with search paths that contain many plugins
+   * or are on slow storage.
+   *
+   * Since: 2.4
+   */
+  properties[PROP_PARALLEL_SCAN] =
+    g_param_spec_boolean ("parallel-scan",
+                          "Parallel scan",
+                          "Parse plugin files using worker threads",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:parallel-load:
+   *
+   * If bean_engine_set_loaded_plugins() should open the modules of
+   * the C plugins it is about to load using a pool of worker threads.
+   *
+   * The plugins are grouped by their dependencies, so the modules
+   * of the plugins which do not depend on each other are opened and
+   * register their types at the same time, but always after those of
+   * their dependencies. The #BeanEngine::load-plugin signals are then
+   * still emitted on the calling thread and in the same order as
+   * when this is disabled.
+   *
+   * Note that a module can be opened even if a #BeanEngine::load-plugin
+   * handler then prevents its plugin from being loaded, C modules
+   * are never unloaded.
+   *
+   * Since: 2.4
+   */
+  properties[PROP_PARALLEL_LOAD] =
+    g_param_spec_boolean ("parallel-load",
+                          "Parallel load",
+                          "Open C plugin modules using worker threads",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:lazy-load:
+   *
+   * If loading a plugin which lists the extension types it provides
+   * should only mark it as loaded, its loader then only loads it
+   * when one of these extension types is first requested with
+   * bean_engine_provides_extension() or bean_engine_create_extension().
+   *
+   * The extension types are listed by their #GType names in the
+   * X-Provides key of the plugin file, for instance:
+   * |[
+   * X-Provides=BeanActivatable;MyAppConfigurable;
+   * ]|
+   * Plugins without this key are always loaded right away. As their
+   * loader is not involved, errors such as a missing module are only
+   * noticed on first use, at which point the plugin is unloaded again.
+   *
+   * Since: 2.4
+   */
+  properties[PROP_LAZY_LOAD] =
+    g_param_spec_boolean ("lazy-load",
+                          "Lazy load",
+                          "Load plugins when their extensions are first used",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:prefetch-modules:
+   *
+   * If bean_engine_set_loaded_plugins() should start reading the
+   * modules of the plugins it is about to load, and those of their
+   * dependencies, in a background thread.
+   *
+   * This only asks the operating system to read these files into its
+   * page cache, so that when they are then loaded one after the other
+   * they are already read, or at least being read, instead of waiting
+   * for the disk each time. This helps most when the files are not
+   * cached yet, such as on startup, and on slow disks.
+   *
+   * The shared library of C plugins is prefetched. For Python and Lua
+   * plugins, the script of the module is, or the files of its package
+   * directory. Plugins deferred by #BeanEngine:lazy-load are not.
+   *
+   * Since: 2.4
+   */
+  properties[PROP_PREFETCH_MODULES] =
+    g_param_spec_boolean ("prefetch-modules",
+                          "Prefetch modules",
+                          "Read the modules of plugins before loading them",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:load-profile:
+   *
+   * The file where the load profile is stored, or %NULL to not
+   * record one.
+   *
+   * When set, the engine records which plugins are loaded by their
+   * loader, in which order, how long it took, including initializing
+   * the loader for its first plugin, and how many blocks were read
+   * from the disk meanwhile. This profile replaces the one in the file
+   * when the engine is disposed.
+   *
+   * The profile of the previous run is then used the next time
+   * bean_engine_set_loaded_plugins() is called. The modules of the
+   * plugins are prefetched in the order they were loaded, as with
+   * #BeanEngine:prefetch-modules, and with #BeanEngine:parallel-load
+   * the plugins which took the longest to load are started first.
+   *
+   * It should usually be set at construction, for instance to a file
+   * in the cache directory of the application.
+   *
+   * Since: 2.4
+   */
+  properties[PROP_LOAD_PROFILE] =
+    g_param_spec_string ("load-profile",
+                         "Load profile",
+                         "The file where the load profile is stored",
+                         NULL,
+                         G_PARAM_READWRITE |
+                         G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:preinit-loaders:
+   *
+   * If bean_engine_enable_loader() should start initializing the
+   * plugin loader in a background thread.
+   *
+   * Otherwise a plugin loader is only initialized when the first
+   * plugin using it is loaded, which for the Python and Lua plugin
+   * loaders means starting the interpreter and importing their
+   * bindings. With this the loader is ready, or at least partly
+   * initialized, by the time that plugin is loaded. Loading it still
+   * waits for the initialization to be done.
+   *
+   * Plugin loaders must then support being initialized from another
+   * thread, as they already do for bean_engine_load_plugins_async().
+   *
+   * Since: 2.4
+   */
+  properties[PROP_PREINIT_LOADERS] =
+    g_param_spec_boolean ("preinit-loaders",
+                          "Pre-initialize loaders",
+                          "Initialize plugin loaders when they are enabled",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine:monitor-search-paths:
+   *
+   * If the search paths should be monitored for plugin files
+   * being added, removed or modified.
+   *
+   * The changes are applied in the same way as by
+   * bean_engine_rescan_plugins(), but only for the search paths
+   * which actually changed. While this is set, rescanning the plugins
+   * also handles removed and modified plugin files. They are applied once the thread-default
+   * main context of the thread which added the search path becomes
+   * idle, so nothing is done as long as nothing changes. Resource
+   * search paths are never monitored.
+   *
+   * Since: 2.4
+   */
+  properties[PROP_MONITOR_SEARCH_PATHS] =
+    g_param_spec_boolean ("monitor-search-paths",
+                          "Monitor search paths",
+                          "Apply changes to the plugin files automatically",
+                          FALSE,
+                          G_PARAM_READWRITE |
+                          G_PARAM_STATIC_STRINGS);
+
+  /**
+   * BeanEngine::load-plugin:
+   * @engine: A #BeanEngine.
+   * @info: A #BeanPluginInfo.
+   *
+   * The load-plugin signal is emitted when a plugin is being loaded.
+   *
+   * The plugin is being loaded in the default handler. Hence, if you want to
+   * perform some action before the plugin is loaded, you should use
+   * g_signal_connect(), but if you want to perform some action *after* the
+   * plugin is loaded (the most common case), you should use
+   * g_signal_connect_after().
+   */
+  signals[LOAD_PLUGIN] =
+    g_signal_new (I_("load-plugin"),
+                  the_type,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (BeanEngineClass, load_plugin),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__BOXED,
+                  G_TYPE_NONE,
+                  1,
+                  BEAN_TYPE_PLUGIN_INFO |
+                  G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  /**
+   * BeanEngine::unload-plugin:
+   * @engine: A #BeanEngine.
+   * @info: A #BeanPluginInfo.
+   *
+   * The unload-plugin signal is emitted when a plugin is being unloaded.
+   *
+   * The plugin is being unloaded in the default handler. Hence, if you want
+   * to perform some action before the plugin is unloaded (the most common
+   * case), you should use g_signal_connect(), but if you want to perform some
+   * action after the plugin is unloaded (the most common case), you should
+   * use g_signal_connect_after().
+   */
+  signals[UNLOAD_PLUGIN] =
+    g_signal_new (I_("unload-plugin"),
+                  the_type,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (BeanEngineClass, unload_plugin),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__BOXED,
+                  G_TYPE_NONE,
+                  1, BEAN_TYPE_PLUGIN_INFO |
+                  G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  /**
+   * BeanEngine::loaded-plugins-changed:
+   * @engine: A #BeanEngine.
+   * @loaded: (array zero-terminated=1): The module names of the plugins
+   *  which were loaded.
+   * @unloaded: (array zero-terminated=1): The module names of the plugins
+   *  which were unloaded.
+   *
+   * The loaded-plugins-changed signal is emitted after plugins were loaded
+   * or unloaded, right before #BeanEngine:loaded-plugins is notified.
+   *
+   * It is emitted once for each plugin which is loaded or unloaded
+   * on its own, and once for a whole batch of them, see
+   * bean_engine_begin_batch(). A plugin which was loaded and then
+   * unloaded again during a batch is not part of either list.
+   *
+   * Since: 2.4
+   */
+  signals[LOADED_PLUGINS_CHANGED] =
+    g_signal_new (I_("loaded-plugins-changed"),
+                  the_type,
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE,
+                  2,
+                  G_TYPE_STRV | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_STRV | G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  g_object_class_install_properties (object_class, N_PROPERTIES, properties);
+
+  /* We don't support calling BeanEngine API without module support */
+  if (!g_module_supported ())
+    {
+      g_error ("libbean is not able to create the "
+               "plugins engine as modules are not supported.");
+    }
+
+  /* We are doing some global initialization here as there is currently no
+   * global init function for libbean. */
+  bean_debug_init ();
+
+  /* This cannot be done as a compile-time
+   * assert, but is critical for correct behavior
+   */
+  g_assert (g_strcmp0 (bean_utils_get_loader_from_id (BEAN_UTILS_C_LOADER_ID),
+                       "c") == 0);
+
+  /* The C plugin loader is always enabled */
+  loaders[BEAN_UTILS_C_LOADER_ID].enabled = TRUE;
+}
+
+static BeanObjectModule *
+get_plugin_loader_module (gint loader_id)
+{
+  GlobalLoaderInfo *global_loader_info = &loaders[loader_id];
+  const gchar *loader_name, *module_name;
+  gchar *module_dir;
+
+  if (global_loader_info->module != NULL)
+    return global_loader_info->module;
+
+  loader_name = bean_utils_get_loader_from_id (loader_id);
+  module_name = bean_utils_get_loader_module_from_id (loader_id);
+  module_dir = bean_dirs_get_plugin_loader_dir (loader_name);
+
+  /* Bind loaders globally, binding
+   * locally can break the plugin loaders
+   */
+  global_loader_info->module = bean_object_module_new_full (module_name,
+                                                            module_dir,
+                                                            TRUE, FALSE);
+
+  if (!g_type_module_use (G_TYPE_MODULE (global_loader_info->module)))
+    {
+      g_warning ("Could not load plugin loader '%s'", loader_name);
+      g_clear_object (&global_loader_info->module);
+    }
+
+  g_free (module_dir);
+
+  return global_loader_info->module;
+}
+
+static BeanPluginLoader *
+create_plugin_loader (gint loader_id)
+{
+  BeanPluginLoader *loader;
+
+  if (loader_id == BEAN_UTILS_C_LOADER_ID)
+    {
+      loader = bean_plugin_loader_c_new ();
+    }
+  else
+    {
+      BeanObjectModule *module;
+
+      module = get_plugin_loader_module (loader_id);
+      if (module == NULL)
+        return NULL;
+
+      loader = BEAN_PLUGIN_LOADER (
+            bean_object_module_create_object (module,
+                                              BEAN_TYPE_PLUGIN_LOADER,
+                                              0, NULL, NULL));
+    }
+
+  if (loader == NULL || !bean_plugin_loader_initialize (loader))
+    {
+      g_warning ("Loader '%s' is not a valid BeanPluginLoader instance",
+                 bean_utils_get_loader_from_id (loader_id));
+      g_clear_object (&loader);
+    }
+
+  return loader;
+}
+
+/* Called with the lock held, which is released while the loader is
+ * created so that the other loaders can be used in the meantime. Only
+ * one thread creates a given loader at a time, the others wait for it.
+ */
+static BeanPluginLoader *
+get_local_plugin_loader (BeanEngine *engine,
+                         gint        loader_id)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  LoaderInfo *loader_info = &priv->loaders[loader_id];
+  GlobalLoaderInfo *global_loader_info = &loaders[loader_id];
+  BeanPluginLoader *loader;
+
+  while (global_loader_info->initializing)
+    g_cond_wait (&loaders_cond, &loaders_lock);
+
+  /* Another thread might have won the race */
+  if (loader_info->loader != NULL || loader_info->failed)
+    return loader_info->loader;
+
+  if (global_loader_info->failed)
+    {
+      loader = NULL;
+    }
+  else if (global_loader_info->loader != NULL &&
+           (!priv->use_nonglobal_loaders ||
+            bean_plugin_loader_is_global (global_loader_info->loader)))
+    {
+      loader = g_object_ref (global_loader_info->loader);
+    }
+  else
+    {
+      global_loader_info->initializing = TRUE;
+      g_mutex_unlock (&loaders_lock);
+
+      loader = create_plugin_loader (loader_id);
+
+      g_mutex_lock (&loaders_lock);
+      global_loader_info->initializing = FALSE;
+      g_cond_broadcast (&loaders_cond);
+
+      if (loader == NULL)
+        {
+          global_loader_info->failed = TRUE;
+        }
+      else if (!priv->use_nonglobal_loaders ||
+               bean_plugin_loader_is_global (loader))
+        {
+          global_loader_info->loader = g_object_ref (loader);
+        }
+    }
+
+  g_atomic_pointer_set (&loader_info->loader, loader);
+
+  if (loader == NULL)
+    loader_info->failed = TRUE;
+
+  return loader;
+}
+
+static BeanPluginLoader *
+get_plugin_loader (BeanEngine *engine,
+                   gint        loader_id)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  LoaderInfo *loader_info = &priv->loaders[loader_id];
+  GlobalLoaderInfo *global_loader_info = &loaders[loader_id];
+
+  if (g_atomic_pointer_get (&loader_info->loader) != NULL)
+    return loader_info->loader;
+
+  g_mutex_lock (&loaders_lock);
+
+  /* It could have been created by bean_engine_load_plugins_async() */
+  if (loader_info->loader != NULL || loader_info->failed)
+    {
+      g_mutex_unlock (&loaders_lock);
+      return loader_info->loader;
+    }
+
+  if (!loader_info->enabled)
+    {
+      if (!global_loader_info->enabled)
+        {
+          g_warning ("The '%s' plugin loader has not been enabled",
+                     bean_utils_get_loader_from_id (loader_id));
+
+          g_mutex_unlock (&loaders_lock);
+          return NULL;
+        }
+
+      g_warning ("The '%s' plugin loader was not enabled "
+                 "for this engine. This will no longer be "
+                 "supported at some point in the future!",
+                 bean_utils_get_loader_from_id (loader_id));
+
+      g_mutex_unlock (&loaders_lock);
+
+      /* Avoid bypassing logic in bean_engine_enable_loader() */
+      bean_engine_enable_loader (engine,
+                                 bean_utils_get_loader_from_id (loader_id));
+      return get_plugin_loader (engine, loader_id);
+    }
+
+  get_local_plugin_loader (engine, loader_id);
+
+  g_mutex_unlock (&loaders_lock);
+  return loader_info->loader;
+}
+
+/* Like get_plugin_loader() but can be used from any thread, loaders
+ * which were not enabled for @engine are left to get_plugin_loader()
+ * so that it warns about them
+ */
+static BeanPluginLoader *
+get_enabled_plugin_loader (BeanEngine *engine,
+                           gint        loader_id)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  LoaderInfo *loader_info = &priv->loaders[loader_id];
+  BeanPluginLoader *loader;
+
+  g_mutex_lock (&loaders_lock);
+
+  if (loader_info->enabled)
+    get_local_plugin_loader (engine, loader_id);
+
+  loader = loader_info->loader;
+
+  g_mutex_unlock (&loaders_lock);
+  return loader;
+}
+
+typedef struct {
+  BeanEngine *engine;
+  gint loader_id;
+} LoaderInitData;
+
+static gpointer
+init_plugin_loader_thread (LoaderInitData *data)
+{
+  /* Does nothing if the loader was already needed meanwhile */
+  get_enabled_plugin_loader (data->engine, data->loader_id);
+
+  g_free (data);
+  return NULL;
+}
+
+/* Called with the lock held, the loader is then
+ * handed over like by get_enabled_plugin_loader()
+ */
+static void
+init_plugin_loader (BeanEngine *engine,
+                    gint        loader_id)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  LoaderInfo *loader_info = &priv->loaders[loader_id];
+  LoaderInitData *data;
+
+  if (loader_info->init_thread != NULL)
+    return;
+
+  data = g_new (LoaderInitData, 1);
+  data->engine = engine;
+  data->loader_id = loader_id;
+
+  loader_info->init_thread = g_thread_try_new ("bean-loader-init",
+                                               (GThreadFunc) init_plugin_loader_thread,
+                                               data, NULL);
+
+  /* It will be initialized when first needed instead */
+  if (loader_info->init_thread == NULL)
+    g_free (data);
+}
+
+/**
+ * bean_engine_enable_loader:
+ * @engine: A #BeanEngine.
+ * @loader_name: The name of the loader to enable.
+ *
+ * Enable a loader, enables a loader for plugins.
+ * The C plugin loader is always enabled. The other plugin
+ * loaders are: lua5.1, python and python3.
+ *
+ * For instance, the following code will enable Python 2 plugins
+ * to be loaded:
+ * |[
+ * bean_engine_enable_loader (engine, "python");
+ * ]|
+ *
+ * The plugin loader is initialized when the first plugin using it is
+ * loaded, or right away in a background thread with
+ * #BeanEngine:preinit-loaders.
+ *
+ * Note: plugin loaders used to be shared across #BeanEngines so enabling
+ *       a loader on one #BeanEngine would enable it on all #BeanEngines.
+ *       This behavior has been kept to avoid breaking applications,
+ *       however a warning has been added to help applications transition.
+ **/
+void
+bean_engine_enable_loader (BeanEngine  *engine,
+                           const gchar *loader_name)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  LoaderInfo *loader_info;
+  gint loader_id;
+
+  g_return_if_fail (BEAN_IS_ENGINE (engine));
+  g_return_if_fail (loader_name != NULL && *loader_name != '\0');
+
+  loader_id = bean_utils_get_loader_id (loader_name);
+
+  if (loader_id == -1)
+    {
+      g_warning ("Failed to enable unknown plugin loader '%s'", loader_name);
+      return;
+    }
+
+  loader_info = &priv->loaders[loader_id];
+  if (loader_info->enabled || loader_info->failed)
+    return;
+
+  g_mutex_lock (&loaders_lock);
+
+  /* Don't check if the loader failed
+   * as we want to warn multiple times
+   */
+  if (loaders[loader_id].enabled)
+    {
+      loader_info->enabled = TRUE;
+
+      if (priv->preinit_loaders && !loaders[loader_id].failed)
+        init_plugin_loader (engine, loader_id);
+
+      g_mutex_unlock (&loaders_lock);
+      return;
+    }
+
+  /* Some tests check for mixed versions this way */
+  if (g_getenv ("BEAN_ALLOW_CONFLICTING_LOADERS") == NULL)
+    {
+      gint i;
+      const gint *loader_ids;
+
+      loader_ids = bean_utils_get_conflicting_loaders_from_id (loader_id);
+
+      /* Some loaders conflict with each other
+       * and cannot be used in the same process
+       */
+      for (i = 0; loader_ids[i] != -1; ++i)
+        {
+          if (!loaders[loader_ids[i]].enabled)
+            continue;
+
+          g_warning ("Cannot enable plugin loader '%s' as the "
+                     "'%s' plugin loader is already enabled.", loader_name,
+                     bean_utils_get_loader_from_id (loader_ids[i]));
+
+          loader_info->failed = TRUE;
+          loaders[loader_id].failed = TRUE;
+          g_mutex_unlock (&loaders_lock);
+          return;
+        }
+    }
+
+  /* We do not load the plugin loader immediately and instead
+   * load it in get_plugin_loader() so that it is loaded lazily,
+   * unless it should already be initialized in the background.
+   */
+  loader_info->enabled = TRUE;
+  loaders[loader_id].enabled = TRUE;
+
+  if (priv->preinit_loaders)
+    init_plugin_loader (engine, loader_id);
+
+  g_mutex_unlock (&loaders_lock);
+}
+
+/**
+ * bean_engine_get_plugin_list:
+ * @engine: A #BeanEngine.
+ *
+ * Returns the list of #BeanPluginInfo known to the engine.
+ *
+ * Returns: (transfer none) (element-type Bean.PluginInfo): a #GList of
+ * #BeanPluginInfo. Note that the list belongs to the engine and should
+ * not be freed.
+ **/
+const GList *
+bean_engine_get_plugin_list (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+
+  return bean_plugin_list_get_head (priv->plugin_list);
+}
+
+/**
+ * bean_engine_get_plugin_info:
+ * @engine: A #BeanEngine.
+ * @plugin_name: A plugin name.
+ *
+ * Gets the #BeanPluginInfo corresponding with @plugin_name,
+ * or %NULL if @plugin_name was not found.
+ *
+ * Returns: (transfer none): the #BeanPluginInfo corresponding with
+ * a given plugin module name.
+ */
+BeanPluginInfo *
+bean_engine_get_plugin_info (BeanEngine  *engine,
+                             const gchar *plugin_name)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (plugin_name != NULL, NULL);
+
+  return bean_plugin_graph_lookup (priv->plugin_graph, plugin_name);
+}
+
+/**
+ * bean_engine_get_plugin_dependants:
+ * @engine: A #BeanEngine.
+ * @info: A #BeanPluginInfo.
+ *
+ * Gets the plugins which directly depend on @info, sorted by
+ * their module name unless they depend on each other.
+ *
+ * Returns: (transfer container) (element-type Bean.PluginInfo): a #GList
+ * of #BeanPluginInfo. Note that only the list should be freed.
+ *
+ * Since: 2.4
+ */
+GList *
+bean_engine_get_plugin_dependants (BeanEngine     *engine,
+                                   BeanPluginInfo *info)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GPtrArray *dependants;
+  GList *list = NULL;
+  guint i;
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+
+  dependants = bean_plugin_graph_get_dependants (priv->plugin_graph, info);
+  if (dependants == NULL)
+    return NULL;
+
+  for (i = dependants->len; i > 0; --i)
+    list = g_list_prepend (list, g_ptr_array_index (dependants, i - 1));
+
+  return list;
+}
+
+static void
+emit_loaded_plugins_changed (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GHashTable *changed_plugins;
+  GPtrArray *changed_order;
+  GPtrArray *loaded, *unloaded;
+  guint i;
+
+  if (priv->changed_order->len == 0)
+    return;
+
+  /* Handlers can load or unload plugins */
+  changed_plugins = priv->changed_plugins;
+  changed_order = priv->changed_order;
+  priv->changed_plugins =
+    g_hash_table_new_full (NULL, NULL,
+                           (GDestroyNotify) _bean_plugin_info_unref, NULL);
+  priv->changed_order = g_ptr_array_new ();
+
+  loaded = g_ptr_array_new ();
+  unloaded = g_ptr_array_new ();
+
+  for (i = 0; i < changed_order->len; ++i)
+    {
+      BeanPluginInfo *info = g_ptr_array_index (changed_order, i);
+      gboolean was_loaded, is_loaded;
+
+      was_loaded = GPOINTER_TO_INT (g_hash_table_lookup (changed_plugins,
+                                                         info));
+      is_loaded = bean_plugin_info_is_loaded (info);
+
+      if (is_loaded && !was_loaded)
+        g_ptr_array_add (loaded, (gpointer) info->module_name);
+      else if (!is_loaded && was_loaded)
+        g_ptr_array_add (unloaded, (gpointer) info->module_name);
+    }
+
+  g_ptr_array_add (loaded, NULL);
+  g_ptr_array_add (unloaded, NULL);
+
+  /* A plugin which was loaded and then unloaded did not change */
+  if (loaded->len > 1 || unloaded->len > 1)
+    {
+      g_signal_emit (engine, signals[LOADED_PLUGINS_CHANGED], 0,
+                     loaded->pdata, unloaded->pdata);
+    }
+
+  g_ptr_array_unref (loaded);
+  g_ptr_array_unref (unloaded);
+  g_ptr_array_unref (changed_order);
+  g_hash_table_unref (changed_plugins);
+}
+
+static void
+loaded_plugins_changed (BeanEngine     *engine,
+                        BeanPluginInfo *info,
+                        gboolean        was_loaded)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  if (!g_hash_table_contains (priv->changed_plugins, info))
+    {
+      g_hash_table_insert (priv->changed_plugins,
+                           _bean_plugin_info_ref (info),
+                           GINT_TO_POINTER (was_loaded));
+      g_ptr_array_add (priv->changed_order, info);
+    }
+
+  /* Like bean_engine_commit_batch(), right before the notification */
+  if (priv->batch_depth == 0)
+    emit_loaded_plugins_changed (engine);
+
+  /* Coalesced by bean_engine_begin_batch() */
+  g_object_notify_by_pspec (G_OBJECT (engine),
+                            properties[PROP_LOADED_PLUGINS]);
+}
+
+/**
+ * bean_engine_begin_batch:
+ * @engine: A #BeanEngine.
+ *
+ * Starts a batch of plugin loads and unloads, until the matching
+ * call to bean_engine_commit_batch().
+ *
+ * While in a batch, #BeanEngine:loaded-plugins is only notified once
+ * and #BeanEngine::loaded-plugins-changed is only emitted once, when
+ * the batch is committed, however many plugins were loaded or unloaded.
+ * The #BeanEngine::load-plugin and #BeanEngine::unload-plugin signals
+ * are still emitted for each plugin, as it is loaded or unloaded.
+ *
+ * Batches can be nested, only the outermost one is committed.
+ * bean_engine_set_loaded_plugins() is always applied as a batch.
+ *
+ * Since: 2.4
+ */
+void
+bean_engine_begin_batch (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  g_return_if_fail (BEAN_IS_ENGINE (engine));
+
+  g_object_freeze_notify (G_OBJECT (engine));
+  priv->batch_depth++;
+}
+
+/**
+ * bean_engine_commit_batch:
+ * @engine: A #BeanEngine.
+ *
+ * Ends a batch started with bean_engine_begin_batch().
+ *
+ * If this ends the outermost batch and plugins were loaded or
+ * unloaded since it was started, #BeanEngine::loaded-plugins-changed
+ * is emitted and then #BeanEngine:loaded-plugins is notified.
+ *
+ * Since: 2.4
+ */
+void
+bean_engine_commit_batch (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  g_return_if_fail (BEAN_IS_ENGINE (engine));
+  g_return_if_fail (priv->batch_depth > 0);
+
+  if (--priv->batch_depth == 0)
+    emit_loaded_plugins_changed (engine);
+
+  g_object_thaw_notify (G_OBJECT (engine));
+}
+
+/* If loading the plugin by its loader can wait until
+ * one of the extension types it provides is first used
+ */
+static gboolean
+can_defer_plugin (BeanEngine     *engine,
+                  BeanPluginInfo *info)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  return priv->lazy_load && info->provides != NULL;
+}
+
+static gboolean
+plugin_provides_type (BeanPluginInfo *info,
+                      GType           extension_type)
+{
+  const gchar *type_name = g_type_name (extension_type);
+  guint i;
+
+  for (i = 0; info->provides[i] != NULL; ++i)
+    {
+      GType provided_type;
+
+      if (strcmp (info->provides[i], type_name) == 0)
+        return TRUE;
+
+      /* Also allow listing a more specific type */
+      provided_type = g_type_from_name (info->provides[i]);
+      if (provided_type != G_TYPE_INVALID &&
+          g_type_is_a (provided_type, extension_type))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Resource plugins cannot be checked for changes so they are not indexed */
+static BeanProviderIndex *
+get_provider_index (BeanEngine     *engine,
+                    BeanPluginInfo *info)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  if (priv->cache_dir == NULL ||
+      g_str_has_prefix (info->filename, "resource://"))
+    return NULL;
+
+  if (g_once_init_enter (&priv->providers))
+    {
+      BeanProviderIndex *providers = bean_provider_index_new ();
+
+      bean_provider_index_load (providers, priv->cache_dir);
+      g_once_init_leave (&priv->providers, providers);
+    }
+
+  return priv->providers;
+}
+
+static BeanLoadProfile *
+get_load_profile (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  if (priv->load_profile == NULL)
+    return NULL;
+
+  if (g_once_init_enter (&priv->profile))
+    {
+      BeanLoadProfile *profile = bean_load_profile_new ();
+
+      bean_load_profile_load (profile, priv->load_profile);
+      g_once_init_leave (&priv->profile, profile);
+    }
+
+  return priv->profile;
+}
+
+/* Keeps how long loading the plugin in a worker thread
+ * took until the engine actually loads the plugin
+ */
+static void
+stash_load_timing (BeanEngine           *engine,
+                   BeanPluginInfo       *info,
+                   const BeanLoadTiming *timing)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+
+  g_mutex_lock (&priv->prepare_lock);
+  g_hash_table_insert (priv->load_timings, info,
+                       g_memdup2 (timing, sizeof (BeanLoadTiming)));
+  g_mutex_unlock (&priv->prepare_lock);
+}
+
+/* The timing is dropped if @timing is %NULL */
+static gboolean
+take_load_timing (BeanEngine     *engine,
+                  BeanPluginInfo *info,
+                  BeanLoadTiming *timing)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  BeanLoadTiming *stashed;
+
+  g_mutex_lock (&priv->prepare_lock);
+
+  if (!g_hash_table_steal_extended (priv->load_timings, info,
+                                    NULL, (gpointer *) &stashed))
+    {
+      g_mutex_unlock (&priv->prepare_lock);
+      return FALSE;
+    }
+
+  g_mutex_unlock (&priv->prepare_lock);
+
+  if (timing != NULL)
+    *timing = *stashed;
+
+  g_free (stashed);
+  return TRUE;
+}
+
+/* Gets the loader of the plugin, which might have to be initialized */
+static BeanPluginLoader *
+get_plugin_loader_timed (BeanEngine     *engine,
+                         gint            loader_id,
+                         BeanLoadTiming *timing)
+{
+  BeanPluginLoader *loader;
+  gint64 start_time;
+
+  if (timing == NULL)
+    return get_plugin_loader (engine, loader_id);
+
+  start_time = g_get_monotonic_time ();
+  loader = get_plugin_loader (engine, loader_id);
+  timing->phases[BEAN_LOAD_PHASE_LOADER_INIT] +=
+    g_get_monotonic_time () - start_time;
+
+  return loader;
+}
+
+/* Loads the plugin by its loader, adding the time it took to
+ * the phases of @timing. The C loader only opens the module of
+ * the plugin the first time, possibly when it was preloaded.
+ */
+static gboolean
+plugin_loader_load_timed (BeanPluginLoader *loader,
+                          BeanPluginInfo   *info,
+                          BeanLoadTiming   *timing)
+{
+  gint64 start_time;
+  gboolean loaded;
+
+  if (timing == NULL)
+    return bean_plugin_loader_load (loader, info);
+
+  start_time = g_get_monotonic_time ();
+  loaded = bean_plugin_loader_load (loader, info);
+
+  if (loaded && info->loader_id == BEAN_UTILS_C_LOADER_ID)
+    {
+      gint64 open_time, register_time;
+
+      _bean_object_module_take_load_times (info->loader_data,
+                                           &open_time, &register_time);
+      timing->phases[BEAN_LOAD_PHASE_MODULE_OPEN] += open_time;
+      timing->phases[BEAN_LOAD_PHASE_REGISTER_TYPES] += register_time;
+    }
+  else
+    {
+      timing->phases[BEAN_LOAD_PHASE_IMPORT] +=
+        g_get_monotonic_time () - start_time;
+    }
+
+  return loaded;
+}
+
+/* Adds the deferred dependencies of the plugin and then the plugin */
+static void
+collect_deferred_plugins (BeanEngine     *engine,
+                          BeanPluginInfo *info,
+                          GHashTable     *visited,
+                          GPtrArray      *deferred)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GPtrArray *deps;
+  guint i;
+
+  if (!info->deferred || !g_hash_table_add (visited, info))
+    return;
+
+  deps = bean_plugin_graph_get_dependencies (priv->plugin_graph, info);
+  for (i = 0; i < deps->len; ++i)
+    collect_deferred_plugins (engine, g_ptr_array_index (deps, i),
+                              visited, deferred);
+
+  g_ptr_array_add (deferred, info);
+}
+
+/* Loads a plugin deferred by BeanEngine:lazy-load by its loader,
+ * after its deferred dependencies. A plugin which then fails
+ * to load is unloaded like any plugin which depends on it.
+ */
+static gboolean
+load_deferred_plugin (BeanEngine     *engine,
+                      BeanPluginInfo *info)
+{
+  BeanLoadProfile *profile = get_load_profile (engine);
+  BeanLoadTiming timing_data, *timing = NULL;
+  GHashTable *visited;
+  GPtrArray *deferred;
+  guint i;
+
+  if (profile != NULL)
+    timing = &timing_data;
+
+  visited = g_hash_table_new (NULL, NULL);
+  deferred = g_ptr_array_new ();
+
+  collect_deferred_plugins (engine, info, visited, deferred);
+
+  for (i = 0; i < deferred->len; ++i)
+    {
+      BeanPluginInfo *dep_info = g_ptr_array_index (deferred, i);
+      BeanPluginLoader *loader;
+
+      /* Unloaded when one of its dependencies failed to load */
+      if (!bean_plugin_info_is_loaded (dep_info))
+        continue;
+
+      if (timing != NULL)
+        bean_load_timing_start (timing);
+
+      /* The loader was not needed until now either */
+      loader = get_plugin_loader_timed (engine, dep_info->loader_id, timing);
+
+      if (loader != NULL && plugin_loader_load_timed (loader, dep_info, timing))
+        {
+          g_debug ("Loaded deferred plugin '%s'",
+                   bean_plugin_info_get_module_name (dep_info));
+          dep_info->deferred = FALSE;
+
+          if (timing != NULL)
+            {
+              bean_load_timing_stop (timing);
+              bean_load_profile_record (profile, dep_info->module_name,
+                                        timing);
+            }
+          continue;
+        }
+
+      g_clear_error (&dep_info->error);
+
+      if (loader == NULL)
+        {
+          /* Already warned */
+          g_set_error (&dep_info->error,
+                       BEAN_PLUGIN_INFO_ERROR,
+                       BEAN_PLUGIN_INFO_ERROR_LOADER_NOT_FOUND,
+                       _("Plugin loader “%s” was not found"),
+                       bean_utils_get_loader_from_id (dep_info->loader_id));
+        }
+      else
+        {
+          g_warning ("Error loading plugin '%s'",
+                     bean_plugin_info_get_module_name (dep_info));
+          g_set_error (&dep_info->error,
+                       BEAN_PLUGIN_INFO_ERROR,
+                       BEAN_PLUGIN_INFO_ERROR_LOADING_FAILED,
+                       _("Failed to load"));
+        }
+
+      bean_engine_unload_plugin (engine, dep_info);
+      dep_info->available = FALSE;
+    }
+
+  g_ptr_array_unref (deferred);
+  g_hash_table_unref (visited);
+
+  return bean_plugin_info_is_loaded (info) && !info->deferred;
+}
+
+/* Returns %TRUE if the plugin was already loaded by its
+ * loader in a worker thread, waiting for it if needed
+ */
+static gboolean
+claim_prepared_plugin (BeanEngine     *engine,
+                       BeanPluginInfo *info)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  gboolean prepared;
+
+  g_mutex_lock (&priv->prepare_lock);
+
+  while (g_hash_table_contains (priv->preparing_plugins, info))
+    g_cond_wait (&priv->prepare_cond, &priv->prepare_lock);
+
+  prepared = g_hash_table_remove (priv->prepared_plugins, info);
+
+  g_mutex_unlock (&priv->prepare_lock);
+
+  return prepared;
+}
+
+static void
+bean_engine_load_plugin_real (BeanEngine     *engine,
+                              BeanPluginInfo *info)
+{
+  const gchar **dependencies;
+  BeanPluginInfo *dep_info;
+  guint i;
+  BeanPluginLoader *loader;
+  BeanLoadProfile *profile;
+  BeanLoadTiming timing_data, *timing = NULL;
+
+  if (bean_plugin_info_is_loaded (info))
+    return;
+
+  if (!bean_plugin_info_is_available (info, NULL))
+    return;
+
+  /* We set the plugin info as loaded before trying to load the dependencies,
+   * to make sure we won't have an infinite loop. */
+  info->loaded = TRUE;
+
+  dependencies = bean_plugin_info_get_dependencies (info);
+  for (i = 0; dependencies[i] != NULL; i++)
+    {
+      dep_info = bean_engine_get_plugin_info (engine, dependencies[i]);
+      if (!dep_info)
+        {
+          g_warning ("Could not find plugin '%s' for plugin '%s'",
+                     dependencies[i], bean_plugin_info_get_module_name (info));
+          g_set_error (&info->error,
+                       BEAN_PLUGIN_INFO_ERROR,
+                       BEAN_PLUGIN_INFO_ERROR_DEP_NOT_FOUND,
+                       _("Dependency “%s” was not found"),
+                       dependencies[i]);
+          goto error;
+        }
+
+      if (!bean_engine_load_plugin (engine, dep_info))
+        {
+          g_set_error (&info->error,
+                       BEAN_PLUGIN_INFO_ERROR,
+                       BEAN_PLUGIN_INFO_ERROR_LOADING_FAILED,
+                       _("Dependency “%s” failed to load"),
+                       bean_plugin_info_get_name (dep_info));
+          goto error;
+        }
+    }
+
+  profile = get_load_profile (engine);
+  if (profile != NULL)
+    timing = &timing_data;
+
+  if (claim_prepared_plugin (engine, info))
+    {
+      /* Already loaded by its loader, which was timed meanwhile */
+      if (timing != NULL && take_load_timing (engine, info, timing))
+        bean_load_profile_record (profile, info->module_name, timing);
+    }
+  else if (can_defer_plugin (engine, info))
+    {
+      /* Its loader is not even initialized until then */
+      g_debug ("Deferred loading plugin '%s'",
+               bean_plugin_info_get_module_name (info));
+      info->deferred = TRUE;
+    }
+  else
+    {
+      if (timing != NULL)
+        bean_load_timing_start (timing);
+
+      /* Includes initializing the loader for its first plugin */
+      loader = get_plugin_loader_timed (engine, info->loader_id, timing);
+
+      if (loader == NULL)
+        {
+          /* Already warned */
+          g_set_error (&info->error,
+                       BEAN_PLUGIN_INFO_ERROR,
+                       BEAN_PLUGIN_INFO_ERROR_LOADER_NOT_FOUND,
+                       _("Plugin loader “%s” was not found"),
+                       bean_utils_get_loader_from_id (info->loader_id));
+          goto error;
+        }
+
+      if (!plugin_loader_load_timed (loader, info, timing))
+        {
+          g_warning ("Error loading plugin '%s'",
+                     bean_plugin_info_get_module_name (info));
+          g_set_error (&info->error,
+                       BEAN_PLUGIN_INFO_ERROR,
+                       BEAN_PLUGIN_INFO_ERROR_LOADING_FAILED,
+                       _("Failed to load"));
+          goto error;
+        }
+
+      if (timing != NULL)
+        {
+          BeanLoadTiming preload_timing;
+
+          bean_load_timing_stop (timing);
+
+          /* Its module was already opened by preload_plugins() */
+          if (take_load_timing (engine, info, &preload_timing))
+            {
+              timing->duration += preload_timing.duration;
+              timing->blocks_read += preload_timing.blocks_read;
+            }
+
+          bean_load_profile_record (profile, info->module_name, timing);
+        }
+    }
+
+  g_debug ("Loaded plugin '%s'", bean_plugin_info_get_module_name (info));
+
+  loaded_plugins_changed (engine, info, FALSE);
+
+  return;
+
+error:
+
+  info->loaded = FALSE;
+  info->available = FALSE;
+}
+
+/**
+ * bean_engine_load_plugin:
+ * @engine: A #BeanEngine.
+ * @info: A #BeanPluginInfo.
+ *
+ * Loads the plugin corresponding to @info if it's not currently loaded.
+ * Emits the "load-plugin" signal; loading the plugin
+ * actually occurs in the default signal handler.
+ *
+ * Returns: whether the plugin has been successfully loaded.
+ */
+gboolean
+bean_engine_load_plugin (BeanEngine     *engine,
+                         BeanPluginInfo *info)
+{
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
+  g_return_val_if_fail (info != NULL, FALSE);
+
+  if (bean_plugin_info_is_loaded (info))
+    return TRUE;
+
+  if (!bean_plugin_info_is_available (info, NULL))
+    return FALSE;
+
+  g_signal_emit (engine, signals[LOAD_PLUGIN], 0, info);
+
+  return bean_plugin_info_is_loaded (info);
+}
+
+static void
+bean_engine_unload_plugin_real (BeanEngine     *engine,
+                                BeanPluginInfo *info)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GPtrArray *dependants;
+  BeanPluginLoader *loader;
+
+  if (!bean_plugin_info_is_loaded (info))
+    return;
+
+  /* We set the plugin info as unloaded before trying to unload the
+   * dependants, to make sure we won't have an infinite loop. */
+  info->loaded = FALSE;
+
+  /* First unload all the dependant plugins, only
+   * visiting the plugins that actually depend on it.
+   * The graph's array is copied as the handlers of
+   * unload-plugin could change the graph.
+   */
+  dependants = bean_plugin_graph_get_dependants (priv->plugin_graph, info);
+  if (dependants != NULL)
+    {
+      GPtrArray *copy;
+      guint i;
+
+      copy = g_ptr_array_copy (dependants,
+                               (GCopyFunc) _bean_plugin_info_ref, NULL);
+      g_ptr_array_set_free_func (copy,
+                                 (GDestroyNotify) _bean_plugin_info_unref);
+
+      for (i = copy->len; i > 0; --i)
+        {
+          BeanPluginInfo *other_info = g_ptr_array_index (copy, i - 1);
+
+          if (bean_plugin_info_is_loaded (other_info))
+            bean_engine_unload_plugin (engine, other_info);
+        }
+
+      g_ptr_array_unref (copy);
+    }
+
+  if (info->deferred)
+    {
+      /* Its loader never loaded it */
+      info->deferred = FALSE;
+    }
+  else
+    {
+      /* find the loader and tell it to gc and unload the plugin */
+      loader = get_plugin_loader (engine, info->loader_id);
+
+      bean_plugin_loader_garbage_collect (loader);
+      bean_plugin_loader_unload (loader, info);
+    }
+
+  g_debug ("Unloaded plugin '%s'", bean_plugin_info_get_module_name (info));
+
+  /* Don't notify while in dispose so the
+   * loaded plugins can easily be kept in GSettings
+   */
+  if (!priv->in_dispose)
+    loaded_plugins_changed (engine, info, TRUE);
+}
+
+/**
+ * bean_engine_unload_plugin:
+ * @engine: A #BeanEngine.
+ * @info: A #BeanPluginInfo.
+ *
+ * Unloads the plugin corresponding to @info.
+ * Emits the "unload-plugin" signal; unloading the plugin
+ * actually occurs in the default signal handler.
+ *
+ * Returns: whether the plugin has been successfully unloaded.
+ */
+gboolean
+bean_engine_unload_plugin (BeanEngine     *engine,
+                           BeanPluginInfo *info)
+{
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
+  g_return_val_if_fail (info != NULL, FALSE);
+
+  if (!bean_plugin_info_is_loaded (info))
+    return TRUE;
+
+  g_signal_emit (engine, signals[UNLOAD_PLUGIN], 0, info);
+
+  return !bean_plugin_info_is_loaded (info);
+}
+
+/**
+ * bean_engine_provides_extension:
+ * @engine: A #BeanEngine.
+ * @info: A #BeanPluginInfo.
+ * @extension_type: The extension #GType.
+ *
+ * Returns if @info provides an extension for @extension_type.
+ * If the @info is not loaded than %FALSE will always be returned.
+ *
+ * If #BeanEngine:cache-dir is set, the answer is remembered in the
+ * cache directory so that the plugin does not have to be asked again,
+ * even by later instances of the application, until its plugin file
+ * changes.
+ *
+ * Since libbean 1.22, @extension_type can be an Abstract #GType
+ * and not just an Interface #GType.
+ *
+ * Returns: if @info provides an extension for @extension_type.
+ */
+gboolean
+bean_engine_provides_extension (BeanEngine     *engine,
+                                BeanPluginInfo *info,
+                                GType           extension_type)
+{
+  BeanPluginLoader *loader;
+  BeanProviderIndex *providers;
+  BeanProviderState state = BEAN_PROVIDER_UNKNOWN;
+  gchar *module_filename = NULL;
+  gboolean provided;
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
+  g_return_val_if_fail (info != NULL, FALSE);
+  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
+                        G_TYPE_IS_ABSTRACT (extension_type), FALSE);
+
+  if (!bean_plugin_info_is_loaded (info))
+    return FALSE;
+
+  /* Asking the loader can mean calling into an interpreter */
+  providers = get_provider_index (engine, info);
+  if (providers != NULL)
+    {
+      /* What is provided is decided by the module, not the plugin file */
+      module_filename = _bean_plugin_info_get_module_filename (info);
+      state = bean_provider_index_lookup (providers, info->filename,
+                                          module_filename,
+                                          g_type_name (extension_type));
+    }
+
+  /* Only load a deferred plugin if it is going to be used */
+  if (state == BEAN_PROVIDER_NOT_PROVIDED ||
+      (info->deferred &&
+       ((state == BEAN_PROVIDER_UNKNOWN &&
+         !plugin_provides_type (info, extension_type)) ||
+        !load_deferred_plugin (engine, info))))
+    {
+      provided = FALSE;
+    }
+  else if (state == BEAN_PROVIDER_PROVIDED)
+    {
+      provided = TRUE;
+    }
+  else
+    {
+      loader = get_plugin_loader (engine, info->loader_id);
+      provided = bean_plugin_loader_provides_extension (loader, info,
+                                                        extension_type);
+
+      if (providers != NULL)
+        bean_provider_index_record (providers, info->filename,
+                                    module_filename,
+                                    g_type_name (extension_type), provided);
+    }
+
+  g_free (module_filename);
+  return provided;
+}
+
+/**
+ * bean_engine_create_extensionv: (skip)
+ * @engine: A #BeanEngine.
+ * @info: A loaded #BeanPluginInfo.
+ * @extension_type: The implemented extension #GType.
+ * @n_properties: the length of the @prop_names and @prop_values arrays.
+ * @prop_names: (allow-none) (array length=n_properties): an array of property names.
+ * @prop_values: (allow-none) (array length=n_properties): an array of #GValue.
+ *
+ * If the plugin identified by @info implements the @extension_type,
+ * then this function will return a new instance of this implementation,
+ * wrapped in a new #BeanExtension instance. Otherwise, it will return %NULL.
+ *
+ * Since libbean 1.22, @extension_type can be an Abstract #GType
+ * and not just an Interface #GType.
+ *
+ * See bean_engine_create_extension() for more information.
+ *
+ * Returns: (transfer full): a new instance of #BeanExtension wrapping
+ * the @extension_type instance, or %NULL.
+ */
+BeanExtension *
+bean_engine_create_extensionv (BeanEngine     *engine,
+                               BeanPluginInfo *info,
+                               GType           extension_type,
+                               guint           n_properties,
+                               const gchar   **prop_names,
+                               GValue         *prop_values)
+{
+  BeanPluginLoader *loader;
+  BeanExtension *extension;
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
+                        G_TYPE_IS_ABSTRACT (extension_type), NULL);
+  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
+
+  if (info->deferred)
+    {
+      if (!plugin_provides_type (info, extension_type))
+        {
+          g_warning ("Plugin '%s' does not provide a '%s' extension",
+                     bean_plugin_info_get_module_name (info),
+                     g_type_name (extension_type));
+          return NULL;
+        }
+
+      if (!load_deferred_plugin (engine, info))
+        return NULL;
+    }
+
+  loader = get_plugin_loader (engine, info->loader_id);
+  extension = bean_plugin_loader_create_extension (loader, info, extension_type,
+                                                   n_properties, prop_names, prop_values);
+
+  if (!G_TYPE_CHECK_INSTANCE_TYPE (extension, extension_type))
+    {
+      g_warning ("Plugin '%s' does not provide a '%s' extension",
+                 bean_plugin_info_get_module_name (info),
+                 g_type_name (extension_type));
+      return NULL;
+    }
+
+  return extension;
+}
+
+/**
+ * bean_engine_create_extension_with_properties: (rename-to bean_engine_create_extension)
+ * @engine: A #BeanEngine.
+ * @info: A loaded #BeanPluginInfo.
+ * @extension_type: The implemented extension #GType.
+ * @n_properties: the length of the @prop_names and @prop_values array.
+ * @prop_names: (array length=n_properties): an array of property names.
+ * @prop_values: (array length=n_properties): an array of property values.
+ *
+ * If the plugin identified by @info implements the @extension_type,
+ * then this function will return a new instance of this implementation,
+ * wrapped in a new #BeanExtension instance. Otherwise, it will return %NULL.
+ *
+ * Since libbean 1.22, @extension_type can be an Abstract #GType
+ * and not just an Interface #GType.
+ *
+ * See bean_engine_create_extension() for more information.
+ *
+ * Returns: (transfer full): a new instance of #BeanExtension wrapping
+ * the @extension_type instance, or %NULL.
+ *
+ * Since: 1.24
+ */
+BeanExtension *
+bean_engine_create_extension_with_properties (BeanEngine     *engine,
+                                              BeanPluginInfo *info,
+                                              GType           extension_type,
+                                              guint           n_properties,
+                                              const gchar   **prop_names,
+                                              const GValue   *prop_values)
+{
+  BeanExtension *extension;
+  const gchar **out_names = NULL;
+  GValue *out_values = NULL;
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
+                        G_TYPE_IS_ABSTRACT (extension_type), NULL);
+  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
+  g_return_val_if_fail (n_properties == 0 || prop_names != NULL, NULL);
+  g_return_val_if_fail (n_properties == 0 || prop_values != NULL, NULL);
+
+  if (n_properties > 0)
+    {
+      if (!bean_utils_properties_array_to_parameter_list (extension_type, n_properties,
+                                                          prop_names, prop_values,
+                                                          &out_names, &out_values))
+        {
+          /* Already warned */
+          return NULL;
+        }
+    }
+
+  extension = bean_engine_create_extensionv (engine, info, extension_type,
+                                             n_properties, out_names, out_values);
+
+  if (out_values != NULL)
+    {
+      for (guint i = 0; i < n_properties; i++)
+        g_value_unset (&out_values[i]);
+      g_free (out_names);
+      g_free (out_values);
+    }
+
+  if (!G_TYPE_CHECK_INSTANCE_TYPE (extension, extension_type))
+    {
+      g_warning ("Plugin '%s' does not provide a '%s' extension",
+                 bean_plugin_info_get_module_name (info),
+                 g_type_name (extension_type));
+      return NULL;
+    }
+
+  return extension;
+}
+
+/**
+ * bean_engine_create_extension_valist: (skip)
+ * @engine: A #BeanEngine.
+ * @info: A loaded #BeanPluginInfo.
+ * @extension_type: The implemented extension #GType.
+ * @first_property: the name of the first property.
+ * @var_args: the value of the first property, followed optionally by more
+ *   name/value pairs, followed by %NULL.
+ *
+ * If the plugin identified by @info implements the @extension_type,
+ * then this function will return a new instance of this implementation,
+ * wrapped in a new #BeanExtension instance. Otherwise, it will return %NULL.
+ *
+ * Since libbean 1.22, @extension_type can be an Abstract #GType
+ * and not just an Interface #GType.
+ *
+ * See bean_engine_create_extension() for more information.
+ *
+ * Returns: a new instance of #BeanExtension wrapping
+ * the @extension_type instance, or %NULL.
+ */
+BeanExtension *
+bean_engine_create_extension_valist (BeanEngine     *engine,
+                                     BeanPluginInfo *info,
+                                     GType           extension_type,
+                                     const gchar    *first_property,
+                                     va_list         var_args)
+{
+  const gchar **prop_names;
+  GValue *prop_values;
+  guint n_properties;
+
+  BeanExtension *exten;
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
+  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
+                        G_TYPE_IS_ABSTRACT (extension_type), FALSE);
+
+  if (!bean_utils_valist_to_parameter_list (extension_type, first_property, var_args,
+                                            &prop_names, &prop_values, &n_properties))
+    {
+      /* Already warned */
+      return NULL;
+    }
+
+  exten = bean_engine_create_extensionv (engine, info, extension_type,
+                                         n_properties, prop_names, prop_values);
+
+  for (guint i = 0; i < n_properties; i++)
+    g_value_unset (&prop_values[i]);
+  g_free (prop_names);
+  g_free (prop_values);
+
+  return exten;
+}
+
+/**
+ * bean_engine_create_extension: (skip)
+ * @engine: A #BeanEngine.
+ * @info: A loaded #BeanPluginInfo.
+ * @extension_type: The implemented extension #GType.
+ * @first_property: the name of the first property.
+ * @...: the value of the first property, followed optionally by more
+ *   name/value pairs, followed by %NULL.
+ *
+ * If the plugin identified by @info implements the @extension_type,
+ * then this function will return a new instance of this implementation,
+ * wrapped in a new #BeanExtension instance. Otherwise, it will return %NULL.
+ *
+ * When creating the new instance of the @extension_type subtype, the
+ * provided construct properties will be passed to the extension construction
+ * handler (exactly like if you had called g_object_new() yourself).
+ *
+ * The new extension instance produced by this function will always be
+ * returned wrapped in a #BeanExtension proxy, following the current libbean
+ * principle of never giving you the actual object (also because it might as
+ * well *not* be an actual object).
+ *
+ * Since libbean 1.22, @extension_type can be an Abstract #GType
+ * and not just an Interface #GType.
+ *
+ * Returns: a new instance of #BeanExtension wrapping
+ * the @extension_type instance, or %NULL.
+ */
+BeanExtension *
+bean_engine_create_extension (BeanEngine     *engine,
+                              BeanPluginInfo *info,
+                              GType           extension_type,
+                              const gchar    *first_property,
+                              ...)
+{
+  va_list var_args;
+  BeanExtension *exten;
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
+  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
+                        G_TYPE_IS_ABSTRACT (extension_type), FALSE);
+
+  va_start (var_args, first_property);
+  exten = bean_engine_create_extension_valist (engine, info, extension_type,
+                                               first_property, var_args);
+  va_end (var_args);
+
+  return exten;
+}
+
+/**
+ * BeanExtensionFactory:
+ *
+ * A #BeanExtensionFactory creates extensions of a given type from
+ * a given plugin, see bean_engine_create_extension_factory().
+ *
+ * Since: 2.4
+ */
+struct _BeanExtensionFactory {
+  gint ref_count;
+
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  GType extension_type;
+
+  /* G_TYPE_INVALID if the extensions are created by the loader */
+  GType impl_type;
+  GValue plugin_info;
+};
+
+G_DEFINE_BOXED_TYPE (BeanExtensionFactory, bean_extension_factory,
+                     bean_extension_factory_ref,
+                     bean_extension_factory_unref)
+
+/**
+ * bean_engine_create_extension_factory:
+ * @engine: A #BeanEngine.
+ * @info: A loaded #BeanPluginInfo.
+ * @extension_type: The implemented extension #GType.
+ *
+ * Creates a #BeanExtensionFactory which creates @extension_type
+ * extensions from the plugin identified by @info, like
+ * bean_engine_create_extension_with_properties() does.
+ *
+ * Whether the plugin provides @extension_type and how to create its
+ * extensions is only looked up once. When the extension is a #GObject
+ * type registered with bean_object_module_register_extension_type() by
+ * a C plugin, bean_extension_factory_create() then directly creates
+ * an instance of it. This should be used when many extensions are
+ * created from the same plugin, for instance one per document.
+ *
+ * Returns: (transfer full) (nullable): a new #BeanExtensionFactory,
+ * or %NULL if the plugin does not provide @extension_type.
+ *
+ * Since: 2.4
+ */
+BeanExtensionFactory *
+bean_engine_create_extension_factory (BeanEngine     *engine,
+                                      BeanPluginInfo *info,
+                                      GType           extension_type)
+{
+  BeanExtensionFactory *factory;
+  gboolean has_plugin_info = FALSE;
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
+                        G_TYPE_IS_ABSTRACT (extension_type), NULL);
+  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
+
+  /* Also loads the plugin if it was deferred */
+  if (!bean_engine_provides_extension (engine, info, extension_type))
+    return NULL;
+
+  factory = g_new0 (BeanExtensionFactory, 1);
+  factory->ref_count = 1;
+  factory->engine = g_object_ref (engine);
+  factory->info = _bean_plugin_info_ref (info);
+  factory->extension_type = extension_type;
+
+  /* C modules are resident, so their types stay valid */
+  if (info->loader_id == BEAN_UTILS_C_LOADER_ID && info->loader_data != NULL)
+    {
+      factory->impl_type =
+        _bean_object_module_get_implementation_type (info->loader_data,
+                                                     extension_type,
+                                                     &has_plugin_info);
+    }
+
+  if (has_plugin_info)
+    {
+      g_value_init (&factory->plugin_info, BEAN_TYPE_PLUGIN_INFO);
+      g_value_set_boxed (&factory->plugin_info, info);
+    }
+
+  return factory;
+}
+
+/**
+ * bean_extension_factory_ref:
+ * @factory: A #BeanExtensionFactory.
+ *
+ * Increases the reference count of @factory.
+ *
+ * Returns: (transfer full): @factory.
+ *
+ * Since: 2.4
+ */
+BeanExtensionFactory *
+bean_extension_factory_ref (BeanExtensionFactory *factory)
+{
+  g_return_val_if_fail (factory != NULL, NULL);
+
+  g_atomic_int_inc (&factory->ref_count);
+  return factory;
+}
+
+/**
+ * bean_extension_factory_unref:
+ * @factory: A #BeanExtensionFactory.
+ *
+ * Decreases the reference count of @factory,
+ * freeing it when it reaches zero.
+ *
+ * Since: 2.4
+ */
+void
+bean_extension_factory_unref (BeanExtensionFactory *factory)
+{
+  g_return_if_fail (factory != NULL);
+
+  if (!g_atomic_int_dec_and_test (&factory->ref_count))
+    return;
+
+  if (G_IS_VALUE (&factory->plugin_info))
+    g_value_unset (&factory->plugin_info);
+
+  _bean_plugin_info_unref (factory->info);
+  g_object_unref (factory->engine);
+  g_free (factory);
+}
+
+/**
+ * bean_extension_factory_create:
+ * @factory: A #BeanExtensionFactory.
+ * @n_properties: the length of the @prop_names and @prop_values array.
+ * @prop_names: (array length=n_properties): an array of property names.
+ * @prop_values: (array length=n_properties): an array of property values.
+ *
+ * Creates a new extension, like bean_engine_create_extension_with_properties()
+ * but without looking up again how to create it. The plugin must still
+ * be loaded.
+ *
+ * When the extension is created directly, the properties are
+ * not checked against the extension type beforehand, as
+ * g_object_new_with_properties() already warns about them.
+ *
+ * Returns: (transfer full): a new instance of #BeanExtension wrapping
+ * the extension instance, or %NULL.
+ *
+ * Since: 2.4
+ */
+BeanExtension *
+bean_extension_factory_create (BeanExtensionFactory  *factory,
+                               guint                  n_properties,
+                               const gchar          **prop_names,
+                               const GValue          *prop_values)
+{
+  const gchar **exten_names;
+  GValue *exten_values;
+  guint n_exten_properties = n_properties;
+  GObject *instance;
+
+  g_return_val_if_fail (factory != NULL, NULL);
+  g_return_val_if_fail (bean_plugin_info_is_loaded (factory->info), NULL);
+  g_return_val_if_fail (n_properties == 0 || prop_names != NULL, NULL);
+  g_return_val_if_fail (n_properties == 0 || prop_values != NULL, NULL);
 
-  /**
-   * BeanEngine:plugin-list:
-   *
-   * The list of found plugins.
-   *
-   * This will be modified when bean_engine_rescan_plugins() is called.
-   *
-   * Note: the list belongs to the engine and should not be modified or freed.
-   */
-  properties[PROP_PLUGIN_LIST] =
-    g_param_spec_pointer ("plugin-list",
-                          "Plugin list",
-                          "The list of found plugins",
-                          G_PARAM_READABLE |
-                          G_PARAM_STATIC_STRINGS);
+  if (factory->impl_type == G_TYPE_INVALID || factory->info->deferred)
+    {
+      return bean_engine_create_extension_with_properties (factory->engine,
+                                                           factory->info,
+                                                           factory->extension_type,
+                                                           n_properties,
+                                                           prop_names,
+                                                           prop_values);
+    }
 
-  /**
-   * BeanEngine:loaded-plugins:
-   *
-   * The list of loaded plugins.
-   *
-   * This will be modified when bean_engine_load_plugin() or
-   * bean_engine_unload_plugin() is called.
-   *
-   * This can be used with GSettings to save the loaded plugins by binding
-   * to this property after instantiating the engine by doing:
-   * |[
-   *   g_settings_bind (gsettings_object,
-   *                    LOADED_PLUGINS_KEY,
-   *                    engine,
-   *                    "loaded-plugins",
-   *                    G_SETTINGS_BIND_DEFAULT);
-   * ]|
-   *
-   * Note: notify will not be called when the engine is being destroyed.
+  /* Like the C plugin loader, the values are only copied shallowly
+   * as they outlive this call, and "plugin-info" is appended
    */
-  properties[PROP_LOADED_PLUGINS] =
-    g_param_spec_boxed ("loaded-plugins",
-                        "Loaded plugins",
-                        "The list of loaded plugins",
-                        G_TYPE_STRV,
-                        G_PARAM_READWRITE |
-                        G_PARAM_STATIC_STRINGS);
+  exten_names = g_newa (const gchar *, n_properties + 1);
+  exten_values = g_newa (GValue, n_properties + 1);
 
-  /**
-   * BeanEngine:nonglobal-loaders:
-   *
-   * If non-global plugin loaders should be used.
-   *
-   * See bean_engine_new_with_nonglobal_loaders() for more information.
-   *
-   * Since: 1.14
+  if (n_properties > 0)
+    {
+      memcpy (exten_names, prop_names, sizeof (gchar *) * n_properties);
+      memcpy (exten_values, prop_values, sizeof (GValue) * n_properties);
+    }
+
+  if (G_IS_VALUE (&factory->plugin_info))
+    {
+      exten_names[n_exten_properties] = "plugin-info";
+      exten_values[n_exten_properties] = factory->plugin_info;
+      n_exten_properties++;
+    }
+
+  instance = g_object_new_with_properties (factory->impl_type,
+                                           n_exten_properties,
+                                           exten_names, exten_values);
+
+  _bean_extension_set_extension_type (instance, factory->extension_type);
+
+  return instance;
+}
+
+/**
+ * bean_engine_get_loaded_plugins:
+ * @engine: A #BeanEngine.
+ *
+ * Returns the list of the names of all the loaded plugins, or an array
+ * containing a single %NULL element if there is no plugin currently loaded.
+ *
+ * Please note that the returned array is a newly allocated one: you will need
+ * to free it using g_strfreev().
+ *
+ * Returns: (transfer full) (array zero-terminated=1): A newly-allocated
+ * %NULL-terminated array of strings.
+ */
+gchar **
+bean_engine_get_loaded_plugins (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  GArray *array;
+  GList *pl;
+
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
+
+  array = g_array_new (TRUE, FALSE, sizeof (gchar *));
+
+  pl = bean_plugin_graph_get_sorted (priv->plugin_graph)->head;
+  for (; pl != NULL; pl = pl->next)
+    {
+      BeanPluginInfo *info = (BeanPluginInfo *) pl->data;
+      gchar *module_name;
+
+      if (bean_plugin_info_is_loaded (info))
+        {
+          module_name = g_strdup (bean_plugin_info_get_module_name (info));
+          g_array_append_val (array, module_name);
+        }
+    }
+
+  return (gchar **) g_array_free (array, FALSE);
+}
+
+/* These are reported when the plugin fails to load */
+static gboolean
+has_missing_dependencies (BeanEngine     *engine,
+                          BeanPluginInfo *info)
+{
+  const gchar **dependencies;
+  guint i;
+
+  dependencies = bean_plugin_info_get_dependencies (info);
+
+  for (i = 0; dependencies[i] != NULL; ++i)
+    {
+      if (bean_engine_get_plugin_info (engine, dependencies[i]) == NULL)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+typedef struct {
+  BeanEngine *engine;
+  BeanPluginLoaderC *cloader;
+  BeanLoadProfile *profile;
+} PreloadData;
+
+static void
+preload_plugin (BeanPluginInfo *info,
+                PreloadData    *data)
+{
+  BeanLoadTiming timing;
+
+  if (data->profile != NULL)
+    bean_load_timing_start (&timing);
+
+  bean_plugin_loader_c_preload (data->cloader, info);
+
+  /* Only recorded once the plugin is actually loaded, which
+   * then also gets the times of the phases from its module
    */
-  properties[PROP_NONGLOBAL_LOADERS] =
-    g_param_spec_boolean ("nonglobal-loaders",
-                          "Non-global Loaders",
-                          "Use non-global plugin loaders",
-                          FALSE,
-                          G_PARAM_READWRITE |
-                          G_PARAM_CONSTRUCT_ONLY |
-                          G_PARAM_STATIC_STRINGS);
+  if (data->profile != NULL)
+    {
+      bean_load_timing_stop (&timing);
+      stash_load_timing (data->engine, info, &timing);
+    }
+}
 
-  /**
-   * BeanEngine::load-plugin:
-   * @engine: A #BeanEngine.
-   * @info: A #BeanPluginInfo.
-   *
-   * The load-plugin signal is emitted when a plugin is being loaded.
-   *
-   * The plugin is being loaded in the default handler. Hence, if you want to
-   * perform some action before the plugin is loaded, you should use
-   * g_signal_connect(), but if you want to perform some action *after* the
-   * plugin is loaded (the most common case), you should use
-   * g_signal_connect_after().
+/* The plugins which took the longest to load come first */
+static gint
+compare_load_durations (gconstpointer a,
+                        gconstpointer b,
+                        gpointer      user_data)
+{
+  BeanLoadProfile *profile = user_data;
+  const BeanPluginInfo *info_a = *(BeanPluginInfo * const *) a;
+  const BeanPluginInfo *info_b = *(BeanPluginInfo * const *) b;
+  gint64 duration_a, duration_b;
+
+  duration_a = bean_load_profile_get_duration (profile, info_a->module_name);
+  duration_b = bean_load_profile_get_duration (profile, info_b->module_name);
+
+  return duration_a < duration_b ? 1 : duration_a > duration_b ? -1 : 0;
+}
+
+/* The plugins are sorted like they were loaded,
+ * the ones which were not come last
+ */
+static gint
+compare_load_positions (gconstpointer a,
+                        gconstpointer b,
+                        gpointer      user_data)
+{
+  BeanLoadProfile *profile = user_data;
+  const BeanPluginInfo *info_a = *(BeanPluginInfo * const *) a;
+  const BeanPluginInfo *info_b = *(BeanPluginInfo * const *) b;
+  guint position_a, position_b;
+
+  /* -1 becomes the largest position */
+  position_a = bean_load_profile_get_position (profile, info_a->module_name);
+  position_b = bean_load_profile_get_position (profile, info_b->module_name);
+
+  return position_a < position_b ? -1 : position_a > position_b ? 1 : 0;
+}
+
+/* Returns the plugins to preload grouped by their dependency level,
+ * only C plugins whose dependencies are all either loaded or
+ * preloaded as well can be preloaded
+ */
+static GPtrArray *
+get_preload_levels (BeanEngine *engine,
+                    GHashTable *requested)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  const GQueue *sorted;
+  GHashTable *levels;
+  GPtrArray *preload_levels;
+  GList *pl;
+
+  sorted = bean_plugin_graph_get_sorted (priv->plugin_graph);
+  levels = g_hash_table_new (NULL, NULL);
+
+  /* Dependencies are sorted before their dependants, so walking
+   * backwards finds every plugin which is going to be loaded
    */
-  signals[LOAD_PLUGIN] =
-    g_signal_new (I_("load-plugin"),
-                  the_type,
-                  G_SIGNAL_RUN_LAST,
-                  G_STRUCT_OFFSET (BeanEngineClass, load_plugin),
-                  NULL, NULL,
-                  g_cclosure_marshal_VOID__BOXED,
-                  G_TYPE_NONE,
-                  1,
-                  BEAN_TYPE_PLUGIN_INFO |
-                  G_SIGNAL_TYPE_STATIC_SCOPE);
+  for (pl = sorted->tail; pl != NULL; pl = pl->prev)
+    {
+      BeanPluginInfo *info = (BeanPluginInfo *) pl->data;
+      GPtrArray *deps;
+      guint i;
 
-  /**
-   * BeanEngine::unload-plugin:
-   * @engine: A #BeanEngine.
-   * @info: A #BeanPluginInfo.
-   *
-   * The unload-plugin signal is emitted when a plugin is being unloaded.
-   *
-   * The plugin is being unloaded in the default handler. Hence, if you want
-   * to perform some action before the plugin is unloaded (the most common
-   * case), you should use g_signal_connect(), but if you want to perform some
-   * action after the plugin is unloaded (the most common case), you should
-   * use g_signal_connect_after().
+      if (bean_plugin_info_is_loaded (info) ||
+          (!g_hash_table_contains (levels, info) &&
+           !g_hash_table_contains (requested, info->module_name)))
+        continue;
+
+      g_hash_table_insert (levels, info, GUINT_TO_POINTER (0));
+
+      deps = bean_plugin_graph_get_dependencies (priv->plugin_graph, info);
+      for (i = 0; i < deps->len; ++i)
+        g_hash_table_insert (levels, g_ptr_array_index (deps, i),
+                             GUINT_TO_POINTER (0));
+    }
+
+  preload_levels =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+
+  /* A level of 0 means that the plugin cannot be preloaded,
+   * which is also the case for dependencies which are part
+   * of a cycle as they are not sorted before their dependants
    */
-  signals[UNLOAD_PLUGIN] =
-    g_signal_new (I_("unload-plugin"),
-                  the_type,
-                  G_SIGNAL_RUN_LAST,
-                  G_STRUCT_OFFSET (BeanEngineClass, unload_plugin),
-                  NULL, NULL,
-                  g_cclosure_marshal_VOID__BOXED,
-                  G_TYPE_NONE,
-                  1, BEAN_TYPE_PLUGIN_INFO |
-                  G_SIGNAL_TYPE_STATIC_SCOPE);
+  for (pl = sorted->head; pl != NULL; pl = pl->next)
+    {
+      BeanPluginInfo *info = (BeanPluginInfo *) pl->data;
+      GPtrArray *deps;
+      guint i, level = 1;
 
-  g_object_class_install_properties (object_class, N_PROPERTIES, properties);
+      if (!g_hash_table_contains (levels, info) ||
+          bean_plugin_info_is_loaded (info))
+        continue;
+
+      if (info->loader_id != BEAN_UTILS_C_LOADER_ID ||
+          !bean_plugin_info_is_available (info, NULL) ||
+          can_defer_plugin (engine, info))
+        continue;
+
+      deps = bean_plugin_graph_get_dependencies (priv->plugin_graph, info);
+      for (i = 0; i < deps->len && level > 0; ++i)
+        {
+          BeanPluginInfo *dep_info = g_ptr_array_index (deps, i);
+          guint dep_level;
+
+          if (bean_plugin_info_is_loaded (dep_info))
+            continue;
+
+          dep_level = GPOINTER_TO_UINT (g_hash_table_lookup (levels,
+                                                             dep_info));
+          level = dep_level > 0 ? MAX (level, dep_level + 1) : 0;
+        }
+
+      if (level == 0 || has_missing_dependencies (engine, info))
+        continue;
+
+      g_hash_table_insert (levels, info, GUINT_TO_POINTER (level));
+
+      while (preload_levels->len < level)
+        g_ptr_array_add (preload_levels, g_ptr_array_new ());
+
+      g_ptr_array_add (g_ptr_array_index (preload_levels, level - 1), info);
+    }
+
+  g_hash_table_unref (levels);
+
+  return preload_levels;
+}
+
+/* Opens the modules of the C plugins about to be loaded level by
+ * level, so that they are only looked up by the C loader when the
+ * plugins are then loaded as usual
+ */
+static void
+preload_plugins (BeanEngine *engine,
+                 GHashTable *requested)
+{
+  PreloadData data;
+  GPtrArray *preload_levels;
+  guint i, j;
+
+  preload_levels = get_preload_levels (engine, requested);
+
+  if (preload_levels->len == 0)
+    {
+      g_ptr_array_unref (preload_levels);
+      return;
+    }
+
+  data.engine = engine;
+  data.cloader = BEAN_PLUGIN_LOADER_C (get_plugin_loader (engine,
+                                                          BEAN_UTILS_C_LOADER_ID));
+  data.profile = get_load_profile (engine);
+
+  for (i = 0; i < preload_levels->len; ++i)
+    {
+      GPtrArray *infos = g_ptr_array_index (preload_levels, i);
+      GThreadPool *pool = NULL;
+
+      /* So that the longest ones do not start last */
+      if (data.profile != NULL)
+        g_ptr_array_sort_with_data (infos, compare_load_durations,
+                                    data.profile);
+
+      if (infos->len > 1)
+        {
+          pool = g_thread_pool_new ((GFunc) preload_plugin, &data,
+                                    MIN (g_get_num_processors (), infos->len),
+                                    FALSE, NULL);
+        }
+
+      for (j = 0; j < infos->len; ++j)
+        {
+          BeanPluginInfo *info = g_ptr_array_index (infos, j);
+
+          /* Open it ourselves if a thread could not be spawned */
+          if (pool == NULL || !g_thread_pool_push (pool, info, NULL))
+            preload_plugin (info, &data);
+        }
 
-  /* We don't support calling BeanEngine API without module support */
-  if (!g_module_supported ())
-    {
-      g_error ("libbean is not able to create the "
-               "plugins engine as modules are not supported.");
+      /* The next level depends on this one */
+      if (pool != NULL)
+        g_thread_pool_free (pool, FALSE, TRUE);
     }
 
-  /* We are doing some global initialization here as there is currently no
-   * global init function for libbean. */
-  bean_debug_init ();
+  g_ptr_array_unref (preload_levels);
+}
 
-  /* This cannot be done as a compile-time
-   * assert, but is critical for correct behavior
-   */
-  g_assert (g_strcmp0 (bean_utils_get_loader_from_id (BEAN_UTILS_C_LOADER_ID),
-                       "c") == 0);
+static void
+prefetch_file (const gchar *filename)
+{
+#ifdef HAVE_POSIX_FADVISE
+  gint fd;
 
-  /* The C plugin loader is always enabled */
-  loaders[BEAN_UTILS_C_LOADER_ID].enabled = TRUE;
+  fd = g_open (filename, O_RDONLY, 0);
+  if (fd < 0)
+    return;
+
+  /* This only starts reading it */
+  posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+  g_close (fd, NULL);
+#else
+  FILE *file;
+  gchar buffer[64 * 1024];
+
+  file = g_fopen (filename, "rb");
+  if (file == NULL)
+    return;
+
+  while (fread (buffer, 1, sizeof (buffer), file) == sizeof (buffer))
+    ;
+
+  fclose (file);
+#endif
 }
 
-static BeanObjectModule *
-get_plugin_loader_module (gint loader_id)
+/* Prefetches the files of @path whose names start with @prefix */
+static void
+prefetch_dir (const gchar *path,
+              const gchar *prefix)
 {
-  GlobalLoaderInfo *global_loader_info = &loaders[loader_id];
-  const gchar *loader_name, *module_name;
-  gchar *module_dir;
+  GDir *dir;
+  const gchar *name;
 
-  if (global_loader_info->module != NULL)
-    return global_loader_info->module;
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
 
-  loader_name = bean_utils_get_loader_from_id (loader_id);
-  module_name = bean_utils_get_loader_module_from_id (loader_id);
-  module_dir = bean_dirs_get_plugin_loader_dir (loader_name);
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *filename;
 
-  /* Bind loaders globally, binding
-   * locally can break the plugin loaders
-   */
-  global_loader_info->module = bean_object_module_new_full (module_name,
-                                                            module_dir,
-                                                            TRUE, FALSE);
+      if (prefix != NULL && !g_str_has_prefix (name, prefix))
+        continue;
 
-  if (!g_type_module_use (G_TYPE_MODULE (global_loader_info->module)))
-    {
-      g_warning ("Could not load plugin loader '%s'", loader_name);
-      g_clear_object (&global_loader_info->module);
-    }
+      filename = g_build_filename (path, name, NULL);
 
-  g_free (module_dir);
+      if (g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+        prefetch_file (filename);
 
-  return global_loader_info->module;
+      g_free (filename);
+    }
+
+  g_dir_close (dir);
 }
 
-static BeanPluginLoader *
-create_plugin_loader (gint loader_id)
+/* Prefetches what the loader of the plugin reads to load it */
+static void
+prefetch_plugin (BeanPluginInfo *info)
 {
-  BeanPluginLoader *loader;
+  const gchar *loader_name;
+  const gchar *suffix = NULL;
+  gchar *filename, *package_dir;
 
-  if (loader_id == BEAN_UTILS_C_LOADER_ID)
+  if (info->loader_id == BEAN_UTILS_C_LOADER_ID)
     {
-      loader = bean_plugin_loader_c_new ();
+      filename = g_module_build_path (info->module_dir, info->module_name);
+      prefetch_file (filename);
+      g_free (filename);
+      return;
     }
+
+  loader_name = bean_utils_get_loader_from_id (info->loader_id);
+
+  if (g_str_has_prefix (loader_name, "python"))
+    suffix = ".py";
+  else if (g_str_has_prefix (loader_name, "lua"))
+    suffix = ".lua";
   else
+    return;
+
+  /* A module can also be a package directory */
+  package_dir = g_build_filename (info->module_dir, info->module_name, NULL);
+
+  if (g_file_test (package_dir, G_FILE_TEST_IS_DIR))
     {
-      BeanObjectModule *module;
+      gchar *cache_dir;
 
-      module = get_plugin_loader_module (loader_id);
-      if (module == NULL)
-        return NULL;
+      prefetch_dir (package_dir, NULL);
 
-      loader = BEAN_PLUGIN_LOADER (
-            bean_object_module_create_object (module,
-                                              BEAN_TYPE_PLUGIN_LOADER,
-                                              0, NULL, NULL));
+      cache_dir = g_build_filename (package_dir, "__pycache__", NULL);
+      prefetch_dir (cache_dir, NULL);
+      g_free (cache_dir);
     }
-
-  if (loader == NULL || !bean_plugin_loader_initialize (loader))
+  else
     {
-      g_warning ("Loader '%s' is not a valid BeanPluginLoader instance",
-                 bean_utils_get_loader_from_id (loader_id));
-      g_clear_object (&loader);
+      gchar *basename, *cache_dir;
+
+      basename = g_strconcat (info->module_name, suffix, NULL);
+      filename = g_build_filename (info->module_dir, basename, NULL);
+      prefetch_file (filename);
+
+      /* The compiled module, of whichever Python version */
+      cache_dir = g_build_filename (info->module_dir, "__pycache__", NULL);
+      g_free (basename);
+      basename = g_strconcat (info->module_name, ".", NULL);
+      prefetch_dir (cache_dir, basename);
+
+      g_free (cache_dir);
+      g_free (filename);
+      g_free (basename);
     }
 
-  return loader;
+  g_free (package_dir);
 }
 
-static BeanPluginLoader *
-get_local_plugin_loader (BeanEngine *engine,
-                         gint        loader_id)
+static gpointer
+prefetch_plugins_thread (PrefetchData *data)
 {
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-  GlobalLoaderInfo *global_loader_info = &loaders[loader_id];
-  BeanPluginLoader *loader;
-
-  if (global_loader_info->failed)
-    return NULL;
+  guint i;
 
-  if (global_loader_info->loader != NULL &&
-      (!priv->use_nonglobal_loaders ||
-       bean_plugin_loader_is_global (global_loader_info->loader)))
+  for (i = 0; i < data->infos->len; ++i)
     {
-      return g_object_ref (global_loader_info->loader);
+      if (g_atomic_int_get (&data->cancelled))
+        break;
+
+      prefetch_plugin (g_ptr_array_index (data->infos, i));
     }
 
-  loader = create_plugin_loader (loader_id);
+  return NULL;
+}
 
-  if (loader == NULL)
-    {
-      global_loader_info->failed = TRUE;
-      return NULL;
-    }
+static void
+prefetch_data_free (PrefetchData *data)
+{
+  g_ptr_array_unref (data->infos);
+  g_free (data);
+}
 
-  if (!priv->use_nonglobal_loaders ||
-      bean_plugin_loader_is_global (loader))
-    {
-      global_loader_info->loader = g_object_ref (loader);
-    }
+/* Stops prefetching after the current plugin and waits for it */
+static void
+stop_prefetch (BeanEngine *engine)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
 
-  return loader;
+  if (priv->prefetch_thread == NULL)
+    return;
+
+  g_atomic_int_set (&priv->prefetch_data->cancelled, TRUE);
+  g_thread_join (g_steal_pointer (&priv->prefetch_thread));
+
+  prefetch_data_free (g_steal_pointer (&priv->prefetch_data));
 }
 
-static BeanPluginLoader *
-get_plugin_loader (BeanEngine *engine,
-                   gint        loader_id)
+/* Adds the plugin and the dependencies which are not loaded yet */
+static void
+collect_prefetch_plugins (BeanEngine     *engine,
+                          BeanPluginInfo *info,
+                          GHashTable     *visited,
+                          GPtrArray      *infos)
 {
   BeanEnginePrivate *priv = GET_PRIV (engine);
-  LoaderInfo *loader_info = &priv->loaders[loader_id];
-  GlobalLoaderInfo *global_loader_info = &loaders[loader_id];
+  GPtrArray *deps;
+  guint i;
 
-  if (loader_info->loader != NULL || loader_info->failed)
-    return loader_info->loader;
+  if (bean_plugin_info_is_loaded (info) ||
+      !bean_plugin_info_is_available (info, NULL) ||
+      !g_hash_table_add (visited, info))
+    return;
 
-  g_mutex_lock (&loaders_lock);
+  deps = bean_plugin_graph_get_dependencies (priv->plugin_graph, info);
+  for (i = 0; i < deps->len; ++i)
+    collect_prefetch_plugins (engine, g_ptr_array_index (deps, i),
+                              visited, infos);
 
-  if (!loader_info->enabled)
-    {
-      if (!global_loader_info->enabled)
-        {
-          g_warning ("The '%s' plugin loader has not been enabled",
-                     bean_utils_get_loader_from_id (loader_id));
+  if (info->embedded == NULL && !can_defer_plugin (engine, info) &&
+      !g_str_has_prefix (info->module_dir, "resource://"))
+    g_ptr_array_add (infos, _bean_plugin_info_ref (info));
+}
 
-          g_mutex_unlock (&loaders_lock);
-          return NULL;
-        }
+/* Starts reading the modules of the plugins about to be loaded,
+ * dependencies first as they are also loaded first, unless the
+ * load profile knows in which order they were loaded last time
+ */
+static void
+prefetch_plugins (BeanEngine *engine,
+                  GPtrArray  *to_load)
+{
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  BeanLoadProfile *profile = get_load_profile (engine);
+  GHashTable *visited;
+  GPtrArray *infos;
+  PrefetchData *data;
+  guint i;
 
-      g_warning ("The '%s' plugin loader was not enabled "
-                 "for this engine. This will no longer be "
-                 "supported at some point in the future!",
-                 bean_utils_get_loader_from_id (loader_id));
+  /* The previous plugins are either loaded or no longer needed */
+  stop_prefetch (engine);
 
-      g_mutex_unlock (&loaders_lock);
+  visited = g_hash_table_new (NULL, NULL);
+  infos = g_ptr_array_new_with_free_func ((GDestroyNotify) _bean_plugin_info_unref);
 
-      /* Avoid bypassing logic in bean_engine_enable_loader() */
-      bean_engine_enable_loader (engine,
-                                 bean_utils_get_loader_from_id (loader_id));
-      return get_plugin_loader (engine, loader_id);
+  for (i = 0; i < to_load->len; ++i)
+    collect_prefetch_plugins (engine, g_ptr_array_index (to_load, i),
+                              visited, infos);
+
+  g_hash_table_unref (visited);
+
+  if (infos->len == 0)
+    {
+      g_ptr_array_unref (infos);
+      return;
     }
 
-  loader_info->loader = get_local_plugin_loader (engine, loader_id);
+  /* The sort is stable, so unknown plugins keep their order */
+  if (profile != NULL && !bean_load_profile_is_empty (profile))
+    g_ptr_array_sort_with_data (infos, compare_load_positions, profile);
 
-  if (loader_info->loader == NULL)
-    loader_info->failed = TRUE;
+  data = g_new0 (PrefetchData, 1);
+  data->infos = infos;
 
-  g_mutex_unlock (&loaders_lock);
-  return loader_info->loader;
+  priv->prefetch_thread = g_thread_try_new ("bean-prefetch",
+                                            (GThreadFunc) prefetch_plugins_thread,
+                                            data, NULL);
+
+  if (priv->prefetch_thread != NULL)
+    priv->prefetch_data = data;
+  else
+    prefetch_data_free (data);
 }
 
 /**
- * bean_engine_enable_loader:
+ * bean_engine_set_loaded_plugins:
  * @engine: A #BeanEngine.
- * @loader_name: The name of the loader to enable.
- *
- * Enable a loader, enables a loader for plugins.
- * The C plugin loader is always enabled. The other plugin
- * loaders are: lua5.1, python and python3.
+ * @plugin_names: (allow-none) (array zero-terminated=1): A %NULL-terminated
+ *  array of plugin names, or %NULL.
  *
- * For instance, the following code will enable Python 2 plugins
- * to be loaded:
- * |[
- * bean_engine_enable_loader (engine, "python");
- * ]|
+ * Sets the list of loaded plugins for @engine. When this function is called,
+ * the #BeanEngine will load all the plugins whose names are in @plugin_names,
+ * and ensures all other active plugins are unloaded.
  *
- * Note: plugin loaders used to be shared across #BeanEngines so enabling
- *       a loader on one #BeanEngine would enable it on all #BeanEngines.
- *       This behavior has been kept to avoid breaking applications,
- *       however a warning has been added to help applications transition.
- **/
+ * If @plugin_names is %NULL, all plugins will be unloaded.
+ */
 void
-bean_engine_enable_loader (BeanEngine  *engine,
-                           const gchar *loader_name)
+bean_engine_set_loaded_plugins (BeanEngine   *engine,
+                                const gchar **plugin_names)
 {
   BeanEnginePrivate *priv = GET_PRIV (engine);
-  LoaderInfo *loader_info;
-  gint loader_id;
+  GHashTable *requested;
+  BeanLoadProfile *profile;
+  GPtrArray *to_load, *to_unload;
+  GList *pl;
+  guint i;
 
   g_return_if_fail (BEAN_IS_ENGINE (engine));
-  g_return_if_fail (loader_name != NULL && *loader_name != '\0');
 
-  loader_id = bean_utils_get_loader_id (loader_name);
+  requested = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; plugin_names != NULL && plugin_names[i] != NULL; ++i)
+    g_hash_table_add (requested, (gpointer) plugin_names[i]);
 
-  if (loader_id == -1)
+  if (priv->parallel_load)
+    preload_plugins (engine, requested);
+
+  /* Of BeanPluginInfo, each one after its dependencies */
+  to_load = g_ptr_array_new_with_free_func ((GDestroyNotify) _bean_plugin_info_unref);
+  to_unload = g_ptr_array_new_with_free_func ((GDestroyNotify) _bean_plugin_info_unref);
+
+  pl = bean_plugin_graph_get_sorted (priv->plugin_graph)->head;
+  for (; pl != NULL; pl = pl->next)
     {
-      g_warning ("Failed to enable unknown plugin loader '%s'", loader_name);
-      return;
+      BeanPluginInfo *info = (BeanPluginInfo *) pl->data;
+
+      if (!bean_plugin_info_is_available (info, NULL))
+        continue;
+
+      /* Requested plugins which are loaded are still checked
+       * below, as unloading a dependency also unloads them
+       */
+      if (g_hash_table_contains (requested, info->module_name))
+        g_ptr_array_add (to_load, _bean_plugin_info_ref (info));
+      else if (bean_plugin_info_is_loaded (info))
+        g_ptr_array_add (to_unload, _bean_plugin_info_ref (info));
     }
 
-  loader_info = &priv->loaders[loader_id];
-  if (loader_info->enabled || loader_info->failed)
-    return;
+  profile = get_load_profile (engine);
 
-  g_mutex_lock (&loaders_lock);
+  if (priv->prefetch_modules ||
+      (profile != NULL && !bean_load_profile_is_empty (profile)))
+    prefetch_plugins (engine, to_load);
 
-  /* Don't check if the loader failed
-   * as we want to warn multiple times
-   */
-  if (loaders[loader_id].enabled)
+  bean_engine_begin_batch (engine);
+
+  /* Dependants are unloaded before their dependencies */
+  for (i = to_unload->len; i > 0; --i)
     {
-      loader_info->enabled = TRUE;
-      g_mutex_unlock (&loaders_lock);
-      return;
+      BeanPluginInfo *info = g_ptr_array_index (to_unload, i - 1);
+
+      if (bean_plugin_info_is_loaded (info))
+        g_signal_emit (engine, signals[UNLOAD_PLUGIN], 0, info);
     }
 
-  /* Some tests check for mixed versions this way */
-  if (g_getenv ("BEAN_ALLOW_CONFLICTING_LOADERS") == NULL)
+  for (i = 0; i < to_load->len; ++i)
     {
-      gint i;
-      const gint *loader_ids;
+      BeanPluginInfo *info = g_ptr_array_index (to_load, i);
 
-      loader_ids = bean_utils_get_conflicting_loaders_from_id (loader_id);
+      if (!bean_plugin_info_is_loaded (info))
+        g_signal_emit (engine, signals[LOAD_PLUGIN], 0, info);
+    }
 
-      /* Some loaders conflict with each other
-       * and cannot be used in the same process
-       */
-      for (i = 0; loader_ids[i] != -1; ++i)
-        {
-          if (!loaders[loader_ids[i]].enabled)
-            continue;
+  bean_engine_commit_batch (engine);
 
-          g_warning ("Cannot enable plugin loader '%s' as the "
-                     "'%s' plugin loader is already enabled.", loader_name,
-                     bean_utils_get_loader_from_id (loader_ids[i]));
+  g_ptr_array_unref (to_unload);
+  g_ptr_array_unref (to_load);
+  g_hash_table_unref (requested);
+}
 
-          loader_info->failed = TRUE;
-          loaders[loader_id].failed = TRUE;
-          g_mutex_unlock (&loaders_lock);
-          return;
-        }
-    }
+typedef struct _LoadItem {
+  BeanPluginInfo *info;
 
-  /* We do not load the plugin loader immediately and instead
-   * load it in get_plugin_loader() so that it is loaded lazily.
-   */
-  loader_info->enabled = TRUE;
-  loaders[loader_id].enabled = TRUE;
+  /* Of LoadItem, the dependencies which are also being loaded */
+  GPtrArray *deps;
 
-  g_mutex_unlock (&loaders_lock);
+  /* Set once the plugin was loaded by it in the worker thread */
+  BeanPluginLoader *loader;
+
+  /* If this operation is the one preparing the plugin */
+  guint owned : 1;
+  guint can_prepare : 1;
+} LoadItem;
+
+typedef struct _LoadData {
+  /* Of LoadItem, dependencies first */
+  GPtrArray *items;
+
+  /* Of BeanPluginInfo, in the order they were requested */
+  GPtrArray *requested;
+  gchar *not_found;
+} LoadData;
+
+static void
+load_item_free (LoadItem *item)
+{
+  _bean_plugin_info_unref (item->info);
+  g_ptr_array_unref (item->deps);
+  g_clear_object (&item->loader);
+  g_slice_free (LoadItem, item);
 }
 
-/**
- * bean_engine_get_plugin_list:
- * @engine: A #BeanEngine.
- *
- * Returns the list of #BeanPluginInfo known to the engine.
- *
- * Returns: (transfer none) (element-type Bean.PluginInfo): a #GList of
- * #BeanPluginInfo. Note that the list belongs to the engine and should
- * not be freed.
- **/
-const GList *
-bean_engine_get_plugin_list (BeanEngine *engine)
+static void
+load_data_free (LoadData *data)
 {
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
-
-  return priv->plugin_list.head;
+  g_ptr_array_unref (data->items);
+  g_ptr_array_unref (data->requested);
+  g_free (data->not_found);
+  g_slice_free (LoadData, data);
 }
 
-/**
- * bean_engine_get_plugin_info:
- * @engine: A #BeanEngine.
- * @plugin_name: A plugin name.
- *
- * Gets the #BeanPluginInfo corresponding with @plugin_name,
- * or %NULL if @plugin_name was not found.
- *
- * Returns: (transfer none): the #BeanPluginInfo corresponding with
- * a given plugin module name.
+/* Called in the thread which started the operation, which reserves
+ * the plugins which are not already being prepared by another one
  */
-BeanPluginInfo *
-bean_engine_get_plugin_info (BeanEngine  *engine,
-                             const gchar *plugin_name)
+static LoadData *
+load_data_new (BeanEngine         *engine,
+               const gchar * const *plugin_names,
+               BeanPluginInfo      *plugin_info)
 {
   BeanEnginePrivate *priv = GET_PRIV (engine);
-  GList *l;
+  LoadData *data;
+  const GQueue *sorted;
+  GHashTable *items;
+  GList *pl;
+  guint i;
 
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
-  g_return_val_if_fail (plugin_name != NULL, NULL);
+  data = g_slice_new0 (LoadData);
+  data->items = g_ptr_array_new_with_free_func ((GDestroyNotify) load_item_free);
+  data->requested =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) _bean_plugin_info_unref);
 
-  for (l = priv->plugin_list.head; l != NULL; l = l->next)
+  if (plugin_info != NULL)
+    g_ptr_array_add (data->requested, _bean_plugin_info_ref (plugin_info));
+
+  for (i = 0; plugin_names != NULL && plugin_names[i] != NULL; ++i)
     {
-      BeanPluginInfo *info = (BeanPluginInfo *) l->data;
-      const gchar *module_name = bean_plugin_info_get_module_name (info);
+      BeanPluginInfo *info;
+
+      info = bean_engine_get_plugin_info (engine, plugin_names[i]);
 
-      if (strcmp (module_name, plugin_name) == 0)
-        return info;
+      if (info != NULL)
+        g_ptr_array_add (data->requested, _bean_plugin_info_ref (info));
+      else if (data->not_found == NULL)
+        data->not_found = g_strdup (plugin_names[i]);
     }
 
-  return NULL;
-}
+  /* Info -> LoadItem, or NULL if it is needed but
+   * its item was not created yet
+   */
+  items = g_hash_table_new (NULL, NULL);
 
-static void
-bean_engine_load_plugin_real (BeanEngine     *engine,
-                              BeanPluginInfo *info)
-{
-  const gchar **dependencies;
-  BeanPluginInfo *dep_info;
-  guint i;
-  BeanPluginLoader *loader;
+  for (i = 0; i < data->requested->len; ++i)
+    g_hash_table_insert (items, g_ptr_array_index (data->requested, i), NULL);
 
-  if (bean_plugin_info_is_loaded (info))
-    return;
+  /* Dependencies are sorted before their dependants, so walking
+   * backwards finds every plugin which is going to be loaded
+   */
+  sorted = bean_plugin_graph_get_sorted (priv->plugin_graph);
 
-  if (!bean_plugin_info_is_available (info, NULL))
-    return;
+  for (pl = sorted->tail; pl != NULL; pl = pl->prev)
+    {
+      BeanPluginInfo *info = (BeanPluginInfo *) pl->data;
+      GPtrArray *deps;
 
-  /* We set the plugin info as loaded before trying to load the dependencies,
-   * to make sure we won't have an infinite loop. */
-  info->loaded = TRUE;
+      if (!g_hash_table_contains (items, info))
+        continue;
 
-  dependencies = bean_plugin_info_get_dependencies (info);
-  for (i = 0; dependencies[i] != NULL; i++)
-    {
-      dep_info = bean_engine_get_plugin_info (engine, dependencies[i]);
-      if (!dep_info)
+      if (bean_plugin_info_is_loaded (info) ||
+          !bean_plugin_info_is_available (info, NULL))
         {
-          g_warning ("Could not find plugin '%s' for plugin '%s'",
-                     dependencies[i], bean_plugin_info_get_module_name (info));
-          g_set_error (&info->error,
-                       BEAN_PLUGIN_INFO_ERROR,
-                       BEAN_PLUGIN_INFO_ERROR_DEP_NOT_FOUND,
-                       _("Dependency “%s” was not found"),
-                       dependencies[i]);
-          goto error;
+          g_hash_table_remove (items, info);
+          continue;
         }
 
-      if (!bean_engine_load_plugin (engine, dep_info))
-        {
-          g_set_error (&info->error,
-                       BEAN_PLUGIN_INFO_ERROR,
-                       BEAN_PLUGIN_INFO_ERROR_LOADING_FAILED,
-                       _("Dependency “%s” failed to load"),
-                       bean_plugin_info_get_name (dep_info));
-          goto error;
-        }
+      deps = bean_plugin_graph_get_dependencies (priv->plugin_graph, info);
+      for (i = 0; i < deps->len; ++i)
+        g_hash_table_insert (items, g_ptr_array_index (deps, i), NULL);
     }
 
-  loader = get_plugin_loader (engine, info->loader_id);
+  g_mutex_lock (&priv->prepare_lock);
 
-  if (loader == NULL)
+  for (pl = sorted->head; pl != NULL; pl = pl->next)
     {
-      /* Already warned */
-      g_set_error (&info->error,
-                   BEAN_PLUGIN_INFO_ERROR,
-                   BEAN_PLUGIN_INFO_ERROR_LOADER_NOT_FOUND,
-                   _("Plugin loader “%s” was not found"),
-                   bean_utils_get_loader_from_id (info->loader_id));
-      goto error;
-    }
+      BeanPluginInfo *info = (BeanPluginInfo *) pl->data;
+      GPtrArray *deps;
+      LoadItem *item;
 
-  if (!bean_plugin_loader_load (loader, info))
-    {
-      g_warning ("Error loading plugin '%s'",
-                 bean_plugin_info_get_module_name (info));
-      g_set_error (&info->error,
-                   BEAN_PLUGIN_INFO_ERROR,
-                   BEAN_PLUGIN_INFO_ERROR_LOADING_FAILED,
-                   _("Failed to load"));
-      goto error;
-    }
+      if (!g_hash_table_contains (items, info))
+        continue;
 
-  g_debug ("Loaded plugin '%s'", bean_plugin_info_get_module_name (info));
+      item = g_slice_new0 (LoadItem);
+      item->info = _bean_plugin_info_ref (info);
+      item->deps = g_ptr_array_new ();
+      item->can_prepare = !has_missing_dependencies (engine, info);
 
-  g_object_notify_by_pspec (G_OBJECT (engine),
-                            properties[PROP_LOADED_PLUGINS]);
+      /* Dependencies which are part of a cycle do
+       * not have an item yet, those are left to
+       * bean_engine_load_plugin() as well
+       */
+      deps = bean_plugin_graph_get_dependencies (priv->plugin_graph, info);
+      for (i = 0; i < deps->len; ++i)
+        {
+          gpointer dep_info = g_ptr_array_index (deps, i);
+          LoadItem *dep_item;
 
-  return;
+          if (!g_hash_table_lookup_extended (items, dep_info,
+                                             NULL, (gpointer *) &dep_item))
+            {
+              /* Unless it is loaded, the dependency is unavailable */
+              if (!bean_plugin_info_is_loaded (dep_info))
+                item->can_prepare = FALSE;
 
-error:
+              continue;
+            }
 
-  info->loaded = FALSE;
-  info->available = FALSE;
-}
+          if (dep_item != NULL)
+            g_ptr_array_add (item->deps, dep_item);
+          else
+            item->can_prepare = FALSE;
+        }
 
-/**
- * bean_engine_load_plugin:
- * @engine: A #BeanEngine.
- * @info: A #BeanPluginInfo.
- *
- * Loads the plugin corresponding to @info if it's not currently loaded.
- * Emits the "load-plugin" signal; loading the plugin
- * actually occurs in the default signal handler.
- *
- * Returns: whether the plugin has been successfully loaded.
- */
-gboolean
-bean_engine_load_plugin (BeanEngine     *engine,
-                         BeanPluginInfo *info)
-{
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
-  g_return_val_if_fail (info != NULL, FALSE);
+      if (!g_hash_table_contains (priv->preparing_plugins, info) &&
+          !g_hash_table_contains (priv->prepared_plugins, info))
+        {
+          g_hash_table_add (priv->preparing_plugins, info);
+          item->owned = TRUE;
+        }
 
-  if (bean_plugin_info_is_loaded (info))
-    return TRUE;
+      g_hash_table_insert (items, info, item);
+      g_ptr_array_add (data->items, item);
+    }
 
-  if (!bean_plugin_info_is_available (info, NULL))
-    return FALSE;
+  g_mutex_unlock (&priv->prepare_lock);
 
-  g_signal_emit (engine, signals[LOAD_PLUGIN], 0, info);
+  g_hash_table_unref (items);
 
-  return bean_plugin_info_is_loaded (info);
+  return data;
 }
 
 static void
-bean_engine_unload_plugin_real (BeanEngine     *engine,
-                                BeanPluginInfo *info)
+load_plugins_thread (GTask        *task,
+                     BeanEngine   *engine,
+                     LoadData     *data,
+                     GCancellable *cancellable)
 {
   BeanEnginePrivate *priv = GET_PRIV (engine);
-  GList *item;
-  const gchar *module_name;
-  BeanPluginLoader *loader;
-
-  if (!bean_plugin_info_is_loaded (info))
-    return;
+  BeanLoadProfile *profile = get_load_profile (engine);
+  guint i, j;
 
-  /* We set the plugin info as unloaded before trying to unload the
-   * dependants, to make sure we won't have an infinite loop. */
-  info->loaded = FALSE;
-
-  /* First unload all the dependant plugins */
-  module_name = bean_plugin_info_get_module_name (info);
-  for (item = priv->plugin_list.tail; item != NULL; item = item->prev)
+  /* Every reserved plugin must be released, even when cancelled */
+  for (i = 0; i < data->items->len; ++i)
     {
-      BeanPluginInfo *other_info = BEAN_PLUGIN_INFO (item->data);
+      LoadItem *item = g_ptr_array_index (data->items, i);
+      gboolean can_prepare;
 
-      if (!bean_plugin_info_is_loaded (other_info))
+      if (!item->owned)
         continue;
 
-      if (bean_plugin_info_has_dependency (other_info, module_name))
-         bean_engine_unload_plugin (engine, other_info);
-    }
-
-  /* find the loader and tell it to gc and unload the plugin */
-  loader = get_plugin_loader (engine, info->loader_id);
-
-  bean_plugin_loader_garbage_collect (loader);
-  bean_plugin_loader_unload (loader, info);
-
-  g_debug ("Unloaded plugin '%s'", bean_plugin_info_get_module_name (info));
-
-  /* Don't notify while in dispose so the
-   * loaded plugins can easily be kept in GSettings
-   */
-  if (!priv->in_dispose)
-    g_object_notify_by_pspec (G_OBJECT (engine),
-                              properties[PROP_LOADED_PLUGINS]);
-}
-
-/**
- * bean_engine_unload_plugin:
- * @engine: A #BeanEngine.
- * @info: A #BeanPluginInfo.
- *
- * Unloads the plugin corresponding to @info.
- * Emits the "unload-plugin" signal; unloading the plugin
- * actually occurs in the default signal handler.
- *
- * Returns: whether the plugin has been successfully unloaded.
- */
-gboolean
-bean_engine_unload_plugin (BeanEngine     *engine,
-                           BeanPluginInfo *info)
-{
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
-  g_return_val_if_fail (info != NULL, FALSE);
+      can_prepare = item->can_prepare &&
+                    !g_cancellable_is_cancelled (cancellable);
 
-  if (!bean_plugin_info_is_loaded (info))
-    return TRUE;
+      for (j = 0; j < item->deps->len && can_prepare; ++j)
+        {
+          LoadItem *dep_item = g_ptr_array_index (item->deps, j);
 
-  g_signal_emit (engine, signals[UNLOAD_PLUGIN], 0, info);
+          can_prepare = dep_item->loader != NULL;
+        }
 
-  return !bean_plugin_info_is_loaded (info);
-}
+      if (can_prepare)
+        {
+          BeanPluginLoader *loader;
+          BeanLoadTiming timing_data, *timing = NULL;
+          gint64 start_time;
 
-/**
- * bean_engine_provides_extension:
- * @engine: A #BeanEngine.
- * @info: A #BeanPluginInfo.
- * @extension_type: The extension #GType.
- *
- * Returns if @info provides an extension for @extension_type.
- * If the @info is not loaded than %FALSE will always be returned.
- *
- * Since libbean 1.22, @extension_type can be an Abstract #GType
- * and not just an Interface #GType.
- *
- * Returns: if @info provides an extension for @extension_type.
- */
-gboolean
-bean_engine_provides_extension (BeanEngine     *engine,
-                                BeanPluginInfo *info,
-                                GType           extension_type)
-{
-  BeanPluginLoader *loader;
+          if (profile != NULL)
+            {
+              timing = &timing_data;
+              bean_load_timing_start (timing);
+            }
 
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
-  g_return_val_if_fail (info != NULL, FALSE);
-  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
-                        G_TYPE_IS_ABSTRACT (extension_type), FALSE);
+          start_time = g_get_monotonic_time ();
+          loader = get_enabled_plugin_loader (engine, item->info->loader_id);
 
-  if (!bean_plugin_info_is_loaded (info))
-    return FALSE;
+          if (timing != NULL)
+            timing->phases[BEAN_LOAD_PHASE_LOADER_INIT] =
+              g_get_monotonic_time () - start_time;
 
-  loader = get_plugin_loader (engine, info->loader_id);
-  return bean_plugin_loader_provides_extension (loader, info, extension_type);
-}
+          /* Failures are reported by bean_engine_load_plugin() */
+          if (loader != NULL &&
+              plugin_loader_load_timed (loader, item->info, timing))
+            {
+              item->loader = g_object_ref (loader);
+
+              /* Recorded once the plugin is claimed */
+              if (timing != NULL)
+                {
+                  bean_load_timing_stop (timing);
+                  stash_load_timing (engine, item->info, timing);
+                }
+            }
+        }
 
-/**
- * bean_engine_create_extensionv: (skip)
- * @engine: A #BeanEngine.
- * @info: A loaded #BeanPluginInfo.
- * @extension_type: The implemented extension #GType.
- * @n_properties: the length of the @prop_names and @prop_values arrays.
- * @prop_names: (allow-none) (array length=n_properties): an array of property names.
- * @prop_values: (allow-none) (array length=n_properties): an array of #GValue.
- *
- * If the plugin identified by @info implements the @extension_type,
- * then this function will return a new instance of this implementation,
- * wrapped in a new #BeanExtension instance. Otherwise, it will return %NULL.
- *
- * Since libbean 1.22, @extension_type can be an Abstract #GType
- * and not just an Interface #GType.
- *
- * See bean_engine_create_extension() for more information.
- *
- * Returns: (transfer full): a new instance of #BeanExtension wrapping
- * the @extension_type instance, or %NULL.
- */
-BeanExtension *
-bean_engine_create_extensionv (BeanEngine     *engine,
-                               BeanPluginInfo *info,
-                               GType           extension_type,
-                               guint           n_properties,
-                               const gchar   **prop_names,
-                               GValue         *prop_values)
-{
-  BeanPluginLoader *loader;
-  BeanExtension *extension;
+      g_mutex_lock (&priv->prepare_lock);
 
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
-  g_return_val_if_fail (info != NULL, NULL);
-  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
-                        G_TYPE_IS_ABSTRACT (extension_type), NULL);
-  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
+      g_hash_table_remove (priv->preparing_plugins, item->info);
 
-  loader = get_plugin_loader (engine, info->loader_id);
-  extension = bean_plugin_loader_create_extension (loader, info, extension_type,
-                                                   n_properties, prop_names, prop_values);
+      if (item->loader != NULL)
+        g_hash_table_add (priv->prepared_plugins, item->info);
 
-  if (!G_TYPE_CHECK_INSTANCE_TYPE (extension, extension_type))
-    {
-      g_warning ("Plugin '%s' does not provide a '%s' extension",
-                 bean_plugin_info_get_module_name (info),
-                 g_type_name (extension_type));
-      return NULL;
+      g_cond_broadcast (&priv->prepare_cond);
+      g_mutex_unlock (&priv->prepare_lock);
     }
 
-  return extension;
+  if (!g_task_return_error_if_cancelled (task))
+    g_task_return_boolean (task, TRUE);
 }
 
-/**
- * bean_engine_create_extension_with_properties: (rename-to bean_engine_create_extension)
- * @engine: A #BeanEngine.
- * @info: A loaded #BeanPluginInfo.
- * @extension_type: The implemented extension #GType.
- * @n_properties: the length of the @prop_names and @prop_values array.
- * @prop_names: (array length=n_properties): an array of property names.
- * @prop_values: (array length=n_properties): an array of property values.
- *
- * If the plugin identified by @info implements the @extension_type,
- * then this function will return a new instance of this implementation,
- * wrapped in a new #BeanExtension instance. Otherwise, it will return %NULL.
- *
- * Since libbean 1.22, @extension_type can be an Abstract #GType
- * and not just an Interface #GType.
- *
- * See bean_engine_create_extension() for more information.
- *
- * Returns: (transfer full): a new instance of #BeanExtension wrapping
- * the @extension_type instance, or %NULL.
- *
- * Since: 1.24
+/* Unloads the plugins that were loaded in the worker thread but
+ * were not loaded by the engine, because the operation was cancelled
+ * or a load-plugin handler prevented it
  */
-BeanExtension *
-bean_engine_create_extension_with_properties (BeanEngine     *engine,
-                                              BeanPluginInfo *info,
-                                              GType           extension_type,
-                                              guint           n_properties,
-                                              const gchar   **prop_names,
-                                              const GValue   *prop_values)
+static void
+load_data_release_prepared (BeanEngine *engine,
+                            LoadData   *data)
 {
-  BeanExtension *extension;
-  const gchar **out_names = NULL;
-  GValue *out_values = NULL;
-
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
-  g_return_val_if_fail (info != NULL, NULL);
-  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
-                        G_TYPE_IS_ABSTRACT (extension_type), NULL);
-  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
-  g_return_val_if_fail (n_properties == 0 || prop_names != NULL, NULL);
-  g_return_val_if_fail (n_properties == 0 || prop_values != NULL, NULL);
+  BeanEnginePrivate *priv = GET_PRIV (engine);
+  guint i;
 
-  if (n_properties > 0)
+  for (i = 0; i < data->items->len; ++i)
     {
-      if (!bean_utils_properties_array_to_parameter_list (extension_type, n_properties,
-                                                          prop_names, prop_values,
-                                                          &out_names, &out_values))
+      LoadItem *item = g_ptr_array_index (data->items, i);
+      gboolean unclaimed;
+
+      if (item->loader == NULL)
+        continue;
+
+      g_mutex_lock (&priv->prepare_lock);
+      unclaimed = g_hash_table_remove (priv->prepared_plugins, item->info);
+      g_mutex_unlock (&priv->prepare_lock);
+
+      if (unclaimed)
         {
-          /* Already warned */
-          return NULL;
+          take_load_timing (engine, item->info, NULL);
+          bean_plugin_loader_unload (item->loader, item->info);
         }
     }
+}
 
-  extension = bean_engine_create_extensionv (engine, info, extension_type,
-                                             n_properties, out_names, out_values);
+/* Called in the main context of bean_engine_load_plugins_async() */
+static void
+load_plugins_prepared_cb (BeanEngine   *engine,
+                          GAsyncResult *result,
+                          GTask        *task)
+{
+  LoadData *data = g_task_get_task_data (G_TASK (result));
+  GError *error = NULL;
+  guint i;
 
-  if (out_values != NULL)
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
     {
-      for (guint i = 0; i < n_properties; i++)
-        g_value_unset (&out_values[i]);
-      g_free (out_names);
-      g_free (out_values);
+      load_data_release_prepared (engine, data);
+      g_task_return_error (task, error);
+      g_object_unref (task);
+      return;
     }
 
-  if (!G_TYPE_CHECK_INSTANCE_TYPE (extension, extension_type))
-    {
-      g_warning ("Plugin '%s' does not provide a '%s' extension",
-                 bean_plugin_info_get_module_name (info),
-                 g_type_name (extension_type));
-      return NULL;
-    }
+  bean_engine_begin_batch (engine);
 
-  return extension;
-}
+  for (i = 0; i < data->requested->len; ++i)
+    bean_engine_load_plugin (engine, g_ptr_array_index (data->requested, i));
 
-/**
- * bean_engine_create_extension_valist: (skip)
- * @engine: A #BeanEngine.
- * @info: A loaded #BeanPluginInfo.
- * @extension_type: The implemented extension #GType.
- * @first_property: the name of the first property.
- * @var_args: the value of the first property, followed optionally by more
- *   name/value pairs, followed by %NULL.
- *
- * If the plugin identified by @info implements the @extension_type,
- * then this function will return a new instance of this implementation,
- * wrapped in a new #BeanExtension instance. Otherwise, it will return %NULL.
- *
- * Since libbean 1.22, @extension_type can be an Abstract #GType
- * and not just an Interface #GType.
- *
- * See bean_engine_create_extension() for more information.
- *
- * Returns: a new instance of #BeanExtension wrapping
- * the @extension_type instance, or %NULL.
- */
-BeanExtension *
-bean_engine_create_extension_valist (BeanEngine     *engine,
-                                     BeanPluginInfo *info,
-                                     GType           extension_type,
-                                     const gchar    *first_property,
-                                     va_list         var_args)
-{
-  const gchar **prop_names;
-  GValue *prop_values;
-  guint n_properties;
+  bean_engine_commit_batch (engine);
 
-  BeanExtension *exten;
+  load_data_release_prepared (engine, data);
 
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
-  g_return_val_if_fail (info != NULL, NULL);
-  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
-  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
-                        G_TYPE_IS_ABSTRACT (extension_type), FALSE);
+  for (i = 0; i < data->requested->len && error == NULL; ++i)
+    {
+      BeanPluginInfo *info = g_ptr_array_index (data->requested, i);
 
-  if (!bean_utils_valist_to_parameter_list (extension_type, first_property, var_args,
-                                            &prop_names, &prop_values, &n_properties))
+      if (bean_plugin_info_is_loaded (info) ||
+          !bean_plugin_info_is_available (info, &error))
+        continue;
+
+      /* A load-plugin handler prevented it */
+      g_set_error (&error, BEAN_PLUGIN_INFO_ERROR,
+                   BEAN_PLUGIN_INFO_ERROR_LOADING_FAILED,
+                   _("Failed to load"));
+    }
+
+  if (error == NULL && data->not_found != NULL)
     {
-      /* Already warned */
-      return NULL;
+      g_set_error (&error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                   _("Plugin “%s” was not found"), data->not_found);
     }
 
-  exten = bean_engine_create_extensionv (engine, info, extension_type,
-                                         n_properties, prop_names, prop_values);
+  if (error != NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
 
-  for (guint i = 0; i < n_properties; i++)
-    g_value_unset (&prop_values[i]);
-  g_free (prop_names);
-  g_free (prop_values);
+  g_object_unref (task);
+}
 
-  return exten;
+static void
+load_plugins_async (BeanEngine          *engine,
+                    const gchar * const *plugin_names,
+                    BeanPluginInfo      *info,
+                    GCancellable        *cancellable,
+                    GAsyncReadyCallback  callback,
+                    gpointer             user_data,
+                    gpointer             source_tag)
+{
+  GTask *task, *prepare_task;
+
+  task = g_task_new (engine, cancellable, callback, user_data);
+  g_task_set_source_tag (task, source_tag);
+
+  prepare_task = g_task_new (engine, cancellable,
+                             (GAsyncReadyCallback) load_plugins_prepared_cb,
+                             task);
+  g_task_set_source_tag (prepare_task, source_tag);
+  g_task_set_task_data (prepare_task,
+                        load_data_new (engine, plugin_names, info),
+                        (GDestroyNotify) load_data_free);
+  g_task_run_in_thread (prepare_task, (GTaskThreadFunc) load_plugins_thread);
+  g_object_unref (prepare_task);
 }
 
 /**
- * bean_engine_create_extension: (skip)
+ * bean_engine_load_plugin_async:
  * @engine: A #BeanEngine.
- * @info: A loaded #BeanPluginInfo.
- * @extension_type: The implemented extension #GType.
- * @first_property: the name of the first property.
- * @...: the value of the first property, followed optionally by more
- *   name/value pairs, followed by %NULL.
- *
- * If the plugin identified by @info implements the @extension_type,
- * then this function will return a new instance of this implementation,
- * wrapped in a new #BeanExtension instance. Otherwise, it will return %NULL.
+ * @info: A #BeanPluginInfo.
+ * @cancellable: (allow-none): A #GCancellable, or %NULL.
+ * @callback: (scope async): A #GAsyncReadyCallback to call when done.
+ * @user_data: (closure): The data to pass to @callback.
  *
- * When creating the new instance of the @extension_type subtype, the
- * provided construct properties will be passed to the extension construction
- * handler (exactly like if you had called g_object_new() yourself).
+ * Asynchronously does the same as bean_engine_load_plugin().
  *
- * The new extension instance produced by this function will always be
- * returned wrapped in a #BeanExtension proxy, following the current libbean
- * principle of never giving you the actual object (also because it might as
- * well *not* be an actual object).
+ * The plugin loaders which are needed are initialized and the plugin
+ * and its dependencies are loaded by them in a worker thread, which
+ * is where modules are opened and Python or Lua code is imported.
+ * The #BeanEngine::load-plugin signals are then emitted in the
+ * thread-default main context of the caller, where
+ * #BeanEngine:loaded-plugins is notified, right before @callback
+ * is called. Note that this means that the plugin loader already
+ * loaded the plugin when its #BeanEngine::load-plugin signal is
+ * emitted, if the signal is stopped the plugin is unloaded again.
  *
- * Since libbean 1.22, @extension_type can be an Abstract #GType
- * and not just an Interface #GType.
+ * If @cancellable is cancelled before the signals are emitted,
+ * no plugin is loaded.
  *
- * Returns: a new instance of #BeanExtension wrapping
- * the @extension_type instance, or %NULL.
+ * Since: 2.4
  */
-BeanExtension *
-bean_engine_create_extension (BeanEngine     *engine,
-                              BeanPluginInfo *info,
-                              GType           extension_type,
-                              const gchar    *first_property,
-                              ...)
+void
+bean_engine_load_plugin_async (BeanEngine          *engine,
+                               BeanPluginInfo      *info,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
 {
-  va_list var_args;
-  BeanExtension *exten;
-
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
-  g_return_val_if_fail (info != NULL, NULL);
-  g_return_val_if_fail (bean_plugin_info_is_loaded (info), NULL);
-  g_return_val_if_fail (G_TYPE_IS_INTERFACE (extension_type) ||
-                        G_TYPE_IS_ABSTRACT (extension_type), FALSE);
-
-  va_start (var_args, first_property);
-  exten = bean_engine_create_extension_valist (engine, info, extension_type,
-                                               first_property, var_args);
-  va_end (var_args);
+  g_return_if_fail (BEAN_IS_ENGINE (engine));
+  g_return_if_fail (info != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
-  return exten;
+  load_plugins_async (engine, NULL, info, cancellable, callback, user_data,
+                      bean_engine_load_plugin_async);
 }
 
 /**
- * bean_engine_get_loaded_plugins:
+ * bean_engine_load_plugin_finish:
  * @engine: A #BeanEngine.
+ * @result: A #GAsyncResult.
+ * @error: A location for a #GError, or %NULL.
  *
- * Returns the list of the names of all the loaded plugins, or an array
- * containing a single %NULL element if there is no plugin currently loaded.
+ * Finishes an operation started with bean_engine_load_plugin_async().
  *
- * Please note that the returned array is a newly allocated one: you will need
- * to free it using g_strfreev().
+ * Returns: %TRUE if the plugin is loaded, or %FALSE if it could not
+ * be loaded or the operation was cancelled.
  *
- * Returns: (transfer full) (array zero-terminated=1): A newly-allocated
- * %NULL-terminated array of strings.
+ * Since: 2.4
  */
-gchar **
-bean_engine_get_loaded_plugins (BeanEngine *engine)
-{
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-  GArray *array;
-  GList *pl;
-
-  g_return_val_if_fail (BEAN_IS_ENGINE (engine), NULL);
-
-  array = g_array_new (TRUE, FALSE, sizeof (gchar *));
-
-  for (pl = priv->plugin_list.head; pl != NULL; pl = pl->next)
-    {
-      BeanPluginInfo *info = (BeanPluginInfo *) pl->data;
-      gchar *module_name;
-
-      if (bean_plugin_info_is_loaded (info))
-        {
-          module_name = g_strdup (bean_plugin_info_get_module_name (info));
-          g_array_append_val (array, module_name);
-        }
-    }
-
-  return (gchar **) g_array_free (array, FALSE);
-}
-
-static gboolean
-string_in_strv (const gchar  *needle,
-                const gchar **haystack)
+gboolean
+bean_engine_load_plugin_finish (BeanEngine    *engine,
+                                GAsyncResult  *result,
+                                GError       **error)
 {
-  guint i;
-
-  if (haystack == NULL)
-    return FALSE;
-
-  for (i = 0; haystack[i] != NULL; i++)
-    {
-      if (strcmp (haystack[i], needle) == 0)
-        return TRUE;
-    }
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, engine), FALSE);
 
-  return FALSE;
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 /**
- * bean_engine_set_loaded_plugins:
+ * bean_engine_load_plugins_async:
  * @engine: A #BeanEngine.
- * @plugin_names: (allow-none) (array zero-terminated=1): A %NULL-terminated
- *  array of plugin names, or %NULL.
+ * @plugin_names: (array zero-terminated=1): A %NULL-terminated
+ *  array of plugin module names.
+ * @cancellable: (allow-none): A #GCancellable, or %NULL.
+ * @callback: (scope async): A #GAsyncReadyCallback to call when done.
+ * @user_data: (closure): The data to pass to @callback.
  *
- * Sets the list of loaded plugins for @engine. When this function is called,
- * the #BeanEngine will load all the plugins whose names are in @plugin_names,
- * and ensures all other active plugins are unloaded.
+ * Like bean_engine_load_plugin_async() but loads the plugins
+ * in @plugin_names, which are all prepared in the same worker thread.
+ * Unlike bean_engine_set_loaded_plugins() no plugin is unloaded.
  *
- * If @plugin_names is %NULL, all plugins will be unloaded.
+ * Since: 2.4
  */
 void
-bean_engine_set_loaded_plugins (BeanEngine   *engine,
-                                const gchar **plugin_names)
+bean_engine_load_plugins_async (BeanEngine          *engine,
+                                const gchar * const *plugin_names,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
 {
-  BeanEnginePrivate *priv = GET_PRIV (engine);
-  GList *pl;
-
   g_return_if_fail (BEAN_IS_ENGINE (engine));
+  g_return_if_fail (plugin_names != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
-  for (pl = priv->plugin_list.head; pl != NULL; pl = pl->next)
-    {
-      BeanPluginInfo *info = (BeanPluginInfo *) pl->data;
-      const gchar *module_name;
-      gboolean is_loaded;
-      gboolean to_load;
-
-      if (!bean_plugin_info_is_available (info, NULL))
-        continue;
-
-      module_name = bean_plugin_info_get_module_name (info);
-      is_loaded = bean_plugin_info_is_loaded (info);
+  load_plugins_async (engine, plugin_names, NULL, cancellable,
+                      callback, user_data, bean_engine_load_plugins_async);
+}
 
-      to_load = string_in_strv (module_name, plugin_names);
+/**
+ * bean_engine_load_plugins_finish:
+ * @engine: A #BeanEngine.
+ * @result: A #GAsyncResult.
+ * @error: A location for a #GError, or %NULL.
+ *
+ * Finishes an operation started with bean_engine_load_plugins_async().
+ *
+ * Returns: %TRUE if all of the plugins are loaded, or %FALSE if
+ * one of them could not be found or loaded, or the operation was
+ * cancelled. The other plugins are loaded even if one of them
+ * could not be.
+ *
+ * Since: 2.4
+ */
+gboolean
+bean_engine_load_plugins_finish (BeanEngine    *engine,
+                                 GAsyncResult  *result,
+                                 GError       **error)
+{
+  g_return_val_if_fail (BEAN_IS_ENGINE (engine), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, engine), FALSE);
 
-      if (!is_loaded && to_load)
-        g_signal_emit (engine, signals[LOAD_PLUGIN], 0, info);
-      else if (is_loaded && !to_load)
-        g_signal_emit (engine, signals[UNLOAD_PLUGIN], 0, info);
-    }
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 /**
@@ -1732,6 +5137,9 @@ _bean_engine_shutdown (void)
     {
       GlobalLoaderInfo *loader_info = &loaders[i];
 
+      while (loader_info->initializing)
+        g_cond_wait (&loaders_cond, &loaders_lock);
+
       if (loader_info->loader != NULL)
         {
           g_object_add_weak_pointer (G_OBJECT (loader_info->loader),
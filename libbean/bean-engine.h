@@ -41,6 +41,10 @@ typedef struct _BeanEngine         BeanEngine;
 typedef struct _BeanEngineClass    BeanEngineClass;
 typedef struct _BeanEnginePrivate  BeanEnginePrivate;
 
+#define BEAN_TYPE_EXTENSION_FACTORY   (bean_extension_factory_get_type ())
+
+typedef struct _BeanExtensionFactory BeanExtensionFactory;
+
 /**
  * BeanEngine:
  *
@@ -101,6 +105,17 @@ void              bean_engine_enable_loader       (BeanEngine      *engine,
 BEAN_AVAILABLE_IN_ALL
 void              bean_engine_rescan_plugins      (BeanEngine      *engine);
 BEAN_AVAILABLE_IN_ALL
+void              bean_engine_rescan_plugins_async
+                                                  (BeanEngine          *engine,
+                                                   GCancellable        *cancellable,
+                                                   GAsyncReadyCallback  callback,
+                                                   gpointer             user_data);
+BEAN_AVAILABLE_IN_ALL
+gboolean          bean_engine_rescan_plugins_finish
+                                                  (BeanEngine      *engine,
+                                                   GAsyncResult    *result,
+                                                   GError         **error);
+BEAN_AVAILABLE_IN_ALL
 const GList      *bean_engine_get_plugin_list     (BeanEngine      *engine);
 BEAN_AVAILABLE_IN_ALL
 gchar           **bean_engine_get_loaded_plugins  (BeanEngine      *engine);
@@ -108,14 +123,42 @@ BEAN_AVAILABLE_IN_ALL
 void              bean_engine_set_loaded_plugins  (BeanEngine      *engine,
                                                    const gchar    **plugin_names);
 BEAN_AVAILABLE_IN_ALL
+void              bean_engine_begin_batch         (BeanEngine      *engine);
+BEAN_AVAILABLE_IN_ALL
+void              bean_engine_commit_batch        (BeanEngine      *engine);
+BEAN_AVAILABLE_IN_ALL
 BeanPluginInfo   *bean_engine_get_plugin_info     (BeanEngine      *engine,
                                                    const gchar     *plugin_name);
+BEAN_AVAILABLE_IN_ALL
+GList            *bean_engine_get_plugin_dependants
+                                                  (BeanEngine      *engine,
+                                                   BeanPluginInfo  *info);
 
 /* plugin loading and unloading */
 BEAN_AVAILABLE_IN_ALL
 gboolean          bean_engine_load_plugin         (BeanEngine      *engine,
                                                    BeanPluginInfo  *info);
 BEAN_AVAILABLE_IN_ALL
+void              bean_engine_load_plugin_async   (BeanEngine          *engine,
+                                                   BeanPluginInfo      *info,
+                                                   GCancellable        *cancellable,
+                                                   GAsyncReadyCallback  callback,
+                                                   gpointer             user_data);
+BEAN_AVAILABLE_IN_ALL
+gboolean          bean_engine_load_plugin_finish  (BeanEngine      *engine,
+                                                   GAsyncResult    *result,
+                                                   GError         **error);
+BEAN_AVAILABLE_IN_ALL
+void              bean_engine_load_plugins_async  (BeanEngine          *engine,
+                                                   const gchar * const *plugin_names,
+                                                   GCancellable        *cancellable,
+                                                   GAsyncReadyCallback  callback,
+                                                   gpointer             user_data);
+BEAN_AVAILABLE_IN_ALL
+gboolean          bean_engine_load_plugins_finish (BeanEngine      *engine,
+                                                   GAsyncResult    *result,
+                                                   GError         **error);
+BEAN_AVAILABLE_IN_ALL
 gboolean          bean_engine_unload_plugin       (BeanEngine      *engine,
                                                    BeanPluginInfo  *info);
 BEAN_AVAILABLE_IN_ALL
@@ -158,6 +201,25 @@ BeanExtension    *bean_engine_create_extension    (BeanEngine      *engine,
                                                    const gchar     *first_property,
                                                    ...);
 
+BEAN_AVAILABLE_IN_ALL
+GType             bean_extension_factory_get_type (void) G_GNUC_CONST;
+BEAN_AVAILABLE_IN_ALL
+BeanExtensionFactory *
+                  bean_engine_create_extension_factory
+                                                  (BeanEngine      *engine,
+                                                   BeanPluginInfo  *info,
+                                                   GType            extension_type);
+BEAN_AVAILABLE_IN_ALL
+BeanExtensionFactory *
+                  bean_extension_factory_ref      (BeanExtensionFactory *factory);
+BEAN_AVAILABLE_IN_ALL
+void              bean_extension_factory_unref    (BeanExtensionFactory *factory);
+BEAN_AVAILABLE_IN_ALL
+BeanExtension    *bean_extension_factory_create   (BeanExtensionFactory  *factory,
+                                                   guint                  n_properties,
+                                                   const gchar          **prop_names,
+                                                   const GValue          *prop_values);
+
 
 G_END_DECLS
 
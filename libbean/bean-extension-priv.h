@@ -0,0 +1,34 @@
+/*
+ * bean-extension-priv.h
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#ifndef __BEAN_EXTENSION_PRIV_H__
+#define __BEAN_EXTENSION_PRIV_H__
+
+#include "bean-extension.h"
+
+G_BEGIN_DECLS
+
+void _bean_extension_set_extension_type (BeanExtension *exten,
+                                         GType          exten_type);
+
+G_END_DECLS
+
+#endif /* __BEAN_EXTENSION_PRIV_H__ */
@@ -334,14 +334,29 @@ bean_extension_set_call_real (BeanExtensionSet *set,
                               GIArgument       *args)
 {
   BeanExtensionSetPrivate *priv = GET_PRIV (set);
+  BeanGIMethod *method;
   gboolean ret = TRUE;
   GList *l;
   GIArgument dummy;
 
+  if (priv->extensions.length == 0)
+    return TRUE;
+
+  /* The method is looked up and its invoker prepared
+   * only once, then reused for every extension
+   */
+  method = bean_gi_lookup_method (priv->exten_type, method_name);
+
   for (l = priv->extensions.head; l != NULL; l = l->next)
     {
       ExtensionItem *item = (ExtensionItem *) l->data;
-      ret = bean_extension_callv (item->exten, method_name, args, &dummy) && ret;
+
+      /* Might be provided by another interface of the extension */
+      if (method == NULL)
+        ret = bean_extension_callv (item->exten, method_name, args, &dummy) && ret;
+      else
+        ret = bean_gi_method_invoke (method, G_OBJECT (item->exten),
+                                     args, &dummy) && ret;
     }
 
   return ret;
@@ -527,29 +542,25 @@ bean_extension_set_call_valist (BeanExtensionSet *set,
                                 va_list           va_args)
 {
   BeanExtensionSetPrivate *priv = GET_PRIV (set);
-  GICallableInfo *callable_info;
+  BeanGIMethod *method;
   GIArgument *args;
-  gint n_args;
 
   g_return_val_if_fail (BEAN_IS_EXTENSION_SET (set), FALSE);
   g_return_val_if_fail (method_name != NULL, FALSE);
 
-  callable_info = bean_gi_get_method_info (priv->exten_type, method_name);
+  method = bean_gi_lookup_method (priv->exten_type, method_name);
 
-  if (callable_info == NULL)
+  if (method == NULL)
     {
       g_warning ("Method '%s.%s' was not found",
                  g_type_name (priv->exten_type), method_name);
       return FALSE;
     }
 
-  n_args = gi_callable_info_get_n_args (callable_info);
-  g_return_val_if_fail (n_args >= 0, FALSE);
-
-  args = g_newa (GIArgument, n_args);
-  bean_gi_valist_to_arguments (callable_info, va_args, args, NULL);
+  g_return_val_if_fail (method->n_args >= 0, FALSE);
 
-  gi_base_info_unref ((GIBaseInfo *) callable_info);
+  args = g_newa (GIArgument, method->n_args);
+  bean_gi_valist_to_arguments (method, va_args, args, NULL);
 
   return bean_extension_set_callv (set, method_name, args);
 }
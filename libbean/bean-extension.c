@@ -21,7 +21,7 @@
 
 #include "config.h"
 
-#include "bean-extension.h"
+#include "bean-extension-priv.h"
 #include "bean-introspection.h"
 
 /**
@@ -67,48 +67,54 @@ bean_extension_get_type (void)
 static
 G_DEFINE_QUARK (bean-extension-type, extension_type)
 
-static GICallableInfo *
-get_method_info (BeanExtension *exten,
-                 const gchar   *method_name,
-                 GType         *gtype)
+/* The methods are resolved once per type, see bean_gi_lookup_method() */
+static BeanGIMethod *
+get_method (BeanExtension *exten,
+            const gchar   *method_name)
 {
   guint i;
   GType exten_type;
   GType *interfaces;
-  GICallableInfo *method_info;
+  BeanGIMethod *method;
 
   /* Must prioritize the initial GType */
   exten_type = bean_extension_get_extension_type (exten);
-  method_info = bean_gi_get_method_info (exten_type, method_name);
+  method = bean_gi_lookup_method (exten_type, method_name);
 
-  if (method_info != NULL)
-    {
-      if (gtype != NULL)
-        *gtype = exten_type;
-
-      return method_info;
-    }
+  if (method != NULL)
+    return method;
 
   interfaces = g_type_interfaces (G_TYPE_FROM_INSTANCE (exten), NULL);
 
   for (i = 0; interfaces[i] != G_TYPE_INVALID; ++i)
     {
-      method_info = bean_gi_get_method_info (interfaces[i], method_name);
-
-      if (method_info != NULL)
-        {
-          if (gtype != NULL)
-            *gtype = interfaces[i];
+      method = bean_gi_lookup_method (interfaces[i], method_name);
 
-          break;
-        }
+      if (method != NULL)
+        break;
     }
 
-  if (method_info == NULL)
+  if (method == NULL)
     g_warning ("Could not find the GType for method '%s'", method_name);
 
   g_free (interfaces);
-  return method_info;
+  return method;
+}
+
+/*
+ * _bean_extension_set_extension_type:
+ * @exten: A #BeanExtension.
+ * @exten_type: The #GType @exten was created for.
+ *
+ * Remembers which extension type @exten was created for,
+ * for the deprecated bean_extension_get_extension_type().
+ */
+void
+_bean_extension_set_extension_type (BeanExtension *exten,
+                                    GType          exten_type)
+{
+  g_object_set_qdata (G_OBJECT (exten), extension_type_quark (),
+                      GSIZE_TO_POINTER (exten_type));
 }
 
 /**
@@ -191,38 +197,30 @@ bean_extension_call_valist (BeanExtension *exten,
                             const gchar   *method_name,
                             va_list        args)
 {
-  GICallableInfo *callable_info;
-  GITypeInfo retval_info;
+  BeanGIMethod *method;
   GIArgument *gargs;
   GIArgument retval;
   gpointer retval_ptr;
   gboolean ret;
-  gint n_args;
 
   g_return_val_if_fail (BEAN_IS_EXTENSION (exten), FALSE);
   g_return_val_if_fail (method_name != NULL, FALSE);
 
-  callable_info = get_method_info (exten, method_name, NULL);
+  method = get_method (exten, method_name);
 
   /* Already warned */
-  if (callable_info == NULL)
+  if (method == NULL)
     return FALSE;
 
-  n_args = gi_callable_info_get_n_args (callable_info);
-  g_return_val_if_fail (n_args >= 0, FALSE);
-  gargs = g_newa (GIArgument, n_args);
-  bean_gi_valist_to_arguments (callable_info, args, gargs, &retval_ptr);
+  g_return_val_if_fail (method->n_args >= 0, FALSE);
+  gargs = g_newa (GIArgument, method->n_args);
+  bean_gi_valist_to_arguments (method, args, gargs, &retval_ptr);
 
-  ret = bean_extension_callv (exten, method_name, gargs, &retval);
+  /* Not through bean_extension_callv() to only resolve the method once */
+  ret = bean_gi_method_invoke (method, G_OBJECT (exten), gargs, &retval);
 
   if (retval_ptr != NULL)
-    {
-      gi_callable_info_load_return_type (callable_info, &retval_info);
-      bean_gi_argument_to_pointer (&retval_info, &retval, retval_ptr);
-      gi_base_info_clear (&retval_info);
-    }
-
-  gi_base_info_unref ((GIBaseInfo *) callable_info);
+    bean_gi_argument_to_pointer (method->return_kind, &retval, retval_ptr);
 
   return ret;
 }
@@ -248,22 +246,16 @@ bean_extension_callv (BeanExtension *exten,
                       GIArgument    *args,
                       GIArgument    *return_value)
 {
-  GICallableInfo *method_info;
-  GType gtype;
-  gboolean success;
+  BeanGIMethod *method;
 
   g_return_val_if_fail (BEAN_IS_EXTENSION (exten), FALSE);
   g_return_val_if_fail (method_name != NULL, FALSE);
 
-  method_info = get_method_info (exten, method_name, &gtype);
+  method = get_method (exten, method_name);
 
   /* Already warned */
-  if (method_info == NULL)
+  if (method == NULL)
     return FALSE;
 
-  success = bean_gi_method_call (G_OBJECT (exten), method_info, gtype,
-                                 method_name, args, return_value);
-
-  gi_base_info_unref (method_info);
-  return success;
+  return bean_gi_method_invoke (method, G_OBJECT (exten), args, return_value);
 }
@@ -27,224 +27,258 @@
 
 #include "bean-introspection.h"
 
-void
-bean_gi_valist_to_arguments (GICallableInfo *callable_info,
-                             va_list         va_args,
-                             GIArgument     *arguments,
-                             gpointer       *return_value)
+static BeanGIArgKind
+get_arg_kind (GITypeInfo *type_info)
 {
-  gint i, n_args;
-  GIArgument *cur_arg;
+  switch (gi_type_info_get_tag (type_info))
+    {
+    case GI_TYPE_TAG_BOOLEAN:
+      return BEAN_GI_ARG_BOOLEAN;
+    case GI_TYPE_TAG_INT8:
+      return BEAN_GI_ARG_INT8;
+    case GI_TYPE_TAG_UINT8:
+      return BEAN_GI_ARG_UINT8;
+    case GI_TYPE_TAG_INT16:
+      return BEAN_GI_ARG_INT16;
+    case GI_TYPE_TAG_UINT16:
+      return BEAN_GI_ARG_UINT16;
+    case GI_TYPE_TAG_INT32:
+      return BEAN_GI_ARG_INT32;
+    case GI_TYPE_TAG_UNICHAR:
+    case GI_TYPE_TAG_UINT32:
+      return BEAN_GI_ARG_UINT32;
+    case GI_TYPE_TAG_INT64:
+      return BEAN_GI_ARG_INT64;
+    case GI_TYPE_TAG_UINT64:
+      return BEAN_GI_ARG_UINT64;
+    case GI_TYPE_TAG_FLOAT:
+      return BEAN_GI_ARG_FLOAT;
+    case GI_TYPE_TAG_DOUBLE:
+      return BEAN_GI_ARG_DOUBLE;
+    case GI_TYPE_TAG_GTYPE:
+      return BEAN_GI_ARG_GTYPE;
+    case GI_TYPE_TAG_VOID:
+    case GI_TYPE_TAG_UTF8:
+    case GI_TYPE_TAG_FILENAME:
+    case GI_TYPE_TAG_ARRAY:
+    case GI_TYPE_TAG_INTERFACE:
+    case GI_TYPE_TAG_GLIST:
+    case GI_TYPE_TAG_GSLIST:
+    case GI_TYPE_TAG_GHASH:
+    case GI_TYPE_TAG_ERROR:
+      return BEAN_GI_ARG_POINTER;
+    default:
+      g_warn_if_reached ();
+      return BEAN_GI_ARG_POINTER;
+    }
+}
 
-  g_return_if_fail (callable_info != NULL);
+/* Compiles the signature of the method so that calls do
+ * not have to load the type info of each of its arguments
+ */
+static void
+compile_arguments (BeanGIMethod *method)
+{
+  gint i;
 
-  n_args = gi_callable_info_get_n_args (callable_info);
+  method->args = g_new (BeanGIArg, method->n_args);
 
-  for (i = 0; i < n_args; i++)
+  for (i = 0; i < method->n_args; ++i)
     {
+      BeanGIArg *arg = &method->args[i];
       GIArgInfo arg_info;
       GITypeInfo arg_type_info;
 
-      gi_callable_info_load_arg (callable_info, i, &arg_info);
-      gi_arg_info_load_type_info (&arg_info, &arg_type_info);
-      cur_arg = &arguments[i];
+      gi_callable_info_load_arg (method->info, i, &arg_info);
+      arg->direction = gi_arg_info_get_direction (&arg_info);
 
-      switch (gi_arg_info_get_direction (&arg_info))
+      /* In the other cases, we expect we will always have a pointer. */
+      if (arg->direction != GI_DIRECTION_IN)
         {
-        case GI_DIRECTION_IN:
-          {
-            /* Notes: According to GCC 4.4,
-             *  - int8, uint8, int16, uint16, short and ushort are promoted to int when passed through '...'
-             *  - float is promoted to double when passed through '...'
-             */
-            switch (gi_type_info_get_tag (&arg_type_info))
-              {
-              case GI_TYPE_TAG_VOID:
-                cur_arg->v_pointer = va_arg (va_args, gpointer);
-                break;
-              case GI_TYPE_TAG_BOOLEAN:
-                cur_arg->v_boolean = va_arg (va_args, gboolean);
-                break;
-              case GI_TYPE_TAG_INT8:
-                cur_arg->v_int8 = va_arg (va_args, gint);
-                break;
-              case GI_TYPE_TAG_UINT8:
-                cur_arg->v_uint8 = va_arg (va_args, gint);
-                break;
-              case GI_TYPE_TAG_INT16:
-                cur_arg->v_int16 = va_arg (va_args, gint);
-                break;
-              case GI_TYPE_TAG_UINT16:
-                cur_arg->v_uint16 = va_arg (va_args, gint);
-                break;
-              case GI_TYPE_TAG_INT32:
-                cur_arg->v_int32 = va_arg (va_args, gint32);
-                break;
-              case GI_TYPE_TAG_UNICHAR:
-              case GI_TYPE_TAG_UINT32:
-                cur_arg->v_uint32 = va_arg (va_args, guint32);
-                break;
-              case GI_TYPE_TAG_INT64:
-                cur_arg->v_int64 = va_arg (va_args, gint64);
-                break;
-              case GI_TYPE_TAG_UINT64:
-                cur_arg->v_uint64 = va_arg (va_args, guint64);
-                break;
-              case GI_TYPE_TAG_FLOAT:
-                cur_arg->v_float = va_arg (va_args, gdouble);
-                break;
-              case GI_TYPE_TAG_DOUBLE:
-                cur_arg->v_double = va_arg (va_args, gdouble);
-                break;
-              case GI_TYPE_TAG_GTYPE:
-                /* apparently, GType is meant to be a gsize, from gobject/gtype.h in glib */
-                cur_arg->v_size = va_arg (va_args, GType);
-                break;
-              case GI_TYPE_TAG_UTF8:
-              case GI_TYPE_TAG_FILENAME:
-                cur_arg->v_string = va_arg (va_args, gchar *);
-                break;
-              case GI_TYPE_TAG_ARRAY:
-              case GI_TYPE_TAG_INTERFACE:
-              case GI_TYPE_TAG_GLIST:
-              case GI_TYPE_TAG_GSLIST:
-              case GI_TYPE_TAG_GHASH:
-              case GI_TYPE_TAG_ERROR:
-                cur_arg->v_pointer = va_arg (va_args, gpointer);
-                break;
-              default:
-                g_warn_if_reached ();
-                cur_arg->v_pointer = va_arg (va_args, gpointer);
-                break;
-              }
-            break;
-          }
-        /* In the other cases, we expect we will always have a pointer. */
-        case GI_DIRECTION_INOUT:
-        case GI_DIRECTION_OUT:
-          cur_arg->v_pointer = va_arg (va_args, gpointer);
-          break;
+          arg->kind = BEAN_GI_ARG_POINTER;
+          continue;
         }
 
+      gi_arg_info_load_type_info (&arg_info, &arg_type_info);
+      arg->kind = get_arg_kind (&arg_type_info);
       gi_base_info_clear (&arg_type_info);
     }
 
-  if (return_value != NULL)
-    {
-      GITypeInfo retval_info;
-
-      gi_callable_info_load_return_type (callable_info, &retval_info);
-
-      if (gi_type_info_get_tag (&retval_info) != GI_TYPE_TAG_VOID)
-        *return_value = va_arg (va_args, gpointer);
-      else
-        *return_value = NULL;
-    }
+  if (gi_type_info_get_tag (method->return_type) == GI_TYPE_TAG_VOID)
+    method->return_kind = BEAN_GI_ARG_VOID;
+  else
+    method->return_kind = get_arg_kind (method->return_type);
 }
 
-static void
-bean_gi_split_in_and_out_arguments (GICallableInfo *callable_info,
-                                    GIArgument     *args,
-                                    GIArgument     *in_args,
-                                    guint          *n_in_args,
-                                    GIArgument     *out_args,
-                                    guint          *n_out_args)
+void
+bean_gi_valist_to_arguments (BeanGIMethod *method,
+                             va_list       va_args,
+                             GIArgument   *arguments,
+                             gpointer     *return_value)
 {
-  gint n_args, i;
-  GIArgInfo arg_info;
-
-  g_return_if_fail (callable_info != NULL);
+  gint i;
 
-  n_args = gi_callable_info_get_n_args (callable_info);
+  g_return_if_fail (method != NULL);
 
-  for (i = 0; i < n_args; i++)
+  for (i = 0; i < method->n_args; i++)
     {
-      gi_callable_info_load_arg (callable_info, i, &arg_info);
+      GIArgument *cur_arg = &arguments[i];
 
-      switch (gi_arg_info_get_direction (&arg_info))
+      /* Notes: According to GCC 4.4,
+       *  - int8, uint8, int16, uint16, short and ushort are promoted to int when passed through '...'
+       *  - float is promoted to double when passed through '...'
+       */
+      switch (method->args[i].kind)
         {
-        case GI_DIRECTION_IN:
-          in_args[(*n_in_args)++] = args[i];
+        case BEAN_GI_ARG_BOOLEAN:
+          cur_arg->v_boolean = va_arg (va_args, gboolean);
           break;
-        case GI_DIRECTION_INOUT:
-          in_args[(*n_in_args)++] = args[i];
-          out_args[(*n_out_args)++] = args[i];
+        case BEAN_GI_ARG_INT8:
+          cur_arg->v_int8 = va_arg (va_args, gint);
           break;
-        case GI_DIRECTION_OUT:
-          out_args[(*n_out_args)++] = args[i];
+        case BEAN_GI_ARG_UINT8:
+          cur_arg->v_uint8 = va_arg (va_args, gint);
+          break;
+        case BEAN_GI_ARG_INT16:
+          cur_arg->v_int16 = va_arg (va_args, gint);
+          break;
+        case BEAN_GI_ARG_UINT16:
+          cur_arg->v_uint16 = va_arg (va_args, gint);
+          break;
+        case BEAN_GI_ARG_INT32:
+          cur_arg->v_int32 = va_arg (va_args, gint32);
+          break;
+        case BEAN_GI_ARG_UINT32:
+          cur_arg->v_uint32 = va_arg (va_args, guint32);
+          break;
+        case BEAN_GI_ARG_INT64:
+          cur_arg->v_int64 = va_arg (va_args, gint64);
+          break;
+        case BEAN_GI_ARG_UINT64:
+          cur_arg->v_uint64 = va_arg (va_args, guint64);
+          break;
+        case BEAN_GI_ARG_FLOAT:
+          cur_arg->v_float = va_arg (va_args, gdouble);
+          break;
+        case BEAN_GI_ARG_DOUBLE:
+          cur_arg->v_double = va_arg (va_args, gdouble);
+          break;
+        case BEAN_GI_ARG_GTYPE:
+          /* apparently, GType is meant to be a gsize, from gobject/gtype.h in glib */
+          cur_arg->v_size = va_arg (va_args, GType);
+          break;
+        case BEAN_GI_ARG_POINTER:
+        default:
+          cur_arg->v_pointer = va_arg (va_args, gpointer);
           break;
         }
     }
+
+  if (return_value != NULL)
+    {
+      if (method->return_kind != BEAN_GI_ARG_VOID)
+        *return_value = va_arg (va_args, gpointer);
+      else
+        *return_value = NULL;
+    }
 }
 
 void
-bean_gi_argument_to_pointer (GITypeInfo     *type_info,
-                             GIArgument     *arg,
-                             gpointer        ptr)
+bean_gi_argument_to_pointer (BeanGIArgKind  kind,
+                             GIArgument    *arg,
+                             gpointer       ptr)
 {
-  switch (gi_type_info_get_tag (type_info))
+  switch (kind)
     {
-    case GI_TYPE_TAG_VOID:
-      *((gpointer **) ptr) = arg->v_pointer;
-      break;
-    case GI_TYPE_TAG_BOOLEAN:
+    case BEAN_GI_ARG_BOOLEAN:
       *((gboolean *) ptr) = arg->v_boolean;
       break;
-    case GI_TYPE_TAG_INT8:
+    case BEAN_GI_ARG_INT8:
       *((gint8 *) ptr) = arg->v_int8;
       break;
-    case GI_TYPE_TAG_UINT8:
+    case BEAN_GI_ARG_UINT8:
       *((guint8 *) ptr) = arg->v_uint8;
       break;
-    case GI_TYPE_TAG_INT16:
+    case BEAN_GI_ARG_INT16:
       *((gint16 *) ptr) = arg->v_int16;
       break;
-    case GI_TYPE_TAG_UINT16:
+    case BEAN_GI_ARG_UINT16:
       *((guint16 *) ptr) = arg->v_uint16;
       break;
-    case GI_TYPE_TAG_INT32:
+    case BEAN_GI_ARG_INT32:
       *((gint32 *) ptr) = arg->v_int32;
       break;
-    case GI_TYPE_TAG_UNICHAR:
-    case GI_TYPE_TAG_UINT32:
+    case BEAN_GI_ARG_UINT32:
       *((guint32 *) ptr) = arg->v_uint32;
       break;
-    case GI_TYPE_TAG_INT64:
+    case BEAN_GI_ARG_INT64:
       *((gint64 *) ptr) = arg->v_int64;
       break;
-    case GI_TYPE_TAG_UINT64:
+    case BEAN_GI_ARG_UINT64:
       *((guint64 *) ptr) = arg->v_uint64;
       break;
-    case GI_TYPE_TAG_FLOAT:
+    case BEAN_GI_ARG_FLOAT:
       *((gfloat *) ptr) = arg->v_float;
       break;
-    case GI_TYPE_TAG_DOUBLE:
+    case BEAN_GI_ARG_DOUBLE:
       *((gdouble *) ptr) = arg->v_double;
       break;
-    case GI_TYPE_TAG_GTYPE:
+    case BEAN_GI_ARG_GTYPE:
       /* apparently, GType is meant to be a gsize, from gobject/gtype.h in glib */
       *((gsize *) ptr) = arg->v_size;
       break;
-    case GI_TYPE_TAG_UTF8:
-    case GI_TYPE_TAG_FILENAME:
-      *((gchar **) ptr) = arg->v_string;
-      break;
-    case GI_TYPE_TAG_ARRAY:
-    case GI_TYPE_TAG_INTERFACE:
-    case GI_TYPE_TAG_GLIST:
-    case GI_TYPE_TAG_GSLIST:
-    case GI_TYPE_TAG_GHASH:
-    case GI_TYPE_TAG_ERROR:
-      *((gpointer **) ptr) = arg->v_pointer;
+    case BEAN_GI_ARG_POINTER:
+      *((gpointer *) ptr) = arg->v_pointer;
       break;
     default:
       g_return_if_reached ();
     }
 }
 
-GICallableInfo *
-bean_gi_get_method_info (GType        gtype,
-                         const gchar *method_name)
+/* Of GType to a GHashTable of method name to BeanGIMethod,
+ * or to %NULL if the type has no such method. Methods are
+ * never freed as the typelibs are never unloaded either.
+ */
+static GHashTable *method_cache = NULL;
+static GMutex method_cache_lock;
+
+static BeanGIMethod *
+method_new (GType           gtype,
+            const gchar    *method_name,
+            GICallableInfo *info)
+{
+  BeanGIMethod *method;
+  GError *error = NULL;
+
+  method = g_new0 (BeanGIMethod, 1);
+  method->gtype = gtype;
+  method->name = g_strdup (method_name);
+  method->info = info;
+  method->return_type = gi_callable_info_get_return_type (info);
+  method->n_args = gi_callable_info_get_n_args (info);
+  method->throws = gi_callable_info_can_throw_gerror (info);
+  compile_arguments (method);
+
+  /* Otherwise it is invoked without an invoker, which warns */
+  if (gi_function_info_prep_invoker (GI_FUNCTION_INFO (info),
+                                     &method->invoker, &error))
+    {
+      method->prepared = TRUE;
+    }
+  else
+    {
+      g_debug ("Failed to prepare the invoker of '%s.%s': %s",
+               g_type_name (gtype), method_name, error->message);
+      g_error_free (error);
+    }
+
+  return method;
+}
+
+static GICallableInfo *
+find_method_info (GType        gtype,
+                  const gchar *method_name,
+                  gboolean    *type_found)
 {
   GIRepository *repo;
   GIBaseInfo *type_info;
@@ -257,6 +291,7 @@ bean_gi_get_method_info (GType        gtype,
       g_warning ("Type not found in introspection: '%s'",
                  g_type_name (gtype));
       g_clear_object (&repo);
+      *type_found = FALSE;
       return NULL;
     }
 
@@ -270,58 +305,185 @@ bean_gi_get_method_info (GType        gtype,
   gi_base_info_unref (type_info);
   g_clear_object (&repo);
 
+  *type_found = TRUE;
   return GI_CALLABLE_INFO (func_info);
 }
 
-gboolean
-bean_gi_method_call (GObject        *instance,
-                     GICallableInfo *func_info,
-                     GType           gtype,
-                     const gchar    *method_name,
-                     GIArgument     *args,
-                     GIArgument     *return_value)
+/*
+ * bean_gi_lookup_method:
+ * @gtype: The #GType declaring the method.
+ * @method_name: The name of the method.
+ *
+ * Finds the introspection data of the method and prepares its
+ * invoker, only the first time it is looked up. This is thread-safe.
+ *
+ * Returns: (transfer none): the method, or %NULL if it does not exist.
+ */
+BeanGIMethod *
+bean_gi_lookup_method (GType        gtype,
+                       const gchar *method_name)
+{
+  GHashTable *methods;
+  BeanGIMethod *method = NULL;
+  GICallableInfo *info;
+  gboolean type_found;
+
+  g_mutex_lock (&method_cache_lock);
+
+  if (G_UNLIKELY (method_cache == NULL))
+    method_cache = g_hash_table_new (NULL, NULL);
+
+  methods = g_hash_table_lookup (method_cache, GSIZE_TO_POINTER (gtype));
+
+  if (methods != NULL &&
+      g_hash_table_lookup_extended (methods, method_name,
+                                    NULL, (gpointer *) &method))
+    {
+      g_mutex_unlock (&method_cache_lock);
+      return method;
+    }
+
+  info = find_method_info (gtype, method_name, &type_found);
+
+  /* Its typelib might be required later on */
+  if (!type_found)
+    {
+      g_mutex_unlock (&method_cache_lock);
+      return NULL;
+    }
+
+  if (methods == NULL)
+    {
+      methods = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      g_hash_table_insert (method_cache, GSIZE_TO_POINTER (gtype), methods);
+    }
+
+  if (info != NULL)
+    method = method_new (gtype, method_name, info);
+
+  g_hash_table_insert (methods, g_strdup (method_name), method);
+
+  g_mutex_unlock (&method_cache_lock);
+  return method;
+}
+
+/* Used if the invoker could not be prepared */
+static gboolean
+method_call (BeanGIMethod *method,
+             GObject      *instance,
+             GIArgument   *args,
+             GIArgument   *return_value)
 {
-  gint n_args;
   guint n_in_args, n_out_args;
   GIArgument *in_args, *out_args;
   gboolean ret = TRUE;
+  gint i;
   GError *error = NULL;
 
-  g_return_val_if_fail (G_IS_OBJECT (instance), FALSE);
-  g_return_val_if_fail (func_info != NULL, FALSE);
-  g_return_val_if_fail (G_TYPE_IS_INTERFACE (gtype) ||
-                        G_TYPE_IS_ABSTRACT (gtype), FALSE);
-  g_return_val_if_fail (G_TYPE_CHECK_INSTANCE_TYPE (instance, gtype),
-                        FALSE);
-  g_return_val_if_fail (method_name != NULL, FALSE);
-
-  n_args = gi_callable_info_get_n_args (func_info);
-  g_return_val_if_fail (n_args >= 0, FALSE);
-  n_in_args = 0;
-  n_out_args = 0;
-
-  in_args = g_newa (GIArgument, n_args + 1);
-  out_args = g_newa (GIArgument, n_args);
-
-  bean_gi_split_in_and_out_arguments (func_info, args,
-                                      in_args+1, &n_in_args,
-                                      out_args, &n_out_args);
+  in_args = g_newa (GIArgument, method->n_args + 1);
+  out_args = g_newa (GIArgument, method->n_args);
 
   /* Set the object as the first argument for the method. */
   in_args[0].v_pointer = instance;
-  n_in_args++;
+  n_in_args = 1;
+  n_out_args = 0;
+
+  for (i = 0; i < method->n_args; i++)
+    {
+      switch (method->args[i].direction)
+        {
+        case GI_DIRECTION_IN:
+          in_args[n_in_args++] = args[i];
+          break;
+        case GI_DIRECTION_INOUT:
+          in_args[n_in_args++] = args[i];
+          out_args[n_out_args++] = args[i];
+          break;
+        case GI_DIRECTION_OUT:
+          out_args[n_out_args++] = args[i];
+          break;
+        }
+    }
 
   g_debug ("Calling '%s.%s' on '%p'",
-           g_type_name (gtype), method_name, instance);
+           g_type_name (method->gtype), method->name, instance);
 
-  ret = gi_function_info_invoke (GI_FUNCTION_INFO (func_info), in_args, n_in_args, out_args,
+  ret = gi_function_info_invoke (GI_FUNCTION_INFO (method->info),
+                                 in_args, n_in_args, out_args,
                                  n_out_args, return_value, &error);
   if (!ret)
     {
       g_warning ("Error while calling '%s.%s': %s",
-                 g_type_name (gtype), method_name, error->message);
+                 g_type_name (method->gtype), method->name, error->message);
       g_error_free (error);
     }
 
   return ret;
 }
+
+/*
+ * bean_gi_method_invoke:
+ * @method: A #BeanGIMethod.
+ * @instance: The instance to call the method on.
+ * @args: The arguments of the method.
+ * @return_value: (out caller-allocates) (allow-none): Return location
+ *  for the return value.
+ *
+ * Calls the method with its prepared invoker, so that the
+ * arguments are passed as they are to a single ffi call.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+bean_gi_method_invoke (BeanGIMethod *method,
+                       GObject      *instance,
+                       GIArgument   *args,
+                       GIArgument   *return_value)
+{
+  gpointer *ffi_args;
+  GIFFIReturnValue ffi_return_value;
+  GError *error = NULL;
+  GError **error_ptr = &error;
+  gint i;
+
+  g_return_val_if_fail (method != NULL, FALSE);
+  g_return_val_if_fail (G_TYPE_CHECK_INSTANCE_TYPE (instance, method->gtype),
+                        FALSE);
+
+  if (!method->prepared)
+    {
+      return method_call (method, instance, args, return_value);
+    }
+
+  ffi_args = g_newa (gpointer, method->n_args + 2);
+
+  /* In, in-out and out arguments are all passed as the
+   * address of their GIArgument, see gi_function_info_invoke()
+   */
+  ffi_args[0] = &instance;
+  for (i = 0; i < method->n_args; ++i)
+    ffi_args[i + 1] = &args[i];
+
+  if (method->throws)
+    ffi_args[method->n_args + 1] = &error_ptr;
+
+  g_debug ("Calling '%s.%s' on '%p'",
+           g_type_name (method->gtype), method->name, instance);
+
+  ffi_call (&method->invoker.cif, method->invoker.native_address,
+            &ffi_return_value, ffi_args);
+
+  if (error != NULL)
+    {
+      g_warning ("Error while calling '%s.%s': %s",
+                 g_type_name (method->gtype), method->name, error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  if (return_value != NULL)
+    gi_type_info_extract_ffi_return_value (method->return_type,
+                                           &ffi_return_value, return_value);
+
+  return TRUE;
+}
@@ -27,22 +27,65 @@
 
 G_BEGIN_DECLS
 
-GICallableInfo  *bean_gi_get_method_info          (GType           gtype,
+typedef struct _BeanGIMethod BeanGIMethod;
+
+/* How an argument is passed through varargs and stored in a GIArgument */
+typedef enum {
+  BEAN_GI_ARG_VOID,
+  BEAN_GI_ARG_POINTER,
+  BEAN_GI_ARG_BOOLEAN,
+  BEAN_GI_ARG_INT8,
+  BEAN_GI_ARG_UINT8,
+  BEAN_GI_ARG_INT16,
+  BEAN_GI_ARG_UINT16,
+  BEAN_GI_ARG_INT32,
+  BEAN_GI_ARG_UINT32,
+  BEAN_GI_ARG_INT64,
+  BEAN_GI_ARG_UINT64,
+  BEAN_GI_ARG_FLOAT,
+  BEAN_GI_ARG_DOUBLE,
+  BEAN_GI_ARG_GTYPE
+} BeanGIArgKind;
+
+typedef struct {
+  guint8 kind;
+  guint8 direction;
+} BeanGIArg;
+
+/* A method resolved once and kept for the lifetime of the process */
+struct _BeanGIMethod {
+  GType gtype;
+  gchar *name;
+
+  GICallableInfo *info;
+  GITypeInfo *return_type;
+  gint n_args;
+
+  /* The signature compiled once, see compile_arguments() */
+  BeanGIArg *args;
+  BeanGIArgKind return_kind;
+
+  /* Only valid if prepared */
+  GIFunctionInvoker invoker;
+
+  guint prepared : 1;
+  guint throws : 1;
+};
+
+BeanGIMethod    *bean_gi_lookup_method            (GType           gtype,
                                                    const gchar    *method_name);
+gboolean         bean_gi_method_invoke            (BeanGIMethod   *method,
+                                                   GObject        *instance,
+                                                   GIArgument     *args,
+                                                   GIArgument     *return_value);
 
-void             bean_gi_valist_to_arguments      (GICallableInfo *callable_info,
+void             bean_gi_valist_to_arguments      (BeanGIMethod   *method,
                                                    va_list         va_args,
                                                    GIArgument     *arguments,
                                                    gpointer       *return_value);
-void             bean_gi_argument_to_pointer      (GITypeInfo     *type_info,
+void             bean_gi_argument_to_pointer      (BeanGIArgKind   kind,
                                                    GIArgument     *arg,
                                                    gpointer        ptr);
-gboolean         bean_gi_method_call              (GObject        *instance,
-                                                   GICallableInfo *method_info,
-                                                   GType           gtype,
-                                                   const gchar    *method_name,
-                                                   GIArgument     *args,
-                                                   GIArgument     *return_value);
 
 G_END_DECLS
 
@@ -0,0 +1,474 @@
+/*
+ * bean-load-profile.c
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#include "config.h"
+
+/* For RUSAGE_THREAD */
+#if defined (HAVE_RUSAGE_THREAD) && !defined (_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include "bean-load-profile.h"
+
+/* The profile lists the plugins which were loaded by their loader
+ * during a run, in the order they were loaded, with how long it took
+ * and how many blocks were read from the disk meanwhile. This
+ * includes initializing the loader for the first plugin using it.
+ * Only the first time each plugin was loaded is recorded.
+ *
+ * How long it took is also broken down into phases: initializing
+ * the loader, opening the module and registering its types for
+ * C plugins, and importing the plugin for the other loaders.
+ *
+ * The blocks are counted for the thread loading the plugin where
+ * RUSAGE_THREAD is available. Elsewhere they are counted for the
+ * whole process, so plugins loaded in parallel are also counted
+ * the blocks read for each other.
+ *
+ * It is a single serialized GVariant which is replaced by the
+ * profile of the current run when the engine is disposed.
+ *
+ * The magic number doubles as a version and endianness check,
+ * bump it whenever the format changes.
+ */
+#define PROFILE_MAGIC 0x42504c02
+#define PROFILE_TYPE  "(ua(sxt(xxxx)))"
+
+G_STATIC_ASSERT (BEAN_LOAD_N_PHASES == 4);
+
+typedef struct {
+  gchar *module_name;
+  gint64 duration;
+  guint64 blocks_read;
+  gint64 phases[BEAN_LOAD_N_PHASES];
+} ProfileEntry;
+
+typedef struct {
+  gint position;
+  gint64 duration;
+  gint64 phases[BEAN_LOAD_N_PHASES];
+} PreviousEntry;
+
+struct _BeanLoadProfile {
+  GMutex lock;
+
+  /* Of module name to PreviousEntry, from the previous run */
+  GHashTable *previous;
+
+  /* Of ProfileEntry, in the order the plugins were loaded */
+  GArray *entries;
+
+  /* Of the module names in entries */
+  GHashTable *recorded;
+};
+
+static void
+profile_entry_clear (ProfileEntry *entry)
+{
+  g_free (entry->module_name);
+}
+
+BeanLoadProfile *
+bean_load_profile_new (void)
+{
+  BeanLoadProfile *profile;
+
+  profile = g_new0 (BeanLoadProfile, 1);
+  g_mutex_init (&profile->lock);
+  profile->previous = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, g_free);
+  profile->entries = g_array_new (FALSE, FALSE, sizeof (ProfileEntry));
+  g_array_set_clear_func (profile->entries,
+                          (GDestroyNotify) profile_entry_clear);
+  profile->recorded = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return profile;
+}
+
+void
+bean_load_profile_free (BeanLoadProfile *profile)
+{
+  if (profile == NULL)
+    return;
+
+  g_hash_table_unref (profile->previous);
+  g_hash_table_unref (profile->recorded);
+  g_array_unref (profile->entries);
+  g_mutex_clear (&profile->lock);
+  g_free (profile);
+}
+
+/*
+ * bean_load_profile_load:
+ * @profile: A #BeanLoadProfile.
+ * @filename: The file where the profile is stored.
+ *
+ * Reads the profile of the previous run from @filename.
+ */
+void
+bean_load_profile_load (BeanLoadProfile *profile,
+                        const gchar     *filename)
+{
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *variant;
+  GVariantIter *iter;
+  const gchar *module_name;
+  gint64 duration;
+  guint64 blocks_read;
+  gint64 phases[BEAN_LOAD_N_PHASES];
+  guint32 magic;
+  gint position = 0;
+  GError *error = NULL;
+
+  mapped = g_mapped_file_new (filename, FALSE, &error);
+
+  if (mapped == NULL)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_debug ("Failed to open load profile: %s", error->message);
+
+      g_error_free (error);
+      return;
+    }
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  variant = g_variant_new_from_bytes (G_VARIANT_TYPE (PROFILE_TYPE),
+                                      bytes, FALSE);
+  g_variant_ref_sink (variant);
+  g_bytes_unref (bytes);
+
+  g_variant_get (variant, "(ua(sxt(xxxx)))", &magic, &iter);
+
+  if (magic != PROFILE_MAGIC)
+    {
+      g_debug ("Ignoring incompatible load profile '%s'", filename);
+      goto out;
+    }
+
+  g_mutex_lock (&profile->lock);
+
+  while (g_variant_iter_next (iter, "(&sxt(xxxx))",
+                              &module_name, &duration, &blocks_read,
+                              &phases[BEAN_LOAD_PHASE_LOADER_INIT],
+                              &phases[BEAN_LOAD_PHASE_MODULE_OPEN],
+                              &phases[BEAN_LOAD_PHASE_REGISTER_TYPES],
+                              &phases[BEAN_LOAD_PHASE_IMPORT]))
+    {
+      PreviousEntry *entry;
+
+      /* Only the first load counts */
+      if (g_hash_table_contains (profile->previous, module_name))
+        continue;
+
+      entry = g_new (PreviousEntry, 1);
+      entry->position = position++;
+      entry->duration = duration;
+      memcpy (entry->phases, phases, sizeof (phases));
+
+      g_hash_table_insert (profile->previous, g_strdup (module_name), entry);
+    }
+
+  g_mutex_unlock (&profile->lock);
+
+  g_debug ("Loaded load profile '%s'", filename);
+
+out:
+
+  g_variant_iter_free (iter);
+  g_variant_unref (variant);
+}
+
+/*
+ * bean_load_profile_save:
+ * @profile: A #BeanLoadProfile.
+ * @filename: The file where the profile is stored.
+ *
+ * Atomically replaces @filename with what was recorded in @profile,
+ * unless nothing was so that the previous profile is kept.
+ *
+ * Returns: %TRUE if the profile was written.
+ */
+gboolean
+bean_load_profile_save (BeanLoadProfile *profile,
+                        const gchar     *filename)
+{
+  GVariantBuilder entries;
+  GVariant *variant;
+  gchar *dirname;
+  guint i;
+  gboolean saved;
+  GError *error = NULL;
+
+  g_mutex_lock (&profile->lock);
+
+  if (profile->entries->len == 0)
+    {
+      g_mutex_unlock (&profile->lock);
+      return FALSE;
+    }
+
+  g_variant_builder_init (&entries, G_VARIANT_TYPE ("a(sxt(xxxx))"));
+
+  for (i = 0; i < profile->entries->len; ++i)
+    {
+      ProfileEntry *entry = &g_array_index (profile->entries, ProfileEntry, i);
+
+      g_variant_builder_add (&entries, "(sxt(xxxx))", entry->module_name,
+                             entry->duration, entry->blocks_read,
+                             entry->phases[BEAN_LOAD_PHASE_LOADER_INIT],
+                             entry->phases[BEAN_LOAD_PHASE_MODULE_OPEN],
+                             entry->phases[BEAN_LOAD_PHASE_REGISTER_TYPES],
+                             entry->phases[BEAN_LOAD_PHASE_IMPORT]);
+    }
+
+  g_mutex_unlock (&profile->lock);
+
+  variant = g_variant_new ("(ua(sxt(xxxx)))", (guint32) PROFILE_MAGIC,
+                           &entries);
+  g_variant_ref_sink (variant);
+
+  dirname = g_path_get_dirname (filename);
+
+  if (g_mkdir_with_parents (dirname, 0755) != 0)
+    {
+      g_debug ("Failed to create load profile directory '%s': %s",
+               dirname, g_strerror (errno));
+      saved = FALSE;
+    }
+  else if (!g_file_set_contents (filename,
+                                 g_variant_get_data (variant),
+                                 g_variant_get_size (variant),
+                                 &error))
+    {
+      g_debug ("Failed to write load profile: %s", error->message);
+      g_error_free (error);
+      saved = FALSE;
+    }
+  else
+    {
+      g_debug ("Saved load profile '%s'", filename);
+      saved = TRUE;
+    }
+
+  g_free (dirname);
+  g_variant_unref (variant);
+
+  return saved;
+}
+
+/*
+ * bean_load_profile_is_empty:
+ * @profile: A #BeanLoadProfile.
+ *
+ * Returns: %TRUE if there is no profile of the previous run.
+ */
+gboolean
+bean_load_profile_is_empty (BeanLoadProfile *profile)
+{
+  gboolean empty;
+
+  g_mutex_lock (&profile->lock);
+  empty = g_hash_table_size (profile->previous) == 0;
+  g_mutex_unlock (&profile->lock);
+
+  return empty;
+}
+
+/*
+ * bean_load_profile_get_position:
+ * @profile: A #BeanLoadProfile.
+ * @module_name: The module name of the plugin.
+ *
+ * Returns: when the plugin was loaded during the previous
+ * run compared to the other plugins, or -1 if it was not.
+ */
+gint
+bean_load_profile_get_position (BeanLoadProfile *profile,
+                                const gchar     *module_name)
+{
+  PreviousEntry *entry;
+  gint position;
+
+  g_mutex_lock (&profile->lock);
+  entry = g_hash_table_lookup (profile->previous, module_name);
+  position = entry != NULL ? entry->position : -1;
+  g_mutex_unlock (&profile->lock);
+
+  return position;
+}
+
+/*
+ * bean_load_profile_get_duration:
+ * @profile: A #BeanLoadProfile.
+ * @module_name: The module name of the plugin.
+ *
+ * Returns: how long loading the plugin took during the previous
+ * run in microseconds, or -1 if it was not loaded.
+ */
+gint64
+bean_load_profile_get_duration (BeanLoadProfile *profile,
+                                const gchar     *module_name)
+{
+  PreviousEntry *entry;
+  gint64 duration;
+
+  g_mutex_lock (&profile->lock);
+  entry = g_hash_table_lookup (profile->previous, module_name);
+  duration = entry != NULL ? entry->duration : -1;
+  g_mutex_unlock (&profile->lock);
+
+  return duration;
+}
+
+/*
+ * bean_load_profile_get_phase_duration:
+ * @profile: A #BeanLoadProfile.
+ * @module_name: The module name of the plugin.
+ * @phase: A #BeanLoadPhase.
+ *
+ * Returns: how long @phase took when loading the plugin during the
+ * previous run in microseconds, or -1 if it was not loaded.
+ */
+gint64
+bean_load_profile_get_phase_duration (BeanLoadProfile *profile,
+                                      const gchar     *module_name,
+                                      BeanLoadPhase    phase)
+{
+  PreviousEntry *entry;
+  gint64 duration;
+
+  g_return_val_if_fail (phase < BEAN_LOAD_N_PHASES, -1);
+
+  g_mutex_lock (&profile->lock);
+  entry = g_hash_table_lookup (profile->previous, module_name);
+  duration = entry != NULL ? entry->phases[phase] : -1;
+  g_mutex_unlock (&profile->lock);
+
+  return duration;
+}
+
+static guint64
+get_blocks_read (void)
+{
+#ifdef HAVE_GETRUSAGE
+  struct rusage usage;
+
+#ifdef HAVE_RUSAGE_THREAD
+  if (getrusage (RUSAGE_THREAD, &usage) == 0)
+#else
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+#endif
+    return usage.ru_inblock;
+#endif
+
+  return 0;
+}
+
+/*
+ * bean_load_timing_start:
+ * @timing: A #BeanLoadTiming.
+ *
+ * Starts timing the load of a plugin, bean_load_timing_stop()
+ * must then be called on the same thread.
+ */
+void
+bean_load_timing_start (BeanLoadTiming *timing)
+{
+  memset (timing, 0, sizeof (BeanLoadTiming));
+
+  timing->start_blocks_read = get_blocks_read ();
+  timing->start_time = g_get_monotonic_time ();
+}
+
+/*
+ * bean_load_timing_stop:
+ * @timing: A #BeanLoadTiming.
+ *
+ * Sets how long the load took and how many blocks were read since
+ * bean_load_timing_start(). The phases are left as they are.
+ */
+void
+bean_load_timing_stop (BeanLoadTiming *timing)
+{
+  guint64 blocks_read;
+
+  timing->duration = g_get_monotonic_time () - timing->start_time;
+
+  blocks_read = get_blocks_read ();
+  timing->blocks_read = blocks_read - MIN (blocks_read,
+                                           timing->start_blocks_read);
+}
+
+/*
+ * bean_load_profile_record:
+ * @profile: A #BeanLoadProfile.
+ * @module_name: The module name of the plugin.
+ * @timing: The stopped #BeanLoadTiming of the load.
+ *
+ * Records that the plugin was just loaded, unless it was already
+ * loaded before. This is thread-safe.
+ */
+void
+bean_load_profile_record (BeanLoadProfile      *profile,
+                          const gchar          *module_name,
+                          const BeanLoadTiming *timing)
+{
+  ProfileEntry entry;
+
+  g_debug ("Loaded '%s' in %" G_GINT64_FORMAT " us: loader %"
+           G_GINT64_FORMAT " us, open %" G_GINT64_FORMAT " us, register %"
+           G_GINT64_FORMAT " us, import %" G_GINT64_FORMAT " us",
+           module_name, timing->duration,
+           timing->phases[BEAN_LOAD_PHASE_LOADER_INIT],
+           timing->phases[BEAN_LOAD_PHASE_MODULE_OPEN],
+           timing->phases[BEAN_LOAD_PHASE_REGISTER_TYPES],
+           timing->phases[BEAN_LOAD_PHASE_IMPORT]);
+
+  entry.duration = timing->duration;
+  entry.blocks_read = timing->blocks_read;
+  memcpy (entry.phases, timing->phases, sizeof (entry.phases));
+
+  g_mutex_lock (&profile->lock);
+
+  /* Plugins which are loaded and unloaded repeatedly
+   * must not make the profile grow without bound
+   */
+  if (!g_hash_table_contains (profile->recorded, module_name))
+    {
+      entry.module_name = g_strdup (module_name);
+      g_array_append_val (profile->entries, entry);
+      g_hash_table_add (profile->recorded, entry.module_name);
+    }
+
+  g_mutex_unlock (&profile->lock);
+}
@@ -0,0 +1,77 @@
+/*
+ * bean-load-profile.h
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#ifndef __BEAN_LOAD_PROFILE_H__
+#define __BEAN_LOAD_PROFILE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BeanLoadProfile BeanLoadProfile;
+
+typedef enum {
+  BEAN_LOAD_PHASE_LOADER_INIT,
+  BEAN_LOAD_PHASE_MODULE_OPEN,
+  BEAN_LOAD_PHASE_REGISTER_TYPES,
+  BEAN_LOAD_PHASE_IMPORT,
+  BEAN_LOAD_N_PHASES
+} BeanLoadPhase;
+
+typedef struct {
+  gint64 start_time;
+  guint64 start_blocks_read;
+
+  /* Set by bean_load_timing_stop() */
+  gint64 duration;
+  guint64 blocks_read;
+
+  /* In microseconds, added up by the caller */
+  gint64 phases[BEAN_LOAD_N_PHASES];
+} BeanLoadTiming;
+
+BeanLoadProfile *bean_load_profile_new                (void);
+void             bean_load_profile_free               (BeanLoadProfile *profile);
+
+void             bean_load_profile_load               (BeanLoadProfile *profile,
+                                                       const gchar     *filename);
+gboolean         bean_load_profile_save               (BeanLoadProfile *profile,
+                                                       const gchar     *filename);
+
+gboolean         bean_load_profile_is_empty           (BeanLoadProfile *profile);
+gint             bean_load_profile_get_position       (BeanLoadProfile *profile,
+                                                       const gchar     *module_name);
+gint64           bean_load_profile_get_duration       (BeanLoadProfile *profile,
+                                                       const gchar     *module_name);
+gint64           bean_load_profile_get_phase_duration (BeanLoadProfile *profile,
+                                                       const gchar     *module_name,
+                                                       BeanLoadPhase    phase);
+
+void             bean_load_profile_record             (BeanLoadProfile      *profile,
+                                                       const gchar          *module_name,
+                                                       const BeanLoadTiming *timing);
+
+void             bean_load_timing_start               (BeanLoadTiming  *timing);
+void             bean_load_timing_stop                (BeanLoadTiming  *timing);
+
+G_END_DECLS
+
+#endif /* __BEAN_LOAD_PROFILE_H__ */
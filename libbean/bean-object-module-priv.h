@@ -0,0 +1,38 @@
+/*
+ * bean-object-module-priv.h
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#ifndef __BEAN_OBJECT_MODULE_PRIV_H__
+#define __BEAN_OBJECT_MODULE_PRIV_H__
+
+#include "bean-object-module.h"
+
+G_BEGIN_DECLS
+
+GType _bean_object_module_get_implementation_type (BeanObjectModule *module,
+                                                   GType             exten_type,
+                                                   gboolean         *has_plugin_info);
+void  _bean_object_module_take_load_times         (BeanObjectModule *module,
+                                                   gint64           *open_time,
+                                                   gint64           *register_time);
+
+G_END_DECLS
+
+#endif /* __BEAN_OBJECT_MODULE_PRIV_H__ */
@@ -27,7 +27,7 @@
 
 #include <string.h>
 
-#include "bean-object-module.h"
+#include "bean-object-module-priv.h"
 #include "bean-plugin-loader.h"
 
 /**
@@ -70,10 +70,19 @@ struct _BeanObjectModulePrivate {
   BeanObjectModuleRegisterFunc register_func;
   GArray *implementations;
 
+  /* Of exten_type to the index of its implementation plus one,
+   * only once there are too many implementations to scan them
+   */
+  GHashTable *implementations_index;
+
   gchar *path;
   gchar *module_name;
   gchar *symbol;
 
+  /* How long the last load took, see _bean_object_module_take_load_times() */
+  gint64 open_time;
+  gint64 register_time;
+
   guint resident : 1;
   guint local_linkage : 1;
 };
@@ -87,16 +96,79 @@ G_DEFINE_TYPE_WITH_PRIVATE (BeanObjectModule,
 
 #define TYPE_MISSING_PLUGIN_INFO_PROPERTY (G_TYPE_FLAG_RESERVED_ID_BIT)
 
+/* Most modules only register a few implementations */
+#define MAX_IMPLEMENTATIONS_SCANNED 8
+
 static const gchar *intern_plugin_info = NULL;
 
+static ExtensionImplementation *
+find_implementation (BeanObjectModule *module,
+                     GType             exten_type)
+{
+  BeanObjectModulePrivate *priv = GET_PRIV (module);
+  ExtensionImplementation *impls;
+  guint i;
+
+  impls = (ExtensionImplementation *) priv->implementations->data;
+
+  if (priv->implementations_index != NULL)
+    {
+      i = GPOINTER_TO_UINT (g_hash_table_lookup (priv->implementations_index,
+                                                 GSIZE_TO_POINTER (exten_type)));
+
+      return i != 0 ? &impls[i - 1] : NULL;
+    }
+
+  for (i = 0; i < priv->implementations->len; ++i)
+    {
+      if (impls[i].exten_type == exten_type)
+        return &impls[i];
+    }
+
+  return NULL;
+}
+
+static void
+index_implementations (BeanObjectModule *module)
+{
+  BeanObjectModulePrivate *priv = GET_PRIV (module);
+  ExtensionImplementation *impls;
+  guint i;
+
+  if (priv->implementations_index == NULL)
+    {
+      if (priv->implementations->len <= MAX_IMPLEMENTATIONS_SCANNED)
+        return;
+
+      priv->implementations_index = g_hash_table_new (NULL, NULL);
+      i = 0;
+    }
+  else
+    {
+      /* Only the new implementation */
+      i = priv->implementations->len - 1;
+    }
+
+  impls = (ExtensionImplementation *) priv->implementations->data;
+  for (; i < priv->implementations->len; ++i)
+    {
+      g_hash_table_insert (priv->implementations_index,
+                           GSIZE_TO_POINTER (impls[i].exten_type),
+                           GUINT_TO_POINTER (i + 1));
+    }
+}
+
 static gboolean
 bean_object_module_load (GTypeModule *gmodule)
 {
   BeanObjectModule *module = BEAN_OBJECT_MODULE (gmodule);
   BeanObjectModulePrivate *priv = GET_PRIV (module);
+  gint64 start_time;
 
   g_return_val_if_fail (priv->module_name != NULL, FALSE);
 
+  start_time = g_get_monotonic_time ();
+
   if (priv->path == NULL)
     {
       g_return_val_if_fail (priv->resident, FALSE);
@@ -162,8 +234,13 @@ bean_object_module_load (GTypeModule *gmodule)
   if (priv->resident)
     g_module_make_resident (priv->library);
 
+  priv->open_time = g_get_monotonic_time () - start_time;
+  start_time += priv->open_time;
+
   priv->register_func (module);
 
+  priv->register_time = g_get_monotonic_time () - start_time;
+
   return TRUE;
 }
 
@@ -189,6 +266,7 @@ bean_object_module_unload (GTypeModule *gmodule)
 
   g_array_remove_range (priv->implementations, 0,
                         priv->implementations->len);
+  g_clear_pointer (&priv->implementations_index, g_hash_table_unref);
 }
 
 static void
@@ -210,6 +288,7 @@ bean_object_module_finalize (GObject *object)
   g_free (priv->module_name);
   g_free (priv->symbol);
   g_array_unref (priv->implementations);
+  g_clear_pointer (&priv->implementations_index, g_hash_table_unref);
 
   G_OBJECT_CLASS (bean_object_module_parent_class)->finalize (object);
 }
@@ -456,22 +535,17 @@ bean_object_module_create_object (BeanObjectModule *module,
                                   const gchar     **prop_names,
                                   GValue           *prop_values)
 {
-  BeanObjectModulePrivate *priv = GET_PRIV (module);
-  guint i;
-  ExtensionImplementation *impls;
+  ExtensionImplementation *impl;
 
   g_return_val_if_fail (BEAN_IS_OBJECT_MODULE (module), NULL);
   g_return_val_if_fail (G_TYPE_IS_INTERFACE (exten_type) ||
                         G_TYPE_IS_ABSTRACT (exten_type), NULL);
 
-  impls = (ExtensionImplementation *) priv->implementations->data;
-  for (i = 0; i < priv->implementations->len; ++i)
-    {
-      if (impls[i].exten_type == exten_type)
-        return impls[i].func (n_properties, prop_names, prop_values, impls[i].user_data);
-    }
+  impl = find_implementation (module, exten_type);
+  if (impl == NULL)
+    return NULL;
 
-  return NULL;
+  return impl->func (n_properties, prop_names, prop_values, impl->user_data);
 }
 
 /**
@@ -490,22 +564,11 @@ gboolean
 bean_object_module_provides_object (BeanObjectModule *module,
                                     GType             exten_type)
 {
-  BeanObjectModulePrivate *priv = GET_PRIV (module);
-  guint i;
-  ExtensionImplementation *impls;
-
   g_return_val_if_fail (BEAN_IS_OBJECT_MODULE (module), FALSE);
   g_return_val_if_fail (G_TYPE_IS_INTERFACE (exten_type) ||
                         G_TYPE_IS_ABSTRACT (exten_type), FALSE);
 
-  impls = (ExtensionImplementation *) priv->implementations->data;
-  for (i = 0; i < priv->implementations->len; ++i)
-    {
-      if (impls[i].exten_type == exten_type)
-        return TRUE;
-    }
-
-  return FALSE;
+  return find_implementation (module, exten_type) != NULL;
 }
 
 /**
@@ -620,6 +683,7 @@ bean_object_module_register_extension_factory (BeanObjectModule *module,
   g_return_if_fail (factory_func != NULL);
 
   g_array_append_val (priv->implementations, impl);
+  index_implementations (module);
 
   g_debug ("Registered extension for type '%s'", g_type_name (exten_type));
 }
@@ -658,6 +722,66 @@ create_gobject_from_type (guint         n_properties,
   return g_object_new_with_properties (impl_type, n_properties, prop_names, prop_values);
 }
 
+/*
+ * _bean_object_module_get_implementation_type:
+ * @module: A #BeanObjectModule.
+ * @exten_type: The #GType of the extension.
+ * @has_plugin_info: (out): Return location for whether the
+ *  implementation has a "plugin-info" property.
+ *
+ * Gets the type registered with bean_object_module_register_extension_type()
+ * so that it can be instantiated directly.
+ *
+ * Returns: the type implementing @exten_type, or %G_TYPE_INVALID if
+ * there is none or it was registered with a #BeanFactoryFunc.
+ */
+GType
+_bean_object_module_get_implementation_type (BeanObjectModule *module,
+                                             GType             exten_type,
+                                             gboolean         *has_plugin_info)
+{
+  ExtensionImplementation *impl;
+  GType impl_type;
+
+  g_return_val_if_fail (BEAN_IS_OBJECT_MODULE (module), G_TYPE_INVALID);
+
+  impl = find_implementation (module, exten_type);
+  if (impl == NULL || impl->func != create_gobject_from_type)
+    return G_TYPE_INVALID;
+
+  impl_type = GPOINTER_TO_SIZE (impl->user_data);
+  *has_plugin_info = (impl_type & TYPE_MISSING_PLUGIN_INFO_PROPERTY) == 0;
+
+  return impl_type & ~TYPE_MISSING_PLUGIN_INFO_PROPERTY;
+}
+
+/*
+ * _bean_object_module_take_load_times:
+ * @module: A #BeanObjectModule.
+ * @open_time: (out): Return location for how long opening the library took.
+ * @register_time: (out): Return location for how long registering
+ *  the types of the module took.
+ *
+ * Gets how long the last successful load of @module took, in microseconds.
+ * The times are reset so that they are only taken once, even if the
+ * module is used again without being loaded.
+ */
+void
+_bean_object_module_take_load_times (BeanObjectModule *module,
+                                    gint64           *open_time,
+                                    gint64           *register_time)
+{
+  BeanObjectModulePrivate *priv = GET_PRIV (module);
+
+  g_return_if_fail (BEAN_IS_OBJECT_MODULE (module));
+
+  *open_time = priv->open_time;
+  *register_time = priv->register_time;
+
+  priv->open_time = 0;
+  priv->register_time = 0;
+}
+
 /**
  * bean_object_module_register_extension_type:
  * @module: Your plugin's #BeanObjectModule.
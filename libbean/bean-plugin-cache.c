@@ -0,0 +1,548 @@
+/*
+ * bean-plugin-cache.c
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "bean-plugin-cache.h"
+#include "bean-plugin-info-priv.h"
+#include "bean-utils.h"
+
+/* The cache is a single serialized GVariant per search path which
+ * is mapped into memory and validated against the mtime of every
+ * directory that was walked and the mtime and size of every
+ * plugin file that was found. Any mismatch causes a full rescan.
+ *
+ * The magic number doubles as a version and endianness check,
+ * bump it whenever the format changes.
+ */
+#define CACHE_MAGIC 0x42504304
+
+/* Only what _bean_plugin_info_new() reads eagerly, the
+ * rest is read from the plugin file when it is needed and
+ * its contents still have the stamp
+ */
+#define CACHE_INFO_TYPE "(isasmasbbu)"
+#define CACHE_TYPE      "(ussa(sx)a(sstxm" CACHE_INFO_TYPE "))"
+
+typedef struct {
+  gchar *path;
+  gint64 mtime;
+} CacheDir;
+
+struct _BeanPluginCache {
+  gchar *module_dir;
+  gchar *data_dir;
+
+  GArray *dirs;
+  GArray *entries;
+};
+
+static void
+cache_dir_clear (CacheDir *dir)
+{
+  g_free (dir->path);
+}
+
+static void
+cache_entry_clear (BeanPluginCacheEntry *entry)
+{
+  g_free (entry->filename);
+  g_free (entry->module_dir);
+
+  if (entry->info != NULL)
+    _bean_plugin_info_unref (entry->info);
+}
+
+gint64
+bean_plugin_cache_get_mtime (const GStatBuf *buf)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+  return (gint64) buf->st_mtim.tv_sec * G_USEC_PER_SEC +
+         buf->st_mtim.tv_nsec / 1000;
+#else
+  return (gint64) buf->st_mtime * G_USEC_PER_SEC;
+#endif
+}
+
+static void
+stat_file (const gchar *filename,
+           gint64      *mtime,
+           guint64     *size)
+{
+  GStatBuf buf;
+
+  if (g_stat (filename, &buf) != 0)
+    {
+      *mtime = -1;
+      *size = 0;
+      return;
+    }
+
+  *mtime = bean_plugin_cache_get_mtime (&buf);
+  *size = buf.st_size;
+}
+
+static gchar *
+get_cache_filename (const gchar *cache_dir,
+                    const gchar *module_dir,
+                    const gchar *data_dir)
+{
+  GChecksum *checksum;
+  gchar *basename, *filename;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  g_checksum_update (checksum, (const guchar *) module_dir, -1);
+  g_checksum_update (checksum, (const guchar *) "", 1);
+  g_checksum_update (checksum, (const guchar *) data_dir, -1);
+
+  basename = g_strconcat (g_checksum_get_string (checksum), ".cache", NULL);
+  filename = g_build_filename (cache_dir, basename, NULL);
+
+  g_free (basename);
+  g_checksum_free (checksum);
+
+  return filename;
+}
+
+BeanPluginCache *
+bean_plugin_cache_new (const gchar *module_dir,
+                       const gchar *data_dir)
+{
+  BeanPluginCache *cache;
+
+  g_return_val_if_fail (module_dir != NULL, NULL);
+  g_return_val_if_fail (data_dir != NULL, NULL);
+
+  cache = g_new0 (BeanPluginCache, 1);
+  cache->module_dir = g_strdup (module_dir);
+  cache->data_dir = g_strdup (data_dir);
+
+  cache->dirs = g_array_new (FALSE, FALSE, sizeof (CacheDir));
+  g_array_set_clear_func (cache->dirs, (GDestroyNotify) cache_dir_clear);
+
+  cache->entries = g_array_new (FALSE, FALSE, sizeof (BeanPluginCacheEntry));
+  g_array_set_clear_func (cache->entries,
+                          (GDestroyNotify) cache_entry_clear);
+
+  return cache;
+}
+
+void
+bean_plugin_cache_free (BeanPluginCache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  g_array_unref (cache->dirs);
+  g_array_unref (cache->entries);
+  g_free (cache->module_dir);
+  g_free (cache->data_dir);
+  g_free (cache);
+}
+
+/* The directory must be stat()ed before it is read so
+ * that a concurrent modification invalidates the cache.
+ */
+void
+bean_plugin_cache_add_dir (BeanPluginCache *cache,
+                           const gchar     *path,
+                           const GStatBuf  *buf)
+{
+  CacheDir dir;
+
+  dir.path = g_strdup (path);
+  dir.mtime = bean_plugin_cache_get_mtime (buf);
+
+  g_array_append_val (cache->dirs, dir);
+}
+
+void
+bean_plugin_cache_add_file (BeanPluginCache *cache,
+                            const gchar     *filename,
+                            const gchar     *module_dir,
+                            const GStatBuf  *buf,
+                            BeanPluginInfo  *info)
+{
+  BeanPluginCacheEntry entry;
+
+  entry.filename = g_strdup (filename);
+  entry.module_dir = g_strdup (module_dir);
+  entry.info = info != NULL ? _bean_plugin_info_ref (info) : NULL;
+
+  if (buf != NULL)
+    {
+      entry.mtime = bean_plugin_cache_get_mtime (buf);
+      entry.size = buf->st_size;
+    }
+  else
+    {
+      entry.mtime = -1;
+      entry.size = 0;
+    }
+
+  g_array_append_val (cache->entries, entry);
+}
+
+const BeanPluginCacheEntry *
+bean_plugin_cache_get_entries (BeanPluginCache *cache,
+                               guint           *n_entries)
+{
+  *n_entries = cache->entries->len;
+  return (const BeanPluginCacheEntry *) cache->entries->data;
+}
+
+static GVariant *
+info_to_variant (BeanPluginInfo *info)
+{
+  GVariant *provides = NULL;
+
+  if (info->provides != NULL)
+    provides = g_variant_new_strv (info->provides, -1);
+
+  return g_variant_new ("(is^as@masbbu)",
+                        info->loader_id,
+                        info->module_name,
+                        info->dependencies,
+                        g_variant_new_maybe (G_VARIANT_TYPE_STRING_ARRAY,
+                                             provides),
+                        info->builtin != FALSE,
+                        info->hidden != FALSE,
+                        info->stamp);
+}
+
+static BeanPluginInfo *
+info_from_variant (GVariant       *variant,
+                   BeanStringPool *strings,
+                   const gchar    *filename,
+                   const gchar    *module_dir,
+                   const gchar    *data_dir)
+{
+  BeanPluginInfo *info;
+  const gchar *module_name;
+  gboolean builtin, hidden;
+  guint32 stamp;
+  gint loader_id;
+  const gchar **dependencies;
+  GVariant *maybe_provides, *provides;
+
+  g_variant_get (variant, "(i&s^a&s@masbbu)",
+                 &loader_id, &module_name, &dependencies,
+                 &maybe_provides, &builtin, &hidden, &stamp);
+
+  if (loader_id < 0 || loader_id >= BEAN_UTILS_N_LOADERS ||
+      *module_name == '\0')
+    {
+      g_free (dependencies);
+      g_variant_unref (maybe_provides);
+      return NULL;
+    }
+
+  info = g_new0 (BeanPluginInfo, 1);
+  info->refcount = 1;
+  info->strings = bean_string_pool_ref (strings);
+
+  info->loader_id = loader_id;
+  info->module_name = bean_string_pool_intern (strings, module_name);
+  info->dependencies = bean_string_pool_intern_strv (strings, dependencies);
+  info->builtin = builtin;
+
+  provides = g_variant_get_maybe (maybe_provides);
+  if (provides != NULL)
+    {
+      const gchar **strv = g_variant_get_strv (provides, NULL);
+
+      info->provides = bean_string_pool_intern_strv (strings, strv);
+      g_free (strv);
+      g_variant_unref (provides);
+    }
+
+  info->hidden = hidden;
+  info->stamp = stamp;
+
+  info->filename = bean_string_pool_intern (strings, filename);
+  info->module_dir = bean_string_pool_intern (strings, module_dir);
+  info->data_dir = bean_string_pool_take (strings,
+                                          g_build_path (G_DIR_SEPARATOR_S,
+                                                        data_dir,
+                                                        module_name, NULL));
+  info->available = TRUE;
+
+  g_free (dependencies);
+  g_variant_unref (maybe_provides);
+
+  return info;
+}
+
+static gboolean
+cache_validate_dirs (GVariant *dirs)
+{
+  GVariantIter iter;
+  const gchar *path;
+  gint64 mtime;
+
+  g_variant_iter_init (&iter, dirs);
+  while (g_variant_iter_next (&iter, "(&sx)", &path, &mtime))
+    {
+      GStatBuf buf;
+
+      if (g_stat (path, &buf) != 0 ||
+          bean_plugin_cache_get_mtime (&buf) != mtime)
+        {
+          g_debug ("Plugin cache is out of date for '%s'", path);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+cache_load_entries (BeanPluginCache *cache,
+                    BeanStringPool  *strings,
+                    GVariant        *entries)
+{
+  GVariantIter iter;
+  GVariant *child;
+
+  g_variant_iter_init (&iter, entries);
+  while ((child = g_variant_iter_next_value (&iter)) != NULL)
+    {
+      BeanPluginCacheEntry entry;
+      const gchar *filename, *module_dir;
+      GVariant *maybe_info, *info_variant;
+      gint64 mtime;
+      guint64 size;
+
+      g_variant_get (child, "(&s&stx@m" CACHE_INFO_TYPE ")",
+                     &filename, &module_dir, &size, &mtime, &maybe_info);
+
+      stat_file (filename, &entry.mtime, &entry.size);
+
+      if (entry.mtime != mtime || entry.size != size)
+        {
+          g_debug ("Plugin cache is out of date for '%s'", filename);
+          g_variant_unref (maybe_info);
+          g_variant_unref (child);
+          return FALSE;
+        }
+
+      entry.info = NULL;
+      info_variant = g_variant_get_maybe (maybe_info);
+
+      if (info_variant != NULL)
+        {
+          entry.info = info_from_variant (info_variant, strings, filename,
+                                          module_dir, cache->data_dir);
+          g_variant_unref (info_variant);
+
+          if (entry.info == NULL)
+            {
+              g_debug ("Plugin cache has a bad entry for '%s'", filename);
+              g_variant_unref (maybe_info);
+              g_variant_unref (child);
+              return FALSE;
+            }
+        }
+
+      entry.filename = g_strdup (filename);
+      entry.module_dir = g_strdup (module_dir);
+      g_array_append_val (cache->entries, entry);
+
+      g_variant_unref (maybe_info);
+      g_variant_unref (child);
+    }
+
+  return TRUE;
+}
+
+/*
+ * bean_plugin_cache_load:
+ * @strings: The #BeanStringPool for the plugin infos.
+ * @cache_dir: The directory where caches are stored.
+ * @module_dir: The module directory of the search path.
+ * @data_dir: The data directory of the search path.
+ *
+ * Loads the cache for the search path and checks that it is
+ * still up to date with the contents of @module_dir.
+ *
+ * Returns: a #BeanPluginCache, or %NULL if there is no cache
+ * or it is out of date.
+ */
+BeanPluginCache *
+bean_plugin_cache_load (BeanStringPool *strings,
+                        const gchar    *cache_dir,
+                        const gchar    *module_dir,
+                        const gchar    *data_dir)
+{
+  BeanPluginCache *cache = NULL;
+  gchar *filename;
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *variant, *dirs, *entries;
+  const gchar *cached_module_dir, *cached_data_dir;
+  guint32 magic;
+  GError *error = NULL;
+
+  filename = get_cache_filename (cache_dir, module_dir, data_dir);
+  mapped = g_mapped_file_new (filename, FALSE, &error);
+
+  if (mapped == NULL)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_debug ("Failed to open plugin cache: %s", error->message);
+
+      g_error_free (error);
+      g_free (filename);
+      return NULL;
+    }
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  variant = g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_TYPE),
+                                      bytes, FALSE);
+  g_variant_ref_sink (variant);
+  g_bytes_unref (bytes);
+
+  g_variant_get (variant, "(u&s&s@a(sx)@a(sstxm" CACHE_INFO_TYPE "))",
+                 &magic, &cached_module_dir, &cached_data_dir,
+                 &dirs, &entries);
+
+  if (magic != CACHE_MAGIC ||
+      g_strcmp0 (cached_module_dir, module_dir) != 0 ||
+      g_strcmp0 (cached_data_dir, data_dir) != 0)
+    {
+      g_debug ("Ignoring incompatible plugin cache '%s'", filename);
+      goto out;
+    }
+
+  if (!cache_validate_dirs (dirs))
+    goto out;
+
+  cache = bean_plugin_cache_new (module_dir, data_dir);
+
+  if (!cache_load_entries (cache, strings, entries))
+    {
+      g_clear_pointer (&cache, bean_plugin_cache_free);
+      goto out;
+    }
+
+  g_debug ("Loaded plugin cache '%s' for '%s'", filename, module_dir);
+
+out:
+
+  g_variant_unref (dirs);
+  g_variant_unref (entries);
+  g_variant_unref (variant);
+  g_free (filename);
+
+  return cache;
+}
+
+/*
+ * bean_plugin_cache_save:
+ * @cache: A #BeanPluginCache.
+ * @cache_dir: The directory where caches are stored.
+ *
+ * Atomically writes @cache to @cache_dir.
+ *
+ * Returns: %TRUE if the cache was written.
+ */
+gboolean
+bean_plugin_cache_save (BeanPluginCache *cache,
+                        const gchar     *cache_dir)
+{
+  GVariantBuilder dirs, entries;
+  GVariant *variant;
+  gchar *filename;
+  guint i;
+  gboolean saved;
+  GError *error = NULL;
+
+  g_variant_builder_init (&dirs, G_VARIANT_TYPE ("a(sx)"));
+
+  for (i = 0; i < cache->dirs->len; ++i)
+    {
+      CacheDir *dir = &g_array_index (cache->dirs, CacheDir, i);
+
+      g_variant_builder_add (&dirs, "(sx)", dir->path, dir->mtime);
+    }
+
+  g_variant_builder_init (&entries,
+                          G_VARIANT_TYPE ("a(sstxm" CACHE_INFO_TYPE ")"));
+
+  for (i = 0; i < cache->entries->len; ++i)
+    {
+      BeanPluginCacheEntry *entry;
+      GVariant *info = NULL;
+
+      entry = &g_array_index (cache->entries, BeanPluginCacheEntry, i);
+
+      if (entry->info != NULL)
+        info = info_to_variant (entry->info);
+
+      g_variant_builder_add (&entries, "(sstx@m" CACHE_INFO_TYPE ")",
+                             entry->filename, entry->module_dir,
+                             entry->size, entry->mtime,
+                             g_variant_new_maybe (G_VARIANT_TYPE (CACHE_INFO_TYPE),
+                                                  info));
+    }
+
+  variant = g_variant_new ("(ussa(sx)a(sstxm" CACHE_INFO_TYPE "))",
+                           (guint32) CACHE_MAGIC,
+                           cache->module_dir,
+                           cache->data_dir,
+                           &dirs, &entries);
+  g_variant_ref_sink (variant);
+
+  filename = get_cache_filename (cache_dir, cache->module_dir,
+                                 cache->data_dir);
+
+  if (g_mkdir_with_parents (cache_dir, 0755) != 0)
+    {
+      g_debug ("Failed to create plugin cache directory '%s': %s",
+               cache_dir, g_strerror (errno));
+      saved = FALSE;
+    }
+  else if (!g_file_set_contents (filename,
+                                 g_variant_get_data (variant),
+                                 g_variant_get_size (variant),
+                                 &error))
+    {
+      g_debug ("Failed to write plugin cache: %s", error->message);
+      g_error_free (error);
+      saved = FALSE;
+    }
+  else
+    {
+      g_debug ("Saved plugin cache '%s' for '%s'",
+               filename, cache->module_dir);
+      saved = TRUE;
+    }
+
+  g_free (filename);
+  g_variant_unref (variant);
+
+  return saved;
+}
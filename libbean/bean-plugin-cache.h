@@ -0,0 +1,72 @@
+/*
+ * bean-plugin-cache.h
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#ifndef __BEAN_PLUGIN_CACHE_H__
+#define __BEAN_PLUGIN_CACHE_H__
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "bean-plugin-info.h"
+#include "bean-string-pool.h"
+
+G_BEGIN_DECLS
+
+typedef struct _BeanPluginCache BeanPluginCache;
+
+typedef struct _BeanPluginCacheEntry {
+  gchar *filename;
+  gchar *module_dir;
+
+  gint64 mtime;
+  guint64 size;
+
+  /* %NULL if the file is not a valid plugin */
+  BeanPluginInfo *info;
+} BeanPluginCacheEntry;
+
+BeanPluginCache            *bean_plugin_cache_new         (const gchar     *module_dir,
+                                                           const gchar     *data_dir);
+BeanPluginCache            *bean_plugin_cache_load        (BeanStringPool  *strings,
+                                                           const gchar     *cache_dir,
+                                                           const gchar     *module_dir,
+                                                           const gchar     *data_dir);
+gboolean                    bean_plugin_cache_save        (BeanPluginCache *cache,
+                                                           const gchar     *cache_dir);
+void                        bean_plugin_cache_free        (BeanPluginCache *cache);
+
+void                        bean_plugin_cache_add_dir     (BeanPluginCache *cache,
+                                                           const gchar     *path,
+                                                           const GStatBuf  *buf);
+void                        bean_plugin_cache_add_file    (BeanPluginCache *cache,
+                                                           const gchar     *filename,
+                                                           const gchar     *module_dir,
+                                                           const GStatBuf  *buf,
+                                                           BeanPluginInfo  *info);
+
+const BeanPluginCacheEntry *bean_plugin_cache_get_entries (BeanPluginCache *cache,
+                                                           guint           *n_entries);
+
+gint64                      bean_plugin_cache_get_mtime   (const GStatBuf  *buf);
+
+G_END_DECLS
+
+#endif /* __BEAN_PLUGIN_CACHE_H__ */
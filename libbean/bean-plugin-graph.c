@@ -0,0 +1,382 @@
+/*
+ * bean-plugin-graph.c
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "bean-plugin-graph.h"
+#include "bean-plugin-info-priv.h"
+
+/* The dependency graph of the plugins known to an engine.
+ *
+ * Edges are only resolved when the graph is next queried after
+ * plugins were added, as a dependency may be found after its
+ * dependants. At that point the whole graph is sorted at once in
+ * O(V log V + E), dependencies first and otherwise by module name,
+ * so the order does not depend on the order plugins were found in.
+ */
+
+enum {
+  NODE_UNVISITED,
+  NODE_VISITING,
+  NODE_VISITED
+};
+
+typedef struct {
+  BeanPluginInfo *info;
+
+  /* Of BeanPluginInfo, only those known to the graph */
+  GPtrArray *dependencies;
+  GPtrArray *dependants;
+
+  guint state : 2;
+  guint warned_cycle : 1;
+} GraphNode;
+
+typedef struct {
+  GraphNode *node;
+  guint next_dep;
+} StackFrame;
+
+struct _BeanPluginGraph {
+  /* Module name -> GraphNode */
+  GHashTable *nodes;
+
+  GQueue sorted;
+  gboolean dirty;
+};
+
+static void
+graph_node_free (GraphNode *node)
+{
+  g_ptr_array_unref (node->dependencies);
+  g_ptr_array_unref (node->dependants);
+  _bean_plugin_info_unref (node->info);
+  g_free (node);
+}
+
+BeanPluginGraph *
+bean_plugin_graph_new (void)
+{
+  BeanPluginGraph *graph;
+
+  graph = g_new0 (BeanPluginGraph, 1);
+  graph->nodes = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                        (GDestroyNotify) graph_node_free);
+  g_queue_init (&graph->sorted);
+
+  return graph;
+}
+
+void
+bean_plugin_graph_free (BeanPluginGraph *graph)
+{
+  if (graph == NULL)
+    return;
+
+  g_queue_clear (&graph->sorted);
+  g_hash_table_unref (graph->nodes);
+  g_free (graph);
+}
+
+/* Takes ownership of info */
+gboolean
+bean_plugin_graph_add (BeanPluginGraph *graph,
+                       BeanPluginInfo  *info)
+{
+  const gchar *module_name = bean_plugin_info_get_module_name (info);
+  GraphNode *node;
+
+  if (g_hash_table_contains (graph->nodes, module_name))
+    {
+      _bean_plugin_info_unref (info);
+      return FALSE;
+    }
+
+  node = g_new0 (GraphNode, 1);
+  node->info = info;
+  node->dependencies = g_ptr_array_new ();
+  node->dependants = g_ptr_array_new ();
+
+  g_hash_table_insert (graph->nodes, (gpointer) module_name, node);
+  graph->dirty = TRUE;
+
+  return TRUE;
+}
+
+/* Returns FALSE if info is not part of the graph,
+ * for instance because it has the same module name as another plugin
+ */
+gboolean
+bean_plugin_graph_remove (BeanPluginGraph *graph,
+                          BeanPluginInfo  *info)
+{
+  const gchar *module_name = bean_plugin_info_get_module_name (info);
+  GraphNode *node;
+
+  node = g_hash_table_lookup (graph->nodes, module_name);
+  if (node == NULL || node->info != info)
+    return FALSE;
+
+  /* The sorted list and the edges of other nodes refer to info */
+  g_queue_clear (&graph->sorted);
+  graph->dirty = TRUE;
+
+  g_hash_table_remove (graph->nodes, module_name);
+  return TRUE;
+}
+
+BeanPluginInfo *
+bean_plugin_graph_lookup (BeanPluginGraph *graph,
+                          const gchar     *module_name)
+{
+  GraphNode *node = g_hash_table_lookup (graph->nodes, module_name);
+
+  return node != NULL ? node->info : NULL;
+}
+
+guint
+bean_plugin_graph_get_size (BeanPluginGraph *graph)
+{
+  return g_hash_table_size (graph->nodes);
+}
+
+static GraphNode *
+graph_lookup_node (BeanPluginGraph *graph,
+                   BeanPluginInfo  *info)
+{
+  return g_hash_table_lookup (graph->nodes,
+                              bean_plugin_info_get_module_name (info));
+}
+
+static gint
+compare_nodes (gconstpointer a,
+               gconstpointer b)
+{
+  const GraphNode *node_a = *(const GraphNode **) a;
+  const GraphNode *node_b = *(const GraphNode **) b;
+
+  return strcmp (bean_plugin_info_get_module_name (node_a->info),
+                 bean_plugin_info_get_module_name (node_b->info));
+}
+
+static void
+graph_resolve_dependencies (BeanPluginGraph *graph,
+                            GraphNode       *node)
+{
+  const gchar **dependencies;
+  guint i;
+
+  dependencies = bean_plugin_info_get_dependencies (node->info);
+
+  for (i = 0; dependencies[i] != NULL; ++i)
+    {
+      GraphNode *dep_node;
+
+      dep_node = g_hash_table_lookup (graph->nodes, dependencies[i]);
+
+      /* Depending on yourself is allowed and is not a cycle */
+      if (dep_node != NULL && dep_node != node)
+        g_ptr_array_add (node->dependencies, dep_node->info);
+    }
+}
+
+/* Iterative so that long dependency chains cannot overflow the stack */
+static void
+graph_visit (BeanPluginGraph *graph,
+             GArray          *stack,
+             GraphNode       *root)
+{
+  StackFrame frame = { root, 0 };
+
+  root->state = NODE_VISITING;
+  g_array_append_val (stack, frame);
+
+  while (stack->len > 0)
+    {
+      StackFrame *top = &g_array_index (stack, StackFrame, stack->len - 1);
+      GraphNode *node = top->node;
+      GraphNode *dep_node;
+
+      if (top->next_dep == node->dependencies->len)
+        {
+          node->state = NODE_VISITED;
+          g_queue_push_tail (&graph->sorted, node->info);
+          g_array_set_size (stack, stack->len - 1);
+          continue;
+        }
+
+      dep_node = graph_lookup_node (graph,
+                                    g_ptr_array_index (node->dependencies,
+                                                       top->next_dep++));
+
+      if (dep_node->state == NODE_UNVISITED)
+        {
+          frame.node = dep_node;
+          frame.next_dep = 0;
+
+          dep_node->state = NODE_VISITING;
+          g_array_append_val (stack, frame);
+        }
+      else if (dep_node->state == NODE_VISITING && !node->warned_cycle)
+        {
+          /* The cycle is broken here, it will be loaded
+           * as if this dependency was not there
+           */
+          g_warning ("Plugin '%s' has a circular dependency on '%s'",
+                     bean_plugin_info_get_module_name (node->info),
+                     bean_plugin_info_get_module_name (dep_node->info));
+          node->warned_cycle = TRUE;
+        }
+    }
+}
+
+static void
+graph_sort (BeanPluginGraph *graph)
+{
+  GPtrArray *nodes;
+  GArray *stack;
+  GHashTableIter iter;
+  GraphNode *node;
+  GList *l;
+  guint i;
+
+  g_queue_clear (&graph->sorted);
+
+  nodes = g_ptr_array_sized_new (g_hash_table_size (graph->nodes));
+
+  g_hash_table_iter_init (&iter, graph->nodes);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &node))
+    {
+      g_ptr_array_set_size (node->dependencies, 0);
+      g_ptr_array_set_size (node->dependants, 0);
+      node->state = NODE_UNVISITED;
+
+      graph_resolve_dependencies (graph, node);
+      g_ptr_array_add (nodes, node);
+    }
+
+  g_ptr_array_sort (nodes, compare_nodes);
+
+  stack = g_array_new (FALSE, FALSE, sizeof (StackFrame));
+
+  for (i = 0; i < nodes->len; ++i)
+    {
+      node = g_ptr_array_index (nodes, i);
+
+      if (node->state == NODE_UNVISITED)
+        graph_visit (graph, stack, node);
+    }
+
+  /* Added in sorted order so that the dependants are sorted as well */
+  for (l = graph->sorted.head; l != NULL; l = l->next)
+    {
+      node = graph_lookup_node (graph, l->data);
+
+      for (i = 0; i < node->dependencies->len; ++i)
+        {
+          GraphNode *dep_node;
+
+          dep_node = graph_lookup_node (graph,
+                                        g_ptr_array_index (node->dependencies,
+                                                           i));
+          g_ptr_array_add (dep_node->dependants, node->info);
+        }
+    }
+
+  g_array_unref (stack);
+  g_ptr_array_unref (nodes);
+
+  graph->dirty = FALSE;
+}
+
+/*
+ * bean_plugin_graph_get_sorted:
+ * @graph: A #BeanPluginGraph.
+ *
+ * Gets all of the plugins, each one after its dependencies.
+ *
+ * Returns: a #GQueue of #BeanPluginInfo owned by @graph, it is
+ * only valid until a plugin is next added to or removed from @graph.
+ */
+const GQueue *
+bean_plugin_graph_get_sorted (BeanPluginGraph *graph)
+{
+  if (graph->dirty)
+    graph_sort (graph);
+
+  return &graph->sorted;
+}
+
+static GraphNode *
+graph_get_node (BeanPluginGraph *graph,
+                BeanPluginInfo  *info)
+{
+  GraphNode *node;
+
+  if (graph->dirty)
+    graph_sort (graph);
+
+  node = graph_lookup_node (graph, info);
+
+  return node != NULL && node->info == info ? node : NULL;
+}
+
+/*
+ * bean_plugin_graph_get_dependencies:
+ * @graph: A #BeanPluginGraph.
+ * @info: A #BeanPluginInfo.
+ *
+ * Gets the plugins that @info depends on which are known
+ * to @graph, in the order they are listed by @info.
+ *
+ * Returns: a #GPtrArray of #BeanPluginInfo owned by @graph,
+ * or %NULL if @info is not part of @graph.
+ */
+GPtrArray *
+bean_plugin_graph_get_dependencies (BeanPluginGraph *graph,
+                                    BeanPluginInfo  *info)
+{
+  GraphNode *node = graph_get_node (graph, info);
+
+  return node != NULL ? node->dependencies : NULL;
+}
+
+/*
+ * bean_plugin_graph_get_dependants:
+ * @graph: A #BeanPluginGraph.
+ * @info: A #BeanPluginInfo.
+ *
+ * Gets the plugins that directly depend on @info,
+ * in the order of bean_plugin_graph_get_sorted().
+ *
+ * Returns: a #GPtrArray of #BeanPluginInfo owned by @graph,
+ * or %NULL if @info is not part of @graph.
+ */
+GPtrArray *
+bean_plugin_graph_get_dependants (BeanPluginGraph *graph,
+                                  BeanPluginInfo  *info)
+{
+  GraphNode *node = graph_get_node (graph, info);
+
+  return node != NULL ? node->dependants : NULL;
+}
@@ -0,0 +1,52 @@
+/*
+ * bean-plugin-graph.h
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#ifndef __BEAN_PLUGIN_GRAPH_H__
+#define __BEAN_PLUGIN_GRAPH_H__
+
+#include <glib.h>
+
+#include "bean-plugin-info.h"
+
+G_BEGIN_DECLS
+
+typedef struct _BeanPluginGraph BeanPluginGraph;
+
+BeanPluginGraph *bean_plugin_graph_new              (void);
+void             bean_plugin_graph_free             (BeanPluginGraph *graph);
+
+gboolean         bean_plugin_graph_add              (BeanPluginGraph *graph,
+                                                     BeanPluginInfo  *info);
+gboolean         bean_plugin_graph_remove           (BeanPluginGraph *graph,
+                                                     BeanPluginInfo  *info);
+BeanPluginInfo  *bean_plugin_graph_lookup           (BeanPluginGraph *graph,
+                                                     const gchar     *module_name);
+guint            bean_plugin_graph_get_size         (BeanPluginGraph *graph);
+
+const GQueue    *bean_plugin_graph_get_sorted       (BeanPluginGraph *graph);
+GPtrArray       *bean_plugin_graph_get_dependencies (BeanPluginGraph *graph,
+                                                     BeanPluginInfo  *info);
+GPtrArray       *bean_plugin_graph_get_dependants   (BeanPluginGraph *graph,
+                                                     BeanPluginInfo  *info);
+
+G_END_DECLS
+
+#endif /* __BEAN_PLUGIN_GRAPH_H__ */
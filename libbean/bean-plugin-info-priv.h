@@ -24,6 +24,22 @@
 #define __BEAN_PLUGIN_INFO_PRIV_H__
 
 #include "bean-plugin-info.h"
+#include "bean-string-pool.h"
+
+/* Only needed to show the plugin, so they are read on demand */
+typedef struct _BeanPluginDetails {
+  /* Owned by the string pool of the plugin info */
+  const gchar *name;
+  const gchar *desc;
+  const gchar *icon_name;
+  const gchar * const *authors;
+  const gchar *copyright;
+  const gchar *website;
+  const gchar *version;
+  const gchar *help_uri;
+
+  GHashTable *external_data;
+} BeanPluginDetails;
 
 struct _BeanPluginInfo {
   /*< private >*/
@@ -32,25 +48,27 @@ struct _BeanPluginInfo {
   /* Used and managed by BeanPluginLoader */
   gpointer loader_data;
 
-  gchar *filename;
-  gchar *module_dir;
-  gchar *data_dir;
+  /* The strings are owned by the pool, which is shared
+     with the engine and the other plugins it found */
+  BeanStringPool *strings;
+
+  const gchar *filename;
+  const gchar *module_dir;
+  const gchar *data_dir;
 
   gint loader_id;
-  gchar *embedded;
-  gchar *module_name;
-  gchar **dependencies;
-
-  gchar *name;
-  gchar *desc;
-  gchar *icon_name;
-  gchar **authors;
-  gchar *copyright;
-  gchar *website;
-  gchar *version;
-  gchar *help_uri;
+  const gchar *embedded;
+  const gchar *module_name;
+  const gchar * const *dependencies;
 
-  GHashTable *external_data;
+  /* The names of the extension types from X-Provides,
+     or %NULL if the plugin does not list them */
+  const gchar * const *provides;
+
+  /* Loaded by the getters when first needed, from the
+     plugin file if its contents still have this stamp */
+  BeanPluginDetails *details;
+  guint stamp;
 
   GSettingsSchemaSource *schema_source;
 
@@ -64,13 +82,22 @@ struct _BeanPluginInfo {
 
   guint builtin : 1;
   guint hidden : 1;
+
+  /* Loaded by the engine but not yet by its
+     loader, see BeanEngine:lazy-load */
+  guint deferred : 1;
 };
 
-BeanPluginInfo *_bean_plugin_info_new   (const gchar    *filename,
-                                         const gchar    *module_dir,
-                                         const gchar    *data_dir);
-BeanPluginInfo *_bean_plugin_info_ref   (BeanPluginInfo *info);
-void            _bean_plugin_info_unref (BeanPluginInfo *info);
+BeanPluginInfo *_bean_plugin_info_new   (BeanStringPool  *strings,
+                                         const gchar     *filename,
+                                         const gchar     *module_dir,
+                                         const gchar     *data_dir,
+                                         GError         **error);
+BeanPluginInfo *_bean_plugin_info_ref   (BeanPluginInfo  *info);
+void            _bean_plugin_info_unref (BeanPluginInfo  *info);
+
+gchar          *_bean_plugin_info_get_module_filename
+                                        (const BeanPluginInfo *info);
 
 
 #endif /* __BEAN_PLUGIN_INFO_PRIV_H__ */
@@ -24,8 +24,11 @@
 
 #include <string.h>
 
+#include <gmodule.h>
+
 #include "bean-i18n-priv.h"
 #include "bean-plugin-info-priv.h"
+#include "bean-plugin-parser.h"
 #include "bean-utils.h"
 
 #ifdef G_OS_WIN32
@@ -66,6 +69,17 @@ G_DEFINE_BOXED_TYPE (BeanPluginInfo, bean_plugin_info,
                      _bean_plugin_info_ref,
                      _bean_plugin_info_unref)
 
+static const gchar * const empty_strv[] = { NULL };
+
+static void
+plugin_details_free (BeanPluginDetails *details)
+{
+  if (details->external_data != NULL)
+    g_hash_table_unref (details->external_data);
+
+  g_free (details);
+}
+
 BeanPluginInfo *
 _bean_plugin_info_ref (BeanPluginInfo *info)
 {
@@ -79,114 +93,226 @@ _bean_plugin_info_unref (BeanPluginInfo *info)
   if (!g_atomic_int_dec_and_test (&info->refcount))
     return;
 
-  g_free (info->filename);
-  g_free (info->module_dir);
-  g_free (info->data_dir);
-  g_free (info->embedded);
-  g_free (info->module_name);
-  g_strfreev (info->dependencies);
-  g_free (info->name);
-  g_free (info->desc);
-  g_free (info->icon_name);
-  g_free (info->website);
-  g_free (info->copyright);
-  g_free (info->version);
-  g_free (info->help_uri);
-  g_strfreev (info->authors);
+  if (info->details != NULL)
+    plugin_details_free (info->details);
 
   if (info->schema_source != NULL)
     g_settings_schema_source_unref (info->schema_source);
 
-  if (info->external_data != NULL)
-    g_hash_table_unref (info->external_data);
-
   if (info->error != NULL)
     g_error_free (info->error);
 
+  bean_string_pool_unref (info->strings);
   g_free (info);
 }
 
 /*
- * _bean_plugin_info_new:
- * @filename: The filename where to read the plugin information.
- * @module_dir: The module directory.
- * @data_dir: The data directory.
+ * _bean_plugin_info_get_module_filename:
+ * @info: A #BeanPluginInfo.
  *
- * Creates a new #BeanPluginInfo from a file on the disk.
+ * Gets the file which defines what the plugin provides, that is the
+ * shared library of a C plugin, or the module or package initialization
+ * file of a Python or Lua plugin.
  *
- * Return value: a newly created #BeanPluginInfo.
+ * Returns: (transfer full) (nullable): the filename, or %NULL if the
+ * plugin is embedded or its loader is unknown.
  */
-BeanPluginInfo *
-_bean_plugin_info_new (const gchar *filename,
-                       const gchar *module_dir,
-                       const gchar *data_dir)
+gchar *
+_bean_plugin_info_get_module_filename (const BeanPluginInfo *info)
 {
-  gsize i;
-  gboolean is_resource;
-  gchar *loader = NULL;
-  gchar **strv, **keys;
-  BeanPluginInfo *info;
-  GKeyFile *plugin_file;
-  GBytes *bytes = NULL;
-  GError *error = NULL;
+  const gchar *loader_name;
+  const gchar *suffix, *package_init;
+  gchar *filename, *basename;
 
-  g_return_val_if_fail (filename != NULL, NULL);
+  if (info->embedded != NULL ||
+      g_str_has_prefix (info->module_dir, "resource://"))
+    return NULL;
 
-  is_resource = g_str_has_prefix (filename, "resource://");
+  if (info->loader_id == BEAN_UTILS_C_LOADER_ID)
+    return g_module_build_path (info->module_dir, info->module_name);
 
-  info = g_new0 (BeanPluginInfo, 1);
-  info->refcount = 1;
+  loader_name = bean_utils_get_loader_from_id (info->loader_id);
+
+  if (g_str_has_prefix (loader_name, "python"))
+    {
+      suffix = ".py";
+      package_init = "__init__.py";
+    }
+  else if (g_str_has_prefix (loader_name, "lua"))
+    {
+      suffix = ".lua";
+      package_init = "init.lua";
+    }
+  else
+    {
+      return NULL;
+    }
+
+  /* A module can also be a package directory */
+  filename = g_build_filename (info->module_dir, info->module_name,
+                               package_init, NULL);
+
+  if (g_file_test (filename, G_FILE_TEST_EXISTS))
+    return filename;
+
+  g_free (filename);
+
+  basename = g_strconcat (info->module_name, suffix, NULL);
+  filename = g_build_filename (info->module_dir, basename, NULL);
+  g_free (basename);
+
+  return filename;
+}
+
+/* @stamp is set to identify the contents of the file */
+static BeanPluginParser *
+plugin_parser_new_for_file (const gchar  *filename,
+                            gboolean      is_resource,
+                            guint        *stamp,
+                            GError      **error)
+{
+  BeanPluginParser *parser = NULL;
+  GBytes *bytes = NULL;
+  GError *local_error = NULL;
 
-  plugin_file = g_key_file_new ();
-  
   if (is_resource)
     {
       bytes = g_resources_lookup_data (filename + strlen ("resource://"),
                                        G_RESOURCE_LOOKUP_FLAGS_NONE,
-                                       &error);
+                                       &local_error);
     }
   else
     {
       gchar *content;
       gsize length;
 
-      if (g_file_get_contents (filename, &content, &length, &error))
+      if (g_file_get_contents (filename, &content, &length, &local_error))
         bytes = g_bytes_new_take (content, length);
     }
 
-  if (bytes == NULL ||
-      !g_key_file_load_from_data (plugin_file,
-                                  g_bytes_get_data (bytes, NULL),
-                                  g_bytes_get_size (bytes),
-                                  G_KEY_FILE_NONE, &error))
+  if (bytes != NULL)
     {
-      g_warning ("Bad plugin file '%s': %s", filename, error->message);
-      g_error_free (error);
-      goto error;
+      *stamp = g_bytes_hash (bytes);
+      parser = bean_plugin_parser_new (bytes, BEAN_PLUGIN_PARSER_NONE,
+                                       &local_error);
+      g_bytes_unref (bytes);
     }
 
+  if (parser == NULL)
+    {
+      g_set_error (error, local_error->domain, local_error->code,
+                   "Bad plugin file '%s': %s",
+                   filename, local_error->message);
+      g_error_free (local_error);
+    }
+
+  return parser;
+}
+
+/* The values are owned by the string pool */
+static const gchar *
+get_string (BeanStringPool   *strings,
+            BeanPluginParser *plugin_file,
+            const gchar      *key)
+{
+  return bean_string_pool_take (strings,
+                                bean_plugin_parser_get_string (plugin_file,
+                                                               key));
+}
+
+static const gchar *
+get_locale_string (BeanStringPool   *strings,
+                   BeanPluginParser *plugin_file,
+                   const gchar      *key)
+{
+  return bean_string_pool_take (strings,
+                                bean_plugin_parser_get_locale_string (plugin_file,
+                                                                      key));
+}
+
+static const gchar * const *
+get_string_list (BeanStringPool   *strings,
+                 BeanPluginParser *plugin_file,
+                 const gchar      *key)
+{
+  return bean_string_pool_take_strv (strings,
+                                     bean_plugin_parser_get_string_list (plugin_file,
+                                                                         key));
+}
+
+/*
+ * _bean_plugin_info_new:
+ * @strings: The #BeanStringPool of the engine.
+ * @filename: The filename where to read the plugin information.
+ * @module_dir: The module directory.
+ * @data_dir: The data directory.
+ * @error: A #GError.
+ *
+ * Creates a new #BeanPluginInfo from a file on the disk.
+ *
+ * Only what the engine needs to manage the plugin is read, the
+ * fields which describe it are read from the file again when
+ * one of them is first requested. If the file changed meanwhile
+ * they are left unset, the name then being the module name.
+ *
+ * This does not log anything so that it can be used from any thread,
+ * instead @error is set to explain why the plugin file is invalid.
+ *
+ * Return value: a newly created #BeanPluginInfo, or %NULL.
+ */
+BeanPluginInfo *
+_bean_plugin_info_new (BeanStringPool  *strings,
+                       const gchar     *filename,
+                       const gchar     *module_dir,
+                       const gchar     *data_dir,
+                       GError         **error)
+{
+  gboolean is_resource;
+  gchar *loader = NULL, *name, *data_path;
+  guint stamp = 0;
+  BeanPluginInfo *info;
+  BeanPluginParser *plugin_file;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  is_resource = g_str_has_prefix (filename, "resource://");
+
+  plugin_file = plugin_parser_new_for_file (filename, is_resource,
+                                            &stamp, error);
+  if (plugin_file == NULL)
+    return NULL;
+
+  info = g_new0 (BeanPluginInfo, 1);
+  info->refcount = 1;
+  info->stamp = stamp;
+  info->strings = bean_string_pool_ref (strings);
+
   /* Get module name */
-  info->module_name = g_key_file_get_string (plugin_file, "Plugin",
-                                             "Module", NULL);
+  info->module_name = get_string (strings, plugin_file, "Module");
   if (info->module_name == NULL || *info->module_name == '\0')
     {
-      g_warning ("Could not find 'Module' in '[Plugin]' section in '%s'",
-                 filename);
+      g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND,
+                   "Could not find 'Module' in '[Plugin]' section in '%s'",
+                   filename);
       goto error;
     }
 
-  /* Get Name */
-  info->name = g_key_file_get_locale_string (plugin_file, "Plugin",
-                                      "Name", NULL, NULL);
-  if (info->name == NULL || *info->name == '\0')
+  /* Check Name, it is only read when needed */
+  name = bean_plugin_parser_get_locale_string (plugin_file, "Name");
+  if (name == NULL || *name == '\0')
     {
-      g_warning ("Could not find 'Name' in '[Plugin]' section in '%s'",
-                 filename);
+      g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_KEY_NOT_FOUND,
+                   "Could not find 'Name' in '[Plugin]' section in '%s'",
+                   filename);
+      g_free (name);
       goto error;
     }
 
+  g_free (name);
+
   /* Get the loader for this plugin */
-  loader = g_key_file_get_string (plugin_file, "Plugin", "Loader", NULL);
+  loader = bean_plugin_parser_get_string (plugin_file, "Loader");
   if (loader == NULL || *loader == '\0')
     {
       /* Default to the C loader */
@@ -198,138 +324,202 @@ _bean_plugin_info_new (const gchar *filename,
 
       if (info->loader_id == -1)
         {
-          g_warning ("Unkown 'Loader' in '[Plugin]' section in '%s': %s",
-                     filename, loader);
+          g_set_error (error, G_KEY_FILE_ERROR,
+                       G_KEY_FILE_ERROR_INVALID_VALUE,
+                       "Unkown 'Loader' in '[Plugin]' section in '%s': %s",
+                       filename, loader);
           goto error;
         }
     }
 
   /* Get Embedded */
-  info->embedded = g_key_file_get_string (plugin_file, "Plugin",
-                                          "Embedded", NULL);
+  info->embedded = get_string (strings, plugin_file, "Embedded");
   if (info->embedded != NULL)
     {
       if (info->loader_id != BEAN_UTILS_C_LOADER_ID)
         {
-          g_warning ("Bad plugin file '%s': embedded plugins "
-                     "must use the C plugin loader", filename);
+          g_set_error (error, G_KEY_FILE_ERROR,
+                       G_KEY_FILE_ERROR_INVALID_VALUE,
+                       "Bad plugin file '%s': embedded plugins "
+                       "must use the C plugin loader", filename);
           goto error;
         }
 
       if (!is_resource)
         {
-          g_warning ("Bad plugin file '%s': embedded plugins "
-                     "must be a resource", filename);
+          g_set_error (error, G_KEY_FILE_ERROR,
+                       G_KEY_FILE_ERROR_INVALID_VALUE,
+                       "Bad plugin file '%s': embedded plugins "
+                       "must be a resource", filename);
           goto error;
         }
     }
   else if (is_resource)
     {
-      g_warning ("Bad plugin file '%s': resource plugins must be embedded",
-                 filename);
+      g_set_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE,
+                   "Bad plugin file '%s': resource plugins must be embedded",
+                   filename);
       goto error;
     }
 
   /* Get the dependency list */
-  info->dependencies = g_key_file_get_string_list (plugin_file,
-                                                   "Plugin",
-                                                   "Depends", NULL, NULL);
+  info->dependencies = get_string_list (strings, plugin_file, "Depends");
   if (info->dependencies == NULL)
-    info->dependencies = g_new0 (gchar *, 1);
+    info->dependencies = empty_strv;
+
+  /* Get the provided extension types, only used by the engine */
+  info->provides = get_string_list (strings, plugin_file, "X-Provides");
+
+  /* Get Builtin */
+  info->builtin = bean_plugin_parser_get_boolean (plugin_file, "Builtin");
+
+  /* Get Hidden */
+  info->hidden = bean_plugin_parser_get_boolean (plugin_file, "Hidden");
+
+  g_free (loader);
+  bean_plugin_parser_free (plugin_file);
+
+  data_path = g_build_path (is_resource ? "/" : G_DIR_SEPARATOR_S,
+                            data_dir, info->module_name, NULL);
+
+  info->filename = bean_string_pool_intern (strings, filename);
+  info->module_dir = bean_string_pool_intern (strings, module_dir);
+  info->data_dir = bean_string_pool_take (strings, data_path);
+
+  /* If we know nothing about the availability of the plugin,
+     set it as available */
+  info->available = TRUE;
+
+  return info;
+
+error:
+
+  g_free (loader);
+  bean_string_pool_unref (info->strings);
+  g_free (info);
+  bean_plugin_parser_free (plugin_file);
+
+  return NULL;
+}
+
+static BeanPluginDetails *
+plugin_details_new (const BeanPluginInfo *info)
+{
+  BeanPluginDetails *details;
+  BeanPluginParser *plugin_file;
+  BeanStringPool *strings = info->strings;
+  gchar **strv, **keys;
+  gchar *name;
+  guint stamp = 0;
+  gsize i;
+  GError *error = NULL;
+
+  details = g_new0 (BeanPluginDetails, 1);
+  details->name = info->module_name;
+  details->authors = empty_strv;
+
+  plugin_file = plugin_parser_new_for_file (info->filename,
+                                            g_str_has_prefix (info->filename,
+                                                              "resource://"),
+                                            &stamp, &error);
+
+  /* The plugin file was valid when the plugin was found */
+  if (plugin_file == NULL)
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+      return details;
+    }
+
+  /* Otherwise the details could describe another plugin than
+   * the module and dependencies of this one, until it is rescanned
+   */
+  if (stamp != info->stamp)
+    {
+      g_debug ("Plugin file '%s' changed since it was found, "
+               "not reading its details", info->filename);
+      bean_plugin_parser_free (plugin_file);
+      return details;
+    }
+
+  /* Get Name */
+  name = bean_plugin_parser_get_locale_string (plugin_file, "Name");
+  if (name == NULL || *name == '\0')
+    {
+      g_free (name);
+      details->name = info->module_name;
+    }
+  else
+    {
+      details->name = bean_string_pool_take (strings, name);
+    }
 
   /* Get Description */
-  info->desc = g_key_file_get_locale_string (plugin_file, "Plugin",
-                                             "Description", NULL, NULL);
+  details->desc = get_locale_string (strings, plugin_file, "Description");
 
   /* Get Icon */
-  info->icon_name = g_key_file_get_locale_string (plugin_file, "Plugin",
-                                                  "Icon", NULL, NULL);
+  details->icon_name = get_locale_string (strings, plugin_file, "Icon");
 
   /* Get Authors */
-  info->authors = g_key_file_get_string_list (plugin_file, "Plugin",
-                                              "Authors", NULL, NULL);
-  if (info->authors == NULL)
-    info->authors = g_new0 (gchar *, 1);
+  details->authors = get_string_list (strings, plugin_file, "Authors");
+  if (details->authors == NULL)
+    details->authors = empty_strv;
 
   /* Get Copyright */
-  strv = g_key_file_get_string_list (plugin_file, "Plugin",
-                                     "Copyright", NULL, NULL);
+  strv = bean_plugin_parser_get_string_list (plugin_file, "Copyright");
   if (strv != NULL)
     {
-      info->copyright = g_strjoinv ("\n", strv);
+      details->copyright = bean_string_pool_take (strings,
+                                                  g_strjoinv ("\n", strv));
 
       g_strfreev (strv);
     }
 
   /* Get Website */
-  info->website = g_key_file_get_string (plugin_file, "Plugin",
-                                         "Website", NULL);
+  details->website = get_string (strings, plugin_file, "Website");
 
   /* Get Version */
-  info->version = g_key_file_get_string (plugin_file, "Plugin",
-                                         "Version", NULL);
+  details->version = get_string (strings, plugin_file, "Version");
 
   /* Get Help URI */
-  info->help_uri = g_key_file_get_string (plugin_file, "Plugin",
-                                          OS_HELP_KEY, NULL);
-  if (info->help_uri == NULL)
-    info->help_uri = g_key_file_get_string (plugin_file, "Plugin",
-                                            "Help", NULL);
-
-  /* Get Builtin */
-  info->builtin = g_key_file_get_boolean (plugin_file, "Plugin",
-                                          "Builtin", NULL);
+  details->help_uri = get_string (strings, plugin_file, OS_HELP_KEY);
+  if (details->help_uri == NULL)
+    details->help_uri = get_string (strings, plugin_file, "Help");
 
-  /* Get Hidden */
-  info->hidden = g_key_file_get_boolean (plugin_file, "Plugin",
-                                         "Hidden", NULL);
-
-  keys = g_key_file_get_keys (plugin_file, "Plugin", NULL, NULL);
+  keys = bean_plugin_parser_get_keys (plugin_file);
 
   for (i = 0; keys[i] != NULL; ++i)
     {
       if (!g_str_has_prefix (keys[i], "X-"))
         continue;
 
-      if (info->external_data == NULL)
-        info->external_data = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                     (GDestroyNotify) g_free,
-                                                     (GDestroyNotify) g_free);
+      /* The keys and values are owned by the string pool */
+      if (details->external_data == NULL)
+        details->external_data = g_hash_table_new (g_str_hash, g_str_equal);
 
-      g_hash_table_insert (info->external_data,
-                           g_strdup (keys[i] + 2),
-                           g_key_file_get_string (plugin_file, "Plugin",
-                                                  keys[i], NULL));
+      g_hash_table_insert (details->external_data,
+                           (gpointer) bean_string_pool_intern (strings,
+                                                               keys[i] + 2),
+                           (gpointer) get_string (strings, plugin_file, keys[i]));
     }
 
   g_strfreev (keys);
 
-  g_free (loader);
-  g_bytes_unref (bytes);
-  g_key_file_free (plugin_file);
-
-  info->filename = g_strdup (filename);
-  info->module_dir = g_strdup (module_dir);
-  info->data_dir = g_build_path (is_resource ? "/" : G_DIR_SEPARATOR_S,
-                                 data_dir, info->module_name, NULL);
-
-  /* If we know nothing about the availability of the plugin,
-     set it as available */
-  info->available = TRUE;
+  bean_plugin_parser_free (plugin_file);
 
-  return info;
+  return details;
+}
 
-error:
+static const BeanPluginDetails *
+get_details (const BeanPluginInfo *info)
+{
+  BeanPluginInfo *mutable_info = (BeanPluginInfo *) info;
 
-  g_free (info->embedded);
-  g_free (loader);
-  g_free (info->module_name);
-  g_free (info->name);
-  g_free (info);
-  g_clear_pointer (&bytes, g_bytes_unref);
-  g_key_file_free (plugin_file);
+  /* Plugin infos can be shared between threads */
+  if (g_once_init_enter (&mutable_info->details))
+    g_once_init_leave (&mutable_info->details, plugin_details_new (info));
 
-  return NULL;
+  return info->details;
 }
 
 /**
@@ -631,7 +821,7 @@ bean_plugin_info_get_name (const BeanPluginInfo *info)
 {
   g_return_val_if_fail (info != NULL, NULL);
 
-  return info->name;
+  return get_details (info)->name;
 }
 
 /**
@@ -652,7 +842,7 @@ bean_plugin_info_get_description (const BeanPluginInfo *info)
 {
   g_return_val_if_fail (info != NULL, NULL);
 
-  return info->desc;
+  return get_details (info)->desc;
 }
 
 /**
@@ -671,10 +861,14 @@ bean_plugin_info_get_description (const BeanPluginInfo *info)
 const gchar *
 bean_plugin_info_get_icon_name (const BeanPluginInfo *info)
 {
+  const BeanPluginDetails *details;
+
   g_return_val_if_fail (info != NULL, NULL);
 
-  if (info->icon_name != NULL)
-    return info->icon_name;
+  details = get_details (info);
+
+  if (details->icon_name != NULL)
+    return details->icon_name;
 
   return "libbean-plugin";
 }
@@ -694,7 +888,7 @@ bean_plugin_info_get_authors (const BeanPluginInfo *info)
 {
   g_return_val_if_fail (info != NULL, (const gchar **) NULL);
 
-  return (const gchar **) info->authors;
+  return (const gchar **) get_details (info)->authors;
 }
 
 /**
@@ -712,7 +906,7 @@ bean_plugin_info_get_website (const BeanPluginInfo *info)
 {
   g_return_val_if_fail (info != NULL, NULL);
 
-  return info->website;
+  return get_details (info)->website;
 }
 
 /**
@@ -730,7 +924,7 @@ bean_plugin_info_get_copyright (const BeanPluginInfo *info)
 {
   g_return_val_if_fail (info != NULL, NULL);
 
-  return info->copyright;
+  return get_details (info)->copyright;
 }
 
 /**
@@ -748,7 +942,7 @@ bean_plugin_info_get_version (const BeanPluginInfo *info)
 {
   g_return_val_if_fail (info != NULL, NULL);
 
-  return info->version;
+  return get_details (info)->version;
 }
 
 /**
@@ -772,7 +966,7 @@ bean_plugin_info_get_help_uri (const BeanPluginInfo *info)
 {
   g_return_val_if_fail (info != NULL, NULL);
 
-  return info->help_uri;
+  return get_details (info)->help_uri;
 }
 
 /**
@@ -797,14 +991,18 @@ const gchar *
 bean_plugin_info_get_external_data (const BeanPluginInfo *info,
                                     const gchar          *key)
 {
+  const BeanPluginDetails *details;
+
   g_return_val_if_fail (info != NULL, NULL);
   g_return_val_if_fail (key != NULL, NULL);
 
-  if (info->external_data == NULL)
+  details = get_details (info);
+
+  if (details->external_data == NULL)
     return NULL;
 
   if (g_str_has_prefix (key, "X-"))
     key += 2;
 
-  return g_hash_table_lookup (info->external_data, key);
+  return g_hash_table_lookup (details->external_data, key);
 }
@@ -0,0 +1,225 @@
+/*
+ * bean-plugin-list.c
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include "bean-plugin-list.h"
+
+/* The list of plugins returned by bean_engine_get_plugin_list().
+ *
+ * A plugin is added at the head of the list, or right after the
+ * last of its dependencies which is already in the list. The list
+ * is only ever updated in place so that its links stay valid while
+ * their plugins are part of it.
+ *
+ * Each link is indexed by its module name and carries an order
+ * label which increases along the list. Finding the last dependency
+ * of a plugin only compares the labels of its dependencies, so adding
+ * and removing a plugin does not walk the list. When two neighbours
+ * run out of labels between them the labels around them are spread
+ * out again, as in the order maintenance of Dietz and Sleator, which
+ * costs O(log n) amortized.
+ */
+
+/* Leaves room for as many plugins at either end of the list */
+#define ORDER_SPACING (G_GUINT64_CONSTANT (1) << 32)
+
+typedef struct {
+  /* Must be first, the data is the BeanPluginInfo */
+  GList link;
+
+  guint64 order;
+} ListEntry;
+
+#define LIST_ENTRY(l) ((ListEntry *) (l))
+
+struct _BeanPluginList {
+  GQueue queue;
+
+  /* Module name -> ListEntry */
+  GHashTable *entries;
+};
+
+BeanPluginList *
+bean_plugin_list_new (void)
+{
+  BeanPluginList *list;
+
+  list = g_new0 (BeanPluginList, 1);
+  g_queue_init (&list->queue);
+  list->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, g_free);
+
+  return list;
+}
+
+void
+bean_plugin_list_free (BeanPluginList *list)
+{
+  if (list == NULL)
+    return;
+
+  /* The links are freed with their entries */
+  g_hash_table_unref (list->entries);
+  g_free (list);
+}
+
+/* Spreads out the labels of the entries after the one before entry,
+ * up to the first one that leaves enough room for all of them
+ */
+static void
+list_relabel (BeanPluginList *list,
+              ListEntry      *entry)
+{
+  GList *base = entry->link.prev;
+  GList *end = entry->link.next;
+  GList *l;
+  guint64 lo, hi, spacing;
+  guint64 i, n_entries = 1;
+
+  lo = base != NULL ? LIST_ENTRY (base)->order : 0;
+
+  while (TRUE)
+    {
+      hi = end != NULL ? LIST_ENTRY (end)->order : G_MAXUINT64;
+
+      if (hi - lo > (n_entries + 1) * (n_entries + 1))
+        break;
+
+      /* Only happens once the labels at the tail are used up */
+      if (end == NULL)
+        {
+          base = NULL;
+          lo = 0;
+          n_entries = list->queue.length;
+          break;
+        }
+
+      end = end->next;
+      ++n_entries;
+    }
+
+  spacing = (hi - lo) / (n_entries + 1);
+  l = base != NULL ? base->next : list->queue.head;
+
+  for (i = 1; i <= n_entries; ++i, l = l->next)
+    LIST_ENTRY (l)->order = lo + i * spacing;
+}
+
+static void
+list_assign_order (BeanPluginList *list,
+                   ListEntry      *entry)
+{
+  GList *prev = entry->link.prev;
+  GList *next = entry->link.next;
+  guint64 lo, hi, step;
+
+  lo = prev != NULL ? LIST_ENTRY (prev)->order : 0;
+  hi = next != NULL ? LIST_ENTRY (next)->order : G_MAXUINT64;
+
+  if (hi - lo < 2)
+    {
+      list_relabel (list, entry);
+      return;
+    }
+
+  step = MIN ((hi - lo) / 2, ORDER_SPACING);
+
+  if (prev == NULL && next == NULL)
+    entry->order = G_MAXUINT64 / 2;
+  else if (prev == NULL)
+    entry->order = hi - step;
+  else if (next == NULL)
+    entry->order = lo + step;
+  else
+    entry->order = lo + (hi - lo) / 2;
+}
+
+/* The plugin must not already be in the list,
+ * nor another plugin with the same module name
+ */
+void
+bean_plugin_list_add (BeanPluginList *list,
+                      BeanPluginInfo *info)
+{
+  const gchar **dependencies;
+  ListEntry *entry, *furthest_dep = NULL;
+  guint i;
+
+  dependencies = bean_plugin_info_get_dependencies (info);
+
+  for (i = 0; dependencies[i] != NULL; ++i)
+    {
+      ListEntry *dep_entry;
+
+      dep_entry = g_hash_table_lookup (list->entries, dependencies[i]);
+
+      if (dep_entry != NULL &&
+          (furthest_dep == NULL || dep_entry->order > furthest_dep->order))
+        furthest_dep = dep_entry;
+    }
+
+  entry = g_new0 (ListEntry, 1);
+  entry->link.data = info;
+
+  if (furthest_dep == NULL)
+    {
+      g_queue_push_head_link (&list->queue, &entry->link);
+    }
+  else
+    {
+      g_debug ("Adding '%s' after '%s' due to dependencies",
+               bean_plugin_info_get_module_name (info),
+               bean_plugin_info_get_module_name (furthest_dep->link.data));
+
+      g_queue_insert_after_link (&list->queue, &furthest_dep->link,
+                                 &entry->link);
+    }
+
+  list_assign_order (list, entry);
+
+  g_hash_table_insert (list->entries,
+                       (gpointer) bean_plugin_info_get_module_name (info),
+                       entry);
+}
+
+/* Returns FALSE if info is not part of the list */
+gboolean
+bean_plugin_list_remove (BeanPluginList *list,
+                         BeanPluginInfo *info)
+{
+  const gchar *module_name = bean_plugin_info_get_module_name (info);
+  ListEntry *entry;
+
+  entry = g_hash_table_lookup (list->entries, module_name);
+  if (entry == NULL || entry->link.data != info)
+    return FALSE;
+
+  g_queue_unlink (&list->queue, &entry->link);
+  g_hash_table_remove (list->entries, module_name);
+  return TRUE;
+}
+
+const GList *
+bean_plugin_list_get_head (BeanPluginList *list)
+{
+  return list->queue.head;
+}
@@ -33,8 +33,12 @@
 
 typedef struct {
   GMutex lock;
+  GCond cond;
 
   GHashTable *loaded_plugins;
+
+  /* Of the filenames whose module is being opened without the lock */
+  GHashTable *opening_plugins;
 } BeanPluginLoaderCPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (BeanPluginLoaderC,
@@ -47,48 +51,102 @@ G_DEFINE_TYPE_WITH_PRIVATE (BeanPluginLoaderC,
 static GQuark quark_extension_type = 0;
 static const gchar *intern_plugin_info = NULL;
 
-static gboolean
-bean_plugin_loader_c_load (BeanPluginLoader *loader,
-                           BeanPluginInfo   *info)
+static BeanObjectModule *
+open_module (BeanPluginInfo *info)
+{
+  BeanObjectModule *module;
+  const gchar *module_name, *module_dir;
+
+  module_name = bean_plugin_info_get_module_name (info);
+  module_dir = bean_plugin_info_get_module_dir (info);
+
+  if (info->embedded != NULL)
+    {
+      module = bean_object_module_new_embedded (module_name, info->embedded);
+    }
+  else
+    {
+      /* Force all C modules to be resident in case they
+       * use libraries that do not deal well with reloading.
+       * Furthermore, we use local linkage to improve module isolation.
+       */
+      module = bean_object_module_new_full (module_name, module_dir,
+                                            TRUE, TRUE);
+    }
+
+  if (!g_type_module_use (G_TYPE_MODULE (module)))
+    g_clear_object (&module);
+
+  return module;
+}
+
+/* The module is opened without holding the lock so that
+ * different plugins can be opened at the same time
+ */
+static BeanObjectModule *
+get_module (BeanPluginLoaderC *cloader,
+            BeanPluginInfo    *info)
 {
-  BeanPluginLoaderC *cloader = BEAN_PLUGIN_LOADER_C (loader);
   BeanPluginLoaderCPrivate *priv = GET_PRIV (cloader);
+  BeanObjectModule *module;
 
   g_mutex_lock (&priv->lock);
 
-  if (!g_hash_table_lookup_extended (priv->loaded_plugins,
-                                     info->filename,
-                                     NULL, (gpointer *) &info->loader_data))
+  while (g_hash_table_contains (priv->opening_plugins, info->filename))
+    g_cond_wait (&priv->cond, &priv->lock);
+
+  if (g_hash_table_lookup_extended (priv->loaded_plugins, info->filename,
+                                    NULL, (gpointer *) &module))
     {
-      const gchar *module_name, *module_dir;
-
-      module_name = bean_plugin_info_get_module_name (info);
-      module_dir = bean_plugin_info_get_module_dir (info);
-
-      if (info->embedded != NULL)
-        {
-          info->loader_data = bean_object_module_new_embedded (module_name,
-                                                               info->embedded);
-        }
-      else
-        {
-          /* Force all C modules to be resident in case they
-           * use libraries that do not deal well with reloading.
-           * Furthermore, we use local linkage to improve module isolation.
-           */
-          info->loader_data = bean_object_module_new_full (module_name,
-                                                           module_dir,
-                                                           TRUE, TRUE);
-        }
-
-      if (!g_type_module_use (G_TYPE_MODULE (info->loader_data)))
-        g_clear_object (&info->loader_data);
-
-      g_hash_table_insert (priv->loaded_plugins,
-                           g_strdup (info->filename), info->loader_data);
+      g_mutex_unlock (&priv->lock);
+      return module;
     }
 
+  g_hash_table_add (priv->opening_plugins, g_strdup (info->filename));
   g_mutex_unlock (&priv->lock);
+
+  module = open_module (info);
+
+  g_mutex_lock (&priv->lock);
+
+  g_hash_table_insert (priv->loaded_plugins,
+                       g_strdup (info->filename), module);
+  g_hash_table_remove (priv->opening_plugins, info->filename);
+  g_cond_broadcast (&priv->cond);
+
+  g_mutex_unlock (&priv->lock);
+
+  return module;
+}
+
+/*
+ * bean_plugin_loader_c_preload:
+ * @cloader: A #BeanPluginLoaderC.
+ * @info: A #BeanPluginInfo.
+ *
+ * Opens the module of @info and registers its types so that
+ * loading the plugin only has to look it up. This can be called
+ * from any thread, but the dependencies of @info must have been
+ * preloaded or loaded first.
+ */
+void
+bean_plugin_loader_c_preload (BeanPluginLoaderC *cloader,
+                              BeanPluginInfo    *info)
+{
+  g_return_if_fail (BEAN_IS_PLUGIN_LOADER_C (cloader));
+  g_return_if_fail (info != NULL);
+
+  get_module (cloader, info);
+}
+
+static gboolean
+bean_plugin_loader_c_load (BeanPluginLoader *loader,
+                           BeanPluginInfo   *info)
+{
+  BeanPluginLoaderC *cloader = BEAN_PLUGIN_LOADER_C (loader);
+
+  info->loader_data = get_module (cloader, info);
+
   return info->loader_data != NULL;
 }
 
@@ -174,10 +232,13 @@ bean_plugin_loader_c_init (BeanPluginLoaderC *cloader)
   BeanPluginLoaderCPrivate *priv = GET_PRIV (cloader);
 
   g_mutex_init (&priv->lock);
+  g_cond_init (&priv->cond);
 
   /* loaded_plugins maps BeanPluginInfo:filename to a BeanObjectModule */
   priv->loaded_plugins = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                 g_free, NULL);
+  priv->opening_plugins = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, NULL);
 }
 
 static void
@@ -187,8 +248,10 @@ bean_plugin_loader_c_finalize (GObject *object)
   BeanPluginLoaderCPrivate *priv = GET_PRIV (cloader);
 
   g_mutex_clear (&priv->lock);
+  g_cond_clear (&priv->cond);
 
   g_hash_table_destroy (priv->loaded_plugins);
+  g_hash_table_destroy (priv->opening_plugins);
 
   G_OBJECT_CLASS (bean_plugin_loader_c_parent_class)->finalize (object);
 }
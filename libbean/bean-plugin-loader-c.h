@@ -47,6 +47,9 @@ struct _BeanPluginLoaderCClass {
 GType             bean_plugin_loader_c_get_type    (void) G_GNUC_CONST;
 BeanPluginLoader *bean_plugin_loader_c_new         (void);
 
+void              bean_plugin_loader_c_preload     (BeanPluginLoaderC *cloader,
+                                                    BeanPluginInfo    *info);
+
 G_END_DECLS
 
 #endif /* __BEAN_PLUGIN_LOADER_C_H__ */
@@ -0,0 +1,459 @@
+/*
+ * bean-plugin-parser.c
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "bean-plugin-parser.h"
+
+/* Reads the '[Plugin]' section of a plugin file.
+ *
+ * Plugin files are small and only use a tiny part of the #GKeyFile
+ * syntax, so instead of building a #GKeyFile the lines are indexed
+ * in place and values are only copied when they are requested.
+ *
+ * Anything which would need more than that, like escape sequences,
+ * invalid lines or duplicate keys, makes the whole file be loaded
+ * with a #GKeyFile instead. This keeps the behavior and the error
+ * messages of #GKeyFile for every file, however unusual.
+ */
+
+#define PLUGIN_GROUP "Plugin"
+
+typedef struct {
+  /* Points into the bytes, key includes the locale */
+  const gchar *key;
+  gsize key_len;
+  gsize name_len;
+
+  const gchar *value;
+  gsize value_len;
+} ParserEntry;
+
+struct _BeanPluginParser {
+  GBytes *bytes;
+
+  /* Only one of these is used */
+  GKeyFile *key_file;
+  GArray *entries;
+};
+
+static gboolean
+is_valid_locale (const gchar *locale,
+                 gsize        len)
+{
+  gsize i;
+
+  if (len == 0)
+    return FALSE;
+
+  /* Non-ASCII locales are left to GKeyFile */
+  for (i = 0; i < len; ++i)
+    {
+      if (!g_ascii_isalnum (locale[i]) && locale[i] != '-' &&
+          locale[i] != '_' && locale[i] != '.' && locale[i] != '@')
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+parse_group (const gchar  *line,
+             const gchar  *end,
+             gboolean     *is_plugin_group)
+{
+  const gchar *close, *p;
+  gsize len;
+
+  close = memchr (line, ']', end - line);
+  if (close == NULL)
+    return FALSE;
+
+  /* Whitespace is accepted after the ']' */
+  for (p = close + 1; p < end && (*p == ' ' || *p == '\t'); ++p)
+    ;
+
+  if (p != end)
+    return FALSE;
+
+  len = close - (line + 1);
+  if (len == 0)
+    return FALSE;
+
+  for (p = line + 1; p < close; ++p)
+    {
+      if (*p == '[' || (guchar) *p < 0x20)
+        return FALSE;
+    }
+
+  *is_plugin_group = len == strlen (PLUGIN_GROUP) &&
+                     memcmp (line + 1, PLUGIN_GROUP, len) == 0;
+
+  return TRUE;
+}
+
+static gboolean
+parse_key_value (const gchar *line,
+                 const gchar *end,
+                 ParserEntry *entry)
+{
+  const gchar *equal, *key_end, *value, *p;
+
+  equal = memchr (line, '=', end - line);
+  if (equal == NULL)
+    return FALSE;
+
+  for (key_end = equal; key_end > line && g_ascii_isspace (key_end[-1]);)
+    --key_end;
+
+  for (value = equal + 1; value < end && g_ascii_isspace (*value);)
+    ++value;
+
+  for (p = line; p < key_end && *p != '[' && *p != ']'; ++p)
+    ;
+
+  if (p == line)
+    return FALSE;
+
+  entry->key = line;
+  entry->key_len = key_end - line;
+  entry->name_len = p - line;
+
+  if (p != key_end &&
+      (*p != '[' || key_end[-1] != ']' ||
+       !is_valid_locale (p + 1, key_end - p - 2)))
+    return FALSE;
+
+  entry->value = value;
+  entry->value_len = end - value;
+
+  /* Escape sequences are left to GKeyFile */
+  return memchr (value, '\\', entry->value_len) == NULL;
+}
+
+static gboolean
+entry_has_key (const ParserEntry *entry,
+               const gchar       *key,
+               gsize              key_len)
+{
+  return entry->key_len == key_len && memcmp (entry->key, key, key_len) == 0;
+}
+
+static gboolean
+parse_plugin_group (BeanPluginParser *parser)
+{
+  const gchar *data, *data_end, *line;
+  gsize size;
+  gboolean in_group = FALSE, in_plugin_group = FALSE;
+  gboolean found_plugin_group = FALSE;
+
+  data = g_bytes_get_data (parser->bytes, &size);
+  data_end = data + size;
+
+  if (size > 0 && !g_utf8_validate (data, size, NULL))
+    return FALSE;
+
+  for (line = data; line < data_end;)
+    {
+      const gchar *end, *next;
+      ParserEntry entry;
+      guint i;
+
+      end = memchr (line, '\n', data_end - line);
+      if (end == NULL)
+        end = data_end;
+
+      next = end + 1;
+
+      if (end > line && end[-1] == '\r')
+        --end;
+
+      while (line < end && g_ascii_isspace (*line))
+        ++line;
+
+      if (line == end || *line == '#')
+        {
+          line = next;
+          continue;
+        }
+
+      if (*line == '[')
+        {
+          if (!parse_group (line, end, &in_plugin_group))
+            return FALSE;
+
+          /* Duplicate groups are merged by GKeyFile */
+          if (in_plugin_group && found_plugin_group)
+            return FALSE;
+
+          found_plugin_group |= in_plugin_group;
+          in_group = TRUE;
+          line = next;
+          continue;
+        }
+
+      if (!in_group || !parse_key_value (line, end, &entry))
+        return FALSE;
+
+      line = next;
+
+      if (!in_plugin_group)
+        continue;
+
+      for (i = 0; i < parser->entries->len; ++i)
+        {
+          if (entry_has_key (&g_array_index (parser->entries, ParserEntry, i),
+                             entry.key, entry.key_len))
+            return FALSE;
+        }
+
+      g_array_append_val (parser->entries, entry);
+    }
+
+  return TRUE;
+}
+
+/*
+ * bean_plugin_parser_new:
+ * @bytes: The contents of a plugin file.
+ * @flags: #BeanPluginParserFlags.
+ * @error: A #GError.
+ *
+ * Parses the '[Plugin]' section of @bytes.
+ *
+ * Return value: a new #BeanPluginParser, or %NULL if @bytes
+ * is not a valid #GKeyFile.
+ */
+BeanPluginParser *
+bean_plugin_parser_new (GBytes                 *bytes,
+                        BeanPluginParserFlags   flags,
+                        GError                **error)
+{
+  BeanPluginParser *parser;
+
+  g_return_val_if_fail (bytes != NULL, NULL);
+
+  parser = g_slice_new0 (BeanPluginParser);
+  parser->bytes = g_bytes_ref (bytes);
+
+  if ((flags & BEAN_PLUGIN_PARSER_USE_KEY_FILE) == 0)
+    {
+      parser->entries = g_array_sized_new (FALSE, FALSE,
+                                           sizeof (ParserEntry), 16);
+
+      if (parse_plugin_group (parser))
+        return parser;
+
+      g_clear_pointer (&parser->entries, g_array_unref);
+    }
+
+  parser->key_file = g_key_file_new ();
+
+  if (!g_key_file_load_from_bytes (parser->key_file, bytes,
+                                   G_KEY_FILE_NONE, error))
+    {
+      bean_plugin_parser_free (parser);
+      return NULL;
+    }
+
+  return parser;
+}
+
+void
+bean_plugin_parser_free (BeanPluginParser *parser)
+{
+  if (parser == NULL)
+    return;
+
+  g_clear_pointer (&parser->key_file, g_key_file_free);
+  g_clear_pointer (&parser->entries, g_array_unref);
+  g_bytes_unref (parser->bytes);
+  g_slice_free (BeanPluginParser, parser);
+}
+
+gboolean
+bean_plugin_parser_uses_key_file (BeanPluginParser *parser)
+{
+  return parser->key_file != NULL;
+}
+
+static const ParserEntry *
+parser_lookup (BeanPluginParser *parser,
+               const gchar      *key,
+               gsize             key_len)
+{
+  guint i;
+
+  for (i = 0; i < parser->entries->len; ++i)
+    {
+      const ParserEntry *entry;
+
+      entry = &g_array_index (parser->entries, ParserEntry, i);
+
+      if (entry_has_key (entry, key, key_len))
+        return entry;
+    }
+
+  return NULL;
+}
+
+gchar *
+bean_plugin_parser_get_string (BeanPluginParser *parser,
+                               const gchar      *key)
+{
+  const ParserEntry *entry;
+
+  if (parser->key_file != NULL)
+    return g_key_file_get_string (parser->key_file, PLUGIN_GROUP, key, NULL);
+
+  entry = parser_lookup (parser, key, strlen (key));
+
+  return entry != NULL ? g_strndup (entry->value, entry->value_len) : NULL;
+}
+
+/* Same lookup as g_key_file_get_locale_string() */
+gchar *
+bean_plugin_parser_get_locale_string (BeanPluginParser *parser,
+                                      const gchar      *key)
+{
+  const gchar * const *languages;
+  gsize key_len;
+  guint i, j;
+
+  if (parser->key_file != NULL)
+    {
+      return g_key_file_get_locale_string (parser->key_file, PLUGIN_GROUP,
+                                           key, NULL, NULL);
+    }
+
+  key_len = strlen (key);
+  languages = g_get_language_names ();
+
+  for (i = 0; languages[i] != NULL; ++i)
+    {
+      gsize language_len = strlen (languages[i]);
+
+      for (j = 0; j < parser->entries->len; ++j)
+        {
+          const ParserEntry *entry;
+
+          entry = &g_array_index (parser->entries, ParserEntry, j);
+
+          if (entry->name_len == key_len &&
+              entry->key_len == key_len + language_len + 2 &&
+              memcmp (entry->key, key, key_len) == 0 &&
+              memcmp (entry->key + key_len + 1,
+                      languages[i], language_len) == 0)
+            return g_strndup (entry->value, entry->value_len);
+        }
+    }
+
+  return bean_plugin_parser_get_string (parser, key);
+}
+
+gchar **
+bean_plugin_parser_get_string_list (BeanPluginParser *parser,
+                                    const gchar      *key)
+{
+  const ParserEntry *entry;
+  const gchar *piece, *value_end, *separator;
+  GPtrArray *strv;
+
+  if (parser->key_file != NULL)
+    {
+      return g_key_file_get_string_list (parser->key_file, PLUGIN_GROUP,
+                                         key, NULL, NULL);
+    }
+
+  entry = parser_lookup (parser, key, strlen (key));
+  if (entry == NULL)
+    return NULL;
+
+  strv = g_ptr_array_new ();
+  value_end = entry->value + entry->value_len;
+
+  /* Like GKeyFile a trailing separator does not add an empty string */
+  for (piece = entry->value; piece < value_end; piece = separator + 1)
+    {
+      separator = memchr (piece, ';', value_end - piece);
+      if (separator == NULL)
+        separator = value_end;
+
+      g_ptr_array_add (strv, g_strndup (piece, separator - piece));
+    }
+
+  g_ptr_array_add (strv, NULL);
+
+  return (gchar **) g_ptr_array_free (strv, FALSE);
+}
+
+gboolean
+bean_plugin_parser_get_boolean (BeanPluginParser *parser,
+                                const gchar      *key)
+{
+  const ParserEntry *entry;
+  gsize len;
+
+  if (parser->key_file != NULL)
+    return g_key_file_get_boolean (parser->key_file, PLUGIN_GROUP, key, NULL);
+
+  entry = parser_lookup (parser, key, strlen (key));
+  if (entry == NULL)
+    return FALSE;
+
+  /* Trailing whitespace is ignored */
+  for (len = entry->value_len;
+       len > 0 && g_ascii_isspace (entry->value[len - 1]);)
+    --len;
+
+  return (len == 4 && memcmp (entry->value, "true", 4) == 0) ||
+         (len == 1 && entry->value[0] == '1');
+}
+
+/* Includes the keys of the translations, as with g_key_file_get_keys() */
+gchar **
+bean_plugin_parser_get_keys (BeanPluginParser *parser)
+{
+  gchar **keys;
+  guint i;
+
+  if (parser->key_file != NULL)
+    {
+      keys = g_key_file_get_keys (parser->key_file, PLUGIN_GROUP, NULL, NULL);
+      return keys != NULL ? keys : g_new0 (gchar *, 1);
+    }
+
+  keys = g_new (gchar *, parser->entries->len + 1);
+
+  for (i = 0; i < parser->entries->len; ++i)
+    {
+      const ParserEntry *entry;
+
+      entry = &g_array_index (parser->entries, ParserEntry, i);
+      keys[i] = g_strndup (entry->key, entry->key_len);
+    }
+
+  keys[i] = NULL;
+
+  return keys;
+}
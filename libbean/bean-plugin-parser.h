@@ -0,0 +1,66 @@
+/*
+ * bean-plugin-parser.h
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#ifndef __BEAN_PLUGIN_PARSER_H__
+#define __BEAN_PLUGIN_PARSER_H__
+
+#include <glib.h>
+
+#include "bean-version-macros.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  BEAN_PLUGIN_PARSER_NONE         = 0,
+  BEAN_PLUGIN_PARSER_USE_KEY_FILE = 1 << 0
+} BeanPluginParserFlags;
+
+typedef struct _BeanPluginParser BeanPluginParser;
+
+/* Exported for the tests and benchmarks */
+BEAN_AVAILABLE_IN_ALL
+BeanPluginParser  *bean_plugin_parser_new               (GBytes                 *bytes,
+                                                         BeanPluginParserFlags   flags,
+                                                         GError                **error);
+BEAN_AVAILABLE_IN_ALL
+void               bean_plugin_parser_free              (BeanPluginParser       *parser);
+
+BEAN_AVAILABLE_IN_ALL
+gboolean           bean_plugin_parser_uses_key_file     (BeanPluginParser       *parser);
+
+BEAN_AVAILABLE_IN_ALL
+gchar             *bean_plugin_parser_get_string        (BeanPluginParser       *parser,
+                                                         const gchar            *key);
+BEAN_AVAILABLE_IN_ALL
+gchar             *bean_plugin_parser_get_locale_string (BeanPluginParser       *parser,
+                                                         const gchar            *key);
+BEAN_AVAILABLE_IN_ALL
+gchar            **bean_plugin_parser_get_string_list   (BeanPluginParser       *parser,
+                                                         const gchar            *key);
+BEAN_AVAILABLE_IN_ALL
+gboolean           bean_plugin_parser_get_boolean       (BeanPluginParser       *parser,
+                                                         const gchar            *key);
+BEAN_AVAILABLE_IN_ALL
+gchar            **bean_plugin_parser_get_keys          (BeanPluginParser       *parser);
+
+G_END_DECLS
+
+#endif /* __BEAN_PLUGIN_PARSER_H__ */
@@ -0,0 +1,466 @@
+/*
+ * bean-provider-index.c
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+
+#include <glib/gstdio.h>
+
+#include "bean-plugin-cache.h"
+#include "bean-provider-index.h"
+
+/* The index remembers, for each plugin file, which extension types
+ * its plugin was asked about once it was loaded and whether it
+ * provided them, so that they do not have to be asked again.
+ *
+ * It is a single serialized GVariant in the cache directory. An
+ * entry is only trusted while the mtime and size of its plugin file
+ * and of its module are unchanged, which is checked when the entry
+ * is first used. The module is what decides what the plugin provides,
+ * so it can be upgraded without touching the plugin file.
+ *
+ * The magic number doubles as a version and endianness check,
+ * bump it whenever the format changes.
+ */
+#define INDEX_MAGIC    0x42504902
+#define INDEX_BASENAME "extension-providers.index"
+#define INDEX_TYPE     "(ua{s(xtxta{sb})})"
+
+typedef struct {
+  gint64 mtime;
+  guint64 size;
+
+  /* -1 and 0 if the plugin has no module file */
+  gint64 module_mtime;
+  guint64 module_size;
+
+  /* Of extension type name to whether it is provided */
+  GHashTable *types;
+
+  guint validated : 1;
+} IndexEntry;
+
+struct _BeanProviderIndex {
+  GMutex lock;
+
+  /* Of plugin filename to IndexEntry */
+  GHashTable *entries;
+
+  guint dirty : 1;
+};
+
+static IndexEntry *
+index_entry_new (gint64  mtime,
+                 guint64 size,
+                 gint64  module_mtime,
+                 guint64 module_size)
+{
+  IndexEntry *entry;
+
+  entry = g_slice_new0 (IndexEntry);
+  entry->mtime = mtime;
+  entry->size = size;
+  entry->module_mtime = module_mtime;
+  entry->module_size = module_size;
+  entry->types = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, NULL);
+
+  return entry;
+}
+
+static void
+index_entry_free (IndexEntry *entry)
+{
+  g_hash_table_unref (entry->types);
+  g_slice_free (IndexEntry, entry);
+}
+
+static void
+stat_file (const gchar *filename,
+           gint64      *mtime,
+           guint64     *size)
+{
+  GStatBuf buf;
+
+  if (filename == NULL || g_stat (filename, &buf) != 0)
+    {
+      *mtime = -1;
+      *size = 0;
+      return;
+    }
+
+  *mtime = bean_plugin_cache_get_mtime (&buf);
+  *size = buf.st_size;
+}
+
+BeanProviderIndex *
+bean_provider_index_new (void)
+{
+  BeanProviderIndex *index;
+
+  index = g_new0 (BeanProviderIndex, 1);
+  g_mutex_init (&index->lock);
+  index->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify) index_entry_free);
+
+  return index;
+}
+
+void
+bean_provider_index_free (BeanProviderIndex *index)
+{
+  if (index == NULL)
+    return;
+
+  g_hash_table_unref (index->entries);
+  g_mutex_clear (&index->lock);
+  g_free (index);
+}
+
+/*
+ * bean_provider_index_load:
+ * @index: A #BeanProviderIndex.
+ * @cache_dir: The directory where caches are stored.
+ *
+ * Adds the entries saved in @cache_dir to @index,
+ * without replacing the entries it already has.
+ */
+void
+bean_provider_index_load (BeanProviderIndex *index,
+                          const gchar       *cache_dir)
+{
+  gchar *filename;
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *variant;
+  GVariantIter *iter;
+  const gchar *plugin_filename;
+  GVariantIter *types_iter;
+  gint64 mtime, module_mtime;
+  guint64 size, module_size;
+  guint32 magic;
+  GError *error = NULL;
+
+  filename = g_build_filename (cache_dir, INDEX_BASENAME, NULL);
+  mapped = g_mapped_file_new (filename, FALSE, &error);
+
+  if (mapped == NULL)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_debug ("Failed to open provider index: %s", error->message);
+
+      g_error_free (error);
+      g_free (filename);
+      return;
+    }
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  variant = g_variant_new_from_bytes (G_VARIANT_TYPE (INDEX_TYPE),
+                                      bytes, FALSE);
+  g_variant_ref_sink (variant);
+  g_bytes_unref (bytes);
+
+  g_variant_get (variant, INDEX_TYPE, &magic, &iter);
+
+  if (magic != INDEX_MAGIC)
+    {
+      g_debug ("Ignoring incompatible provider index '%s'", filename);
+      goto out;
+    }
+
+  g_mutex_lock (&index->lock);
+
+  while (g_variant_iter_next (iter, "{&s(xtxta{sb})}",
+                              &plugin_filename, &mtime, &size,
+                              &module_mtime, &module_size, &types_iter))
+    {
+      IndexEntry *entry;
+      const gchar *type_name;
+      gboolean provided;
+
+      if (g_hash_table_contains (index->entries, plugin_filename))
+        {
+          g_variant_iter_free (types_iter);
+          continue;
+        }
+
+      entry = index_entry_new (mtime, size, module_mtime, module_size);
+
+      while (g_variant_iter_next (types_iter, "{&sb}", &type_name, &provided))
+        g_hash_table_insert (entry->types, g_strdup (type_name),
+                             GINT_TO_POINTER (provided));
+
+      g_hash_table_insert (index->entries, g_strdup (plugin_filename), entry);
+      g_variant_iter_free (types_iter);
+    }
+
+  g_mutex_unlock (&index->lock);
+
+  g_debug ("Loaded provider index '%s'", filename);
+
+out:
+
+  g_variant_iter_free (iter);
+  g_variant_unref (variant);
+  g_free (filename);
+}
+
+/*
+ * bean_provider_index_save:
+ * @index: A #BeanProviderIndex.
+ * @cache_dir: The directory where caches are stored.
+ *
+ * Atomically writes @index to @cache_dir if
+ * it changed since it was loaded or last saved.
+ *
+ * Returns: %TRUE if the index was written.
+ */
+gboolean
+bean_provider_index_save (BeanProviderIndex *index,
+                          const gchar       *cache_dir)
+{
+  GVariantBuilder entries;
+  GHashTableIter iter;
+  const gchar *plugin_filename;
+  IndexEntry *entry;
+  GVariant *variant;
+  gchar *filename;
+  gboolean saved;
+  GError *error = NULL;
+
+  g_mutex_lock (&index->lock);
+
+  if (!index->dirty)
+    {
+      g_mutex_unlock (&index->lock);
+      return FALSE;
+    }
+
+  g_variant_builder_init (&entries, G_VARIANT_TYPE ("a{s(xtxta{sb})}"));
+
+  g_hash_table_iter_init (&iter, index->entries);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &plugin_filename,
+                                 (gpointer *) &entry))
+    {
+      GVariantBuilder types;
+      GHashTableIter types_iter;
+      const gchar *type_name;
+      gpointer provided;
+
+      g_variant_builder_init (&types, G_VARIANT_TYPE ("a{sb}"));
+
+      g_hash_table_iter_init (&types_iter, entry->types);
+      while (g_hash_table_iter_next (&types_iter, (gpointer *) &type_name,
+                                     &provided))
+        g_variant_builder_add (&types, "{sb}", type_name,
+                               GPOINTER_TO_INT (provided));
+
+      g_variant_builder_add (&entries, "{s(xtxta{sb})}", plugin_filename,
+                             entry->mtime, entry->size,
+                             entry->module_mtime, entry->module_size,
+                             &types);
+    }
+
+  index->dirty = FALSE;
+
+  g_mutex_unlock (&index->lock);
+
+  variant = g_variant_new (INDEX_TYPE, (guint32) INDEX_MAGIC, &entries);
+  g_variant_ref_sink (variant);
+
+  filename = g_build_filename (cache_dir, INDEX_BASENAME, NULL);
+
+  if (g_mkdir_with_parents (cache_dir, 0755) != 0)
+    {
+      g_debug ("Failed to create plugin cache directory '%s': %s",
+               cache_dir, g_strerror (errno));
+      saved = FALSE;
+    }
+  else if (!g_file_set_contents (filename,
+                                 g_variant_get_data (variant),
+                                 g_variant_get_size (variant),
+                                 &error))
+    {
+      g_debug ("Failed to write provider index: %s", error->message);
+      g_error_free (error);
+      saved = FALSE;
+    }
+  else
+    {
+      g_debug ("Saved provider index '%s'", filename);
+      saved = TRUE;
+    }
+
+  g_free (filename);
+  g_variant_unref (variant);
+
+  return saved;
+}
+
+/* Called with the lock held */
+static IndexEntry *
+lookup_entry (BeanProviderIndex *index,
+              const gchar       *filename,
+              const gchar       *module_filename)
+{
+  IndexEntry *entry;
+  gint64 mtime, module_mtime;
+  guint64 size, module_size;
+
+  entry = g_hash_table_lookup (index->entries, filename);
+
+  if (entry == NULL || entry->validated)
+    return entry;
+
+  /* The plugin might have been replaced since it was recorded */
+  stat_file (filename, &mtime, &size);
+  stat_file (module_filename, &module_mtime, &module_size);
+  entry->validated = TRUE;
+
+  if (entry->mtime != mtime || entry->size != size ||
+      entry->module_mtime != module_mtime ||
+      entry->module_size != module_size)
+    {
+      g_debug ("Provider index is out of date for '%s'", filename);
+
+      g_hash_table_remove_all (entry->types);
+      entry->mtime = mtime;
+      entry->size = size;
+      entry->module_mtime = module_mtime;
+      entry->module_size = module_size;
+      index->dirty = TRUE;
+    }
+
+  return entry;
+}
+
+/*
+ * bean_provider_index_lookup:
+ * @index: A #BeanProviderIndex.
+ * @filename: The filename of the plugin file.
+ * @module_filename: (nullable): The filename of the plugin's module.
+ * @type_name: The name of the extension type.
+ *
+ * Checks if the plugin of @filename was recorded as
+ * providing the extension type named @type_name.
+ * This is thread-safe.
+ *
+ * Returns: what was recorded for the plugin and extension type.
+ */
+BeanProviderState
+bean_provider_index_lookup (BeanProviderIndex *index,
+                            const gchar       *filename,
+                            const gchar       *module_filename,
+                            const gchar       *type_name)
+{
+  IndexEntry *entry;
+  gpointer provided;
+  BeanProviderState state = BEAN_PROVIDER_UNKNOWN;
+
+  g_mutex_lock (&index->lock);
+
+  entry = lookup_entry (index, filename, module_filename);
+
+  if (entry != NULL &&
+      g_hash_table_lookup_extended (entry->types, type_name, NULL, &provided))
+    {
+      state = GPOINTER_TO_INT (provided) ? BEAN_PROVIDER_PROVIDED :
+                                           BEAN_PROVIDER_NOT_PROVIDED;
+    }
+
+  g_mutex_unlock (&index->lock);
+
+  return state;
+}
+
+/*
+ * bean_provider_index_record:
+ * @index: A #BeanProviderIndex.
+ * @filename: The filename of the plugin file.
+ * @module_filename: (nullable): The filename of the plugin's module.
+ * @type_name: The name of the extension type.
+ * @provided: Whether the loaded plugin provides the extension type.
+ *
+ * Records if the plugin of @filename provides the extension
+ * type named @type_name. This is thread-safe.
+ */
+void
+bean_provider_index_record (BeanProviderIndex *index,
+                            const gchar       *filename,
+                            const gchar       *module_filename,
+                            const gchar       *type_name,
+                            gboolean           provided)
+{
+  IndexEntry *entry;
+  gpointer old_provided;
+
+  g_mutex_lock (&index->lock);
+
+  entry = lookup_entry (index, filename, module_filename);
+
+  if (entry == NULL)
+    {
+      gint64 mtime, module_mtime;
+      guint64 size, module_size;
+
+      stat_file (filename, &mtime, &size);
+      stat_file (module_filename, &module_mtime, &module_size);
+
+      entry = index_entry_new (mtime, size, module_mtime, module_size);
+      entry->validated = TRUE;
+      g_hash_table_insert (index->entries, g_strdup (filename), entry);
+    }
+
+  if (!g_hash_table_lookup_extended (entry->types, type_name,
+                                     NULL, &old_provided) ||
+      GPOINTER_TO_INT (old_provided) != (provided != FALSE))
+    {
+      g_hash_table_insert (entry->types, g_strdup (type_name),
+                           GINT_TO_POINTER (provided != FALSE));
+      index->dirty = TRUE;
+    }
+
+  g_mutex_unlock (&index->lock);
+}
+
+/*
+ * bean_provider_index_remove:
+ * @index: A #BeanProviderIndex.
+ * @filename: The filename of the plugin file.
+ *
+ * Forgets what was recorded for the plugin of @filename,
+ * for instance because the plugin file was changed.
+ * This is thread-safe.
+ */
+void
+bean_provider_index_remove (BeanProviderIndex *index,
+                            const gchar       *filename)
+{
+  g_mutex_lock (&index->lock);
+
+  if (g_hash_table_remove (index->entries, filename))
+    index->dirty = TRUE;
+
+  g_mutex_unlock (&index->lock);
+}
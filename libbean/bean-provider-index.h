@@ -0,0 +1,59 @@
+/*
+ * bean-provider-index.h
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#ifndef __BEAN_PROVIDER_INDEX_H__
+#define __BEAN_PROVIDER_INDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BeanProviderIndex BeanProviderIndex;
+
+typedef enum {
+  BEAN_PROVIDER_UNKNOWN,
+  BEAN_PROVIDER_PROVIDED,
+  BEAN_PROVIDER_NOT_PROVIDED
+} BeanProviderState;
+
+BeanProviderIndex *bean_provider_index_new    (void);
+void               bean_provider_index_free   (BeanProviderIndex *index);
+
+void               bean_provider_index_load   (BeanProviderIndex *index,
+                                               const gchar       *cache_dir);
+gboolean           bean_provider_index_save   (BeanProviderIndex *index,
+                                               const gchar       *cache_dir);
+
+BeanProviderState  bean_provider_index_lookup (BeanProviderIndex *index,
+                                               const gchar       *filename,
+                                               const gchar       *module_filename,
+                                               const gchar       *type_name);
+void               bean_provider_index_record (BeanProviderIndex *index,
+                                               const gchar       *filename,
+                                               const gchar       *module_filename,
+                                               const gchar       *type_name,
+                                               gboolean           provided);
+void               bean_provider_index_remove (BeanProviderIndex *index,
+                                               const gchar       *filename);
+
+G_END_DECLS
+
+#endif /* __BEAN_PROVIDER_INDEX_H__ */
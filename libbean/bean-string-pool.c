@@ -0,0 +1,301 @@
+/*
+ * bean-string-pool.c
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+
+#include "bean-string-pool.h"
+
+/* Stores the strings of the plugin infos of an engine.
+ *
+ * Many of these strings are the same for many plugins, like the
+ * directories, the authors or the dependencies, so each distinct
+ * string and string vector is only stored once. They are allocated
+ * one after the other in large blocks, which are all freed at once
+ * with the pool.
+ *
+ * Nothing is ever removed from a pool, instead interning keeps it
+ * from growing when the same plugin files are read again. Each plugin
+ * info keeps a reference on its pool, as the plugin infos can outlive
+ * their engine. This is also how the strings of modified plugin files
+ * are freed: the engine parses them into a new pool for each rescan,
+ * which is freed once the last plugin info using it is.
+ */
+
+#define BLOCK_SIZE 4096
+
+struct _BeanStringPool {
+  gint refcount;
+
+  GMutex lock;
+
+  /* Of blocks allocated with g_malloc() */
+  GPtrArray *blocks;
+  gchar *block_pos;
+  gsize block_left;
+
+  /* Both only contain memory from the blocks */
+  GHashTable *strings;
+  GHashTable *strvs;
+};
+
+/* The strings of interned vectors are interned,
+ * so they can be compared by their address
+ */
+static guint
+strv_hash (gconstpointer data)
+{
+  const gchar * const *strv = data;
+  guint hash = 5381;
+  gsize i;
+
+  for (i = 0; strv[i] != NULL; ++i)
+    hash = hash * 33 + g_direct_hash (strv[i]);
+
+  return hash;
+}
+
+static gboolean
+strv_equal (gconstpointer a,
+            gconstpointer b)
+{
+  const gchar * const *strv_a = a;
+  const gchar * const *strv_b = b;
+  gsize i;
+
+  for (i = 0; strv_a[i] != NULL && strv_a[i] == strv_b[i]; ++i)
+    ;
+
+  return strv_a[i] == strv_b[i];
+}
+
+BeanStringPool *
+bean_string_pool_new (void)
+{
+  BeanStringPool *pool;
+
+  pool = g_slice_new0 (BeanStringPool);
+  pool->refcount = 1;
+
+  g_mutex_init (&pool->lock);
+
+  pool->blocks = g_ptr_array_new_with_free_func (g_free);
+  pool->strings = g_hash_table_new (g_str_hash, g_str_equal);
+  pool->strvs = g_hash_table_new (strv_hash, strv_equal);
+
+  return pool;
+}
+
+BeanStringPool *
+bean_string_pool_ref (BeanStringPool *pool)
+{
+  g_atomic_int_inc (&pool->refcount);
+  return pool;
+}
+
+void
+bean_string_pool_unref (BeanStringPool *pool)
+{
+  if (!g_atomic_int_dec_and_test (&pool->refcount))
+    return;
+
+  g_hash_table_unref (pool->strvs);
+  g_hash_table_unref (pool->strings);
+  g_ptr_array_unref (pool->blocks);
+  g_mutex_clear (&pool->lock);
+  g_slice_free (BeanStringPool, pool);
+}
+
+/* Must be called with the lock held */
+static gpointer
+pool_alloc (BeanStringPool *pool,
+            gsize           size,
+            gsize           align)
+{
+  gsize padding;
+  gpointer mem;
+
+  padding = (align - GPOINTER_TO_SIZE (pool->block_pos) % align) % align;
+
+  if (pool->block_pos == NULL || padding + size > pool->block_left)
+    {
+      /* Large allocations get their own block so
+       * that the rest of the current one is not lost
+       */
+      if (size > BLOCK_SIZE / 4)
+        {
+          mem = g_malloc (size);
+          g_ptr_array_add (pool->blocks, mem);
+          return mem;
+        }
+
+      pool->block_pos = g_malloc (BLOCK_SIZE);
+      pool->block_left = BLOCK_SIZE;
+      g_ptr_array_add (pool->blocks, pool->block_pos);
+      padding = 0;
+    }
+
+  mem = pool->block_pos + padding;
+  pool->block_pos += padding + size;
+  pool->block_left -= padding + size;
+
+  return mem;
+}
+
+/* Must be called with the lock held */
+static const gchar *
+pool_intern (BeanStringPool *pool,
+             const gchar    *str)
+{
+  gchar *interned;
+  gsize len;
+
+  interned = g_hash_table_lookup (pool->strings, str);
+  if (interned != NULL)
+    return interned;
+
+  len = strlen (str);
+  interned = pool_alloc (pool, len + 1, 1);
+  memcpy (interned, str, len + 1);
+
+  g_hash_table_add (pool->strings, interned);
+
+  return interned;
+}
+
+/*
+ * bean_string_pool_intern:
+ * @pool: A #BeanStringPool.
+ * @str: (allow-none): A string.
+ *
+ * Stores @str in @pool if it is not already there. This is thread-safe.
+ *
+ * Return value: (allow-none): a string owned by @pool.
+ */
+const gchar *
+bean_string_pool_intern (BeanStringPool *pool,
+                         const gchar    *str)
+{
+  const gchar *interned;
+
+  if (str == NULL)
+    return NULL;
+
+  g_mutex_lock (&pool->lock);
+  interned = pool_intern (pool, str);
+  g_mutex_unlock (&pool->lock);
+
+  return interned;
+}
+
+/*
+ * bean_string_pool_take:
+ * @pool: A #BeanStringPool.
+ * @str: (allow-none) (transfer full): A string.
+ *
+ * Like bean_string_pool_intern() but frees @str.
+ *
+ * Return value: (allow-none): a string owned by @pool.
+ */
+const gchar *
+bean_string_pool_take (BeanStringPool *pool,
+                       gchar          *str)
+{
+  const gchar *interned;
+
+  interned = bean_string_pool_intern (pool, str);
+  g_free (str);
+
+  return interned;
+}
+
+/*
+ * bean_string_pool_intern_strv:
+ * @pool: A #BeanStringPool.
+ * @strv: (allow-none): A %NULL-terminated string vector.
+ *
+ * Stores @strv and its strings in @pool if they
+ * are not already there. This is thread-safe.
+ *
+ * Return value: (allow-none): a string vector owned by @pool.
+ */
+const gchar * const *
+bean_string_pool_intern_strv (BeanStringPool      *pool,
+                              const gchar * const *strv)
+{
+  const gchar **interned;
+  const gchar **existing;
+  gsize i, len;
+
+  if (strv == NULL)
+    return NULL;
+
+  len = g_strv_length ((gchar **) strv);
+
+  g_mutex_lock (&pool->lock);
+
+  /* The strings are interned even if the vector was already
+   * stored, which is why it is only kept if it is new
+   */
+  interned = g_newa (const gchar *, len + 1);
+
+  for (i = 0; i < len; ++i)
+    interned[i] = pool_intern (pool, strv[i]);
+
+  interned[len] = NULL;
+
+  existing = g_hash_table_lookup (pool->strvs, interned);
+  if (existing == NULL)
+    {
+      existing = pool_alloc (pool, (len + 1) * sizeof (gchar *),
+                             G_ALIGNOF (gchar *));
+      memcpy (existing, interned, (len + 1) * sizeof (gchar *));
+
+      g_hash_table_add (pool->strvs, existing);
+    }
+
+  g_mutex_unlock (&pool->lock);
+
+  return existing;
+}
+
+/*
+ * bean_string_pool_take_strv:
+ * @pool: A #BeanStringPool.
+ * @strv: (allow-none) (transfer full): A %NULL-terminated string vector.
+ *
+ * Like bean_string_pool_intern_strv() but frees @strv.
+ *
+ * Return value: (allow-none): a string vector owned by @pool.
+ */
+const gchar * const *
+bean_string_pool_take_strv (BeanStringPool  *pool,
+                            gchar          **strv)
+{
+  const gchar * const *interned;
+
+  interned = bean_string_pool_intern_strv (pool, (const gchar * const *) strv);
+  g_strfreev (strv);
+
+  return interned;
+}
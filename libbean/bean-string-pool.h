@@ -0,0 +1,46 @@
+/*
+ * bean-string-pool.h
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+#ifndef __BEAN_STRING_POOL_H__
+#define __BEAN_STRING_POOL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BeanStringPool BeanStringPool;
+
+BeanStringPool      *bean_string_pool_new         (void);
+BeanStringPool      *bean_string_pool_ref         (BeanStringPool      *pool);
+void                 bean_string_pool_unref       (BeanStringPool      *pool);
+
+const gchar         *bean_string_pool_intern      (BeanStringPool      *pool,
+                                                   const gchar         *str);
+const gchar         *bean_string_pool_take        (BeanStringPool      *pool,
+                                                   gchar               *str);
+const gchar * const *bean_string_pool_intern_strv (BeanStringPool      *pool,
+                                                   const gchar * const *strv);
+const gchar * const *bean_string_pool_take_strv   (BeanStringPool      *pool,
+                                                   gchar              **strv);
+
+G_END_DECLS
+
+#endif /* __BEAN_STRING_POOL_H__ */
@@ -25,9 +25,18 @@
 
 #include <stdlib.h>
 #include <glib.h>
+#include <glib/gstdio.h>
+#ifdef G_OS_WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
 #include <libbean/bean.h>
 
 #include "libbean/bean-engine-priv.h"
+#include "libbean/bean-load-profile.h"
+#include "libbean/bean-plugin-info-priv.h"
+#include "libbean/bean-provider-index.h"
 
 #include "testing/testing.h"
 
@@ -295,6 +304,35 @@ test_engine_plugin_list (BeanEngine *engine)
   g_assert_cmpint (loadable_index, <, two_deps_index);
 }
 
+static void
+test_engine_plugin_dependants (BeanEngine *engine)
+{
+  BeanPluginInfo *info;
+  GList *dependants;
+
+  info = bean_engine_get_plugin_info (engine, "loadable");
+  dependants = bean_engine_get_plugin_dependants (engine, info);
+
+  g_assert_cmpuint (g_list_length (dependants), ==, 2);
+  g_assert_cmpstr (bean_plugin_info_get_module_name (dependants->data),
+                   ==, "has-dep");
+  g_assert_cmpstr (bean_plugin_info_get_module_name (dependants->next->data),
+                   ==, "two-deps");
+  g_list_free (dependants);
+
+  info = bean_engine_get_plugin_info (engine, "builtin");
+  dependants = bean_engine_get_plugin_dependants (engine, info);
+
+  g_assert_cmpuint (g_list_length (dependants), ==, 1);
+  g_assert_cmpstr (bean_plugin_info_get_module_name (dependants->data),
+                   ==, "two-deps");
+  g_list_free (dependants);
+
+  /* Depending on yourself does not make you a dependant */
+  info = bean_engine_get_plugin_info (engine, "self-dep");
+  g_assert (bean_engine_get_plugin_dependants (engine, info) == NULL);
+}
+
 static void
 load_plugin_cb (BeanEngine     *engine G_GNUC_UNUSED,
                 BeanPluginInfo *info,
@@ -427,6 +465,302 @@ test_engine_enable_loader_multiple_times (BeanEngine *engine)
   bean_engine_enable_loader (engine, "C");
 }
 
+static void
+record_load_plugin_cb (BeanEngine     *engine G_GNUC_UNUSED,
+                       BeanPluginInfo *info,
+                       GPtrArray      *loaded)
+{
+  if (bean_plugin_info_is_loaded (info))
+    g_ptr_array_add (loaded, (gpointer) bean_plugin_info_get_module_name (info));
+}
+
+static void
+test_engine_parallel_load (BeanEngine *engine)
+{
+  GPtrArray *loaded;
+  const gchar *load_plugins[] = {
+    "self-dep", "has-dep", "builtin", "nonexistent-dep", NULL
+  };
+
+  testing_util_push_log_hook ("Could not find plugin 'does-not-exist'*");
+
+  loaded = g_ptr_array_new ();
+  g_signal_connect_after (engine, "load-plugin",
+                          G_CALLBACK (record_load_plugin_cb), loaded);
+
+  g_object_set (engine, "parallel-load", TRUE, NULL);
+  bean_engine_set_loaded_plugins (engine, load_plugins);
+
+  /* Still loaded on this thread and in the usual order */
+  g_assert_cmpuint (loaded->len, ==, 4);
+  g_assert_cmpstr (g_ptr_array_index (loaded, 0), ==, "builtin");
+  g_assert_cmpstr (g_ptr_array_index (loaded, 1), ==, "loadable");
+  g_assert_cmpstr (g_ptr_array_index (loaded, 2), ==, "has-dep");
+  g_assert_cmpstr (g_ptr_array_index (loaded, 3), ==, "self-dep");
+
+  g_assert (!bean_plugin_info_is_loaded (bean_engine_get_plugin_info (engine,
+                                                                      "nonexistent-dep")));
+
+  g_ptr_array_unref (loaded);
+}
+
+static void
+load_plugins_cb (BeanEngine    *engine G_GNUC_UNUSED,
+                 GAsyncResult  *result,
+                 GAsyncResult **result_out)
+{
+  *result_out = g_object_ref (result);
+}
+
+static void
+load_plugin_thread_cb (BeanEngine     *engine G_GNUC_UNUSED,
+                       BeanPluginInfo *info G_GNUC_UNUSED,
+                       GThread        *thread)
+{
+  g_assert (g_thread_self () == thread);
+}
+
+static gboolean
+load_plugins_sync (BeanEngine    *engine,
+                   const gchar  **plugin_names,
+                   GCancellable  *cancellable,
+                   GError       **error)
+{
+  GAsyncResult *result = NULL;
+  gboolean retval;
+
+  bean_engine_load_plugins_async (engine, plugin_names, cancellable,
+                                  (GAsyncReadyCallback) load_plugins_cb,
+                                  &result);
+
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  retval = bean_engine_load_plugins_finish (engine, result, error);
+  g_object_unref (result);
+
+  return retval;
+}
+
+static void
+test_engine_load_plugins_async (BeanEngine *engine)
+{
+  BeanPluginInfo *info;
+  GCancellable *cancellable;
+  GAsyncResult *result = NULL;
+  const gchar *has_dep[] = { "has-dep", NULL };
+  const gchar *not_found[] = { "has-dep", "does-not-exist", NULL };
+  GError *error = NULL;
+
+  g_signal_connect (engine, "load-plugin",
+                    G_CALLBACK (load_plugin_thread_cb), g_thread_self ());
+
+  /* Nothing is loaded when cancelled */
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+
+  g_assert (!load_plugins_sync (engine, has_dep, cancellable, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&error);
+
+  info = bean_engine_get_plugin_info (engine, "has-dep");
+  g_assert (!bean_plugin_info_is_loaded (info));
+  info = bean_engine_get_plugin_info (engine, "loadable");
+  g_assert (!bean_plugin_info_is_loaded (info));
+
+  /* The plugins which were found are still loaded */
+  g_assert (!load_plugins_sync (engine, not_found, NULL, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+  g_clear_error (&error);
+
+  g_assert (bean_plugin_info_is_loaded (info));
+  info = bean_engine_get_plugin_info (engine, "has-dep");
+  g_assert (bean_plugin_info_is_loaded (info));
+
+  /* Same for a single plugin */
+  info = bean_engine_get_plugin_info (engine, "builtin");
+  bean_engine_load_plugin_async (engine, info, NULL,
+                                 (GAsyncReadyCallback) load_plugins_cb,
+                                 &result);
+
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert (bean_engine_load_plugin_finish (engine, result, &error));
+  g_assert_no_error (error);
+  g_assert (bean_plugin_info_is_loaded (info));
+
+  g_object_unref (result);
+  g_object_unref (cancellable);
+}
+
+static void
+record_plugin_cb (BeanEngine     *engine G_GNUC_UNUSED,
+                  BeanPluginInfo *info,
+                  GPtrArray      *plugins)
+{
+  g_ptr_array_add (plugins, (gpointer) bean_plugin_info_get_module_name (info));
+}
+
+static void
+test_engine_set_loaded_plugins_order (BeanEngine *engine)
+{
+  GPtrArray *loaded, *unloaded;
+  const gchar *all_plugins[] = {
+    "has-dep", "builtin", "builtin", "does-not-exist", NULL
+  };
+  const gchar *builtin_plugin[] = { "builtin", NULL };
+
+  loaded = g_ptr_array_new ();
+  unloaded = g_ptr_array_new ();
+  g_signal_connect (engine, "load-plugin",
+                    G_CALLBACK (record_plugin_cb), loaded);
+  g_signal_connect (engine, "unload-plugin",
+                    G_CALLBACK (record_plugin_cb), unloaded);
+
+  /* Dependencies are loaded with their dependants, by the default
+   * handler, so the signal is emitted for them after the dependant's
+   */
+  bean_engine_set_loaded_plugins (engine, all_plugins);
+
+  g_assert_cmpuint (loaded->len, ==, 3);
+  g_assert_cmpstr (g_ptr_array_index (loaded, 0), ==, "builtin");
+  g_assert_cmpstr (g_ptr_array_index (loaded, 1), ==, "has-dep");
+  g_assert_cmpstr (g_ptr_array_index (loaded, 2), ==, "loadable");
+  g_assert (bean_plugin_info_is_loaded (bean_engine_get_plugin_info (engine,
+                                                                     "loadable")));
+
+  /* Dependants are unloaded before their dependencies */
+  bean_engine_set_loaded_plugins (engine, builtin_plugin);
+
+  g_assert_cmpuint (unloaded->len, ==, 2);
+  g_assert_cmpstr (g_ptr_array_index (unloaded, 0), ==, "has-dep");
+  g_assert_cmpstr (g_ptr_array_index (unloaded, 1), ==, "loadable");
+  g_assert (bean_plugin_info_is_loaded (bean_engine_get_plugin_info (engine,
+                                                                     "builtin")));
+
+  g_ptr_array_set_size (unloaded, 0);
+  bean_engine_set_loaded_plugins (engine, NULL);
+
+  /* Nothing was loaded again */
+  g_assert_cmpuint (loaded->len, ==, 3);
+  g_assert_cmpuint (unloaded->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (unloaded, 0), ==, "builtin");
+
+  g_ptr_array_unref (unloaded);
+  g_ptr_array_unref (loaded);
+}
+
+static void
+count_notify_cb (GObject    *object G_GNUC_UNUSED,
+                 GParamSpec *pspec G_GNUC_UNUSED,
+                 gint       *count)
+{
+  ++(*count);
+}
+
+static void
+loaded_plugins_changed_cb (BeanEngine  *engine G_GNUC_UNUSED,
+                           gchar      **loaded,
+                           gchar      **unloaded,
+                           GPtrArray   *changes)
+{
+  g_ptr_array_add (changes, g_strdupv (loaded));
+  g_ptr_array_add (changes, g_strdupv (unloaded));
+}
+
+static guint n_changes_notified = 0;
+
+static void
+record_n_changes_cb (GObject    *object G_GNUC_UNUSED,
+                     GParamSpec *pspec G_GNUC_UNUSED,
+                     GPtrArray  *changes)
+{
+  n_changes_notified = changes->len;
+}
+
+static void
+test_engine_batch (BeanEngine *engine)
+{
+  GPtrArray *changes;
+  gchar **strv;
+  gint notified = 0;
+
+  changes = g_ptr_array_new_with_free_func ((GDestroyNotify) g_strfreev);
+
+  g_signal_connect (engine, "notify::loaded-plugins",
+                    G_CALLBACK (count_notify_cb), &notified);
+  g_signal_connect (engine, "notify::loaded-plugins",
+                    G_CALLBACK (record_n_changes_cb), changes);
+  g_signal_connect (engine, "loaded-plugins-changed",
+                    G_CALLBACK (loaded_plugins_changed_cb), changes);
+
+  /* Emitted right away without a batch, before the notification */
+  n_changes_notified = 0;
+  bean_engine_load_plugin (engine,
+                           bean_engine_get_plugin_info (engine, "builtin"));
+
+  g_assert_cmpint (notified, ==, 1);
+  g_assert_cmpuint (n_changes_notified, ==, 2);
+  g_assert_cmpuint (changes->len, ==, 2);
+  strv = g_ptr_array_index (changes, 0);
+  g_assert_cmpstr (strv[0], ==, "builtin");
+  g_assert (strv[1] == NULL);
+  strv = g_ptr_array_index (changes, 1);
+  g_assert (strv[0] == NULL);
+
+  notified = 0;
+  g_ptr_array_set_size (changes, 0);
+
+  /* Nested batches are only committed by the outermost one */
+  bean_engine_begin_batch (engine);
+  bean_engine_begin_batch (engine);
+
+  bean_engine_load_plugin (engine,
+                           bean_engine_get_plugin_info (engine, "has-dep"));
+  bean_engine_unload_plugin (engine,
+                             bean_engine_get_plugin_info (engine, "builtin"));
+  bean_engine_load_plugin (engine,
+                           bean_engine_get_plugin_info (engine, "builtin"));
+
+  bean_engine_commit_batch (engine);
+
+  g_assert_cmpint (notified, ==, 0);
+  g_assert_cmpuint (changes->len, ==, 0);
+
+  bean_engine_unload_plugin (engine,
+                             bean_engine_get_plugin_info (engine, "builtin"));
+
+  n_changes_notified = 0;
+  bean_engine_commit_batch (engine);
+
+  g_assert_cmpint (notified, ==, 1);
+  g_assert_cmpuint (n_changes_notified, ==, 2);
+  g_assert_cmpuint (changes->len, ==, 2);
+  strv = g_ptr_array_index (changes, 0);
+  g_assert_cmpstr (strv[0], ==, "loadable");
+  g_assert_cmpstr (strv[1], ==, "has-dep");
+  g_assert (strv[2] == NULL);
+  strv = g_ptr_array_index (changes, 1);
+  g_assert_cmpstr (strv[0], ==, "builtin");
+  g_assert (strv[1] == NULL);
+
+  notified = 0;
+  g_ptr_array_set_size (changes, 0);
+
+  /* Nothing changed */
+  bean_engine_begin_batch (engine);
+  bean_engine_load_plugin (engine,
+                           bean_engine_get_plugin_info (engine, "builtin"));
+  bean_engine_unload_plugin (engine,
+                             bean_engine_get_plugin_info (engine, "builtin"));
+  bean_engine_commit_batch (engine);
+
+  g_assert_cmpuint (changes->len, ==, 0);
+
+  g_ptr_array_unref (changes);
+}
+
 static void
 test_engine_nonexistent_search_path (BeanEngine *engine)
 {
@@ -434,6 +768,823 @@ test_engine_nonexistent_search_path (BeanEngine *engine)
   bean_engine_add_search_path (engine, "/nowhere", NULL);
 }
 
+static void
+write_plugin_file (const gchar *plugin_dir,
+                   const gchar *module_name,
+                   const gchar *name)
+{
+  gchar *basename, *filename, *contents;
+  GError *error = NULL;
+
+  basename = g_strconcat (module_name, ".plugin", NULL);
+  filename = g_build_filename (plugin_dir, basename, NULL);
+  contents = g_strdup_printf ("[Plugin]\n"
+                              "Module=%s\n"
+                              "Name=%s\n"
+                              "X-Name=%s\n",
+                              module_name, name, name);
+
+  g_file_set_contents (filename, contents, -1, &error);
+  g_assert_no_error (error);
+
+  g_free (contents);
+  g_free (filename);
+  g_free (basename);
+}
+
+static void
+remove_dir_recursive (const gchar *path)
+{
+  GDir *dir;
+  const gchar *name;
+
+  dir = g_dir_open (path, 0, NULL);
+  g_assert (dir != NULL);
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *child = g_build_filename (path, name, NULL);
+
+      if (g_file_test (child, G_FILE_TEST_IS_DIR))
+        remove_dir_recursive (child);
+      else
+        g_assert_cmpint (g_remove (child), ==, 0);
+
+      g_free (child);
+    }
+
+  g_dir_close (dir);
+  g_assert_cmpint (g_rmdir (path), ==, 0);
+}
+
+static BeanEngine *
+cached_engine_new (const gchar *cache_dir,
+                   const gchar *plugin_dir)
+{
+  BeanEngine *engine;
+
+  engine = BEAN_ENGINE (g_object_new (BEAN_TYPE_ENGINE,
+                                      "cache-dir", cache_dir,
+                                      NULL));
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+
+  return engine;
+}
+
+static void
+reset_mtime (const gchar    *path,
+             const GStatBuf *buf)
+{
+  struct utimbuf times;
+
+  times.actime = buf->st_atime;
+  times.modtime = buf->st_mtime;
+  g_assert_cmpint (g_utime (path, &times), ==, 0);
+}
+
+static guint
+count_dir_entries (const gchar *path)
+{
+  GDir *dir;
+  guint n_entries = 0;
+
+  dir = g_dir_open (path, 0, NULL);
+  g_assert (dir != NULL);
+
+  while (g_dir_read_name (dir) != NULL)
+    ++n_entries;
+
+  g_dir_close (dir);
+
+  return n_entries;
+}
+
+static void
+test_engine_plugin_cache (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  gchar *tmp_dir, *plugin_dir, *cache_dir;
+  GError *error = NULL;
+
+  tmp_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  plugin_dir = g_build_filename (tmp_dir, "plugins", NULL);
+  cache_dir = g_build_filename (tmp_dir, "cache", NULL);
+  g_assert_cmpint (g_mkdir (plugin_dir, 0755), ==, 0);
+
+  write_plugin_file (plugin_dir, "cached", "Cached");
+  write_plugin_file (plugin_dir, "removed", "Removed");
+
+  /* Scans the plugin files and writes the cache */
+  engine = cached_engine_new (cache_dir, plugin_dir);
+  g_assert (bean_engine_get_plugin_info (engine, "cached") != NULL);
+  g_assert (bean_engine_get_plugin_info (engine, "removed") != NULL);
+  g_object_unref (engine);
+
+  g_assert_cmpuint (count_dir_entries (cache_dir), ==, 1);
+
+  /* Reads the plugin infos from the cache */
+  engine = cached_engine_new (cache_dir, plugin_dir);
+  info = bean_engine_get_plugin_info (engine, "cached");
+  g_assert (info != NULL);
+  g_assert_cmpstr (bean_plugin_info_get_name (info), ==, "Cached");
+  g_assert_cmpstr (bean_plugin_info_get_external_data (info, "Name"),
+                   ==, "Cached");
+  g_assert_cmpstr (bean_plugin_info_get_module_dir (info), ==, plugin_dir);
+  g_assert (bean_plugin_info_get_dependencies (info)[0] == NULL);
+  g_assert (bean_engine_get_plugin_info (engine, "removed") != NULL);
+  g_object_unref (engine);
+
+  /* A modified plugin file is noticed even if the mtime has not changed */
+  {
+    gchar *filename = g_build_filename (plugin_dir, "cached.plugin", NULL);
+    GStatBuf file_buf, dir_buf;
+
+    g_assert_cmpint (g_stat (filename, &file_buf), ==, 0);
+    g_assert_cmpint (g_stat (plugin_dir, &dir_buf), ==, 0);
+
+    write_plugin_file (plugin_dir, "cached", "Cached Again");
+
+    /* Only the size of the plugin file tells it apart */
+    reset_mtime (filename, &file_buf);
+    reset_mtime (plugin_dir, &dir_buf);
+    g_free (filename);
+  }
+
+  engine = cached_engine_new (cache_dir, plugin_dir);
+  info = bean_engine_get_plugin_info (engine, "cached");
+  g_assert_cmpstr (bean_plugin_info_get_name (info), ==, "Cached Again");
+  g_object_unref (engine);
+
+  /* A removed plugin file is noticed */
+  {
+    gchar *filename = g_build_filename (plugin_dir, "removed.plugin", NULL);
+
+    g_assert_cmpint (g_remove (filename), ==, 0);
+    g_free (filename);
+  }
+
+  engine = cached_engine_new (cache_dir, plugin_dir);
+  g_assert (bean_engine_get_plugin_info (engine, "cached") != NULL);
+  g_assert (bean_engine_get_plugin_info (engine, "removed") == NULL);
+  g_object_unref (engine);
+
+  remove_dir_recursive (tmp_dir);
+
+  g_free (cache_dir);
+  g_free (plugin_dir);
+  g_free (tmp_dir);
+}
+
+static gchar **
+scan_plugin_dir (const gchar *plugin_dir,
+                 gboolean     parallel_scan)
+{
+  BeanEngine *engine;
+  const GList *plugins;
+  GPtrArray *names;
+
+  engine = BEAN_ENGINE (g_object_new (BEAN_TYPE_ENGINE,
+                                      "parallel-scan", parallel_scan,
+                                      NULL));
+
+  /* Must be warned about on this thread */
+  testing_util_push_log_hook ("*Could not find 'Name' in "
+                              "*invalid.plugin*");
+  testing_util_push_log_hook ("*Error loading *invalid.plugin*");
+
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+
+  testing_util_pop_log_hooks ();
+
+  names = g_ptr_array_new ();
+
+  plugins = bean_engine_get_plugin_list (engine);
+  for (; plugins != NULL; plugins = plugins->next)
+    {
+      const gchar *module_name;
+
+      module_name = bean_plugin_info_get_module_name (plugins->data);
+      g_ptr_array_add (names, g_strdup (module_name));
+    }
+
+  g_ptr_array_add (names, NULL);
+  g_object_unref (engine);
+
+  return (gchar **) g_ptr_array_free (names, FALSE);
+}
+
+static void
+write_module_file (const gchar *filename,
+                   const gchar *contents)
+{
+  GError *error = NULL;
+
+  g_file_set_contents (filename, contents, -1, &error);
+  g_assert_no_error (error);
+}
+
+static void
+test_engine_provider_index (void)
+{
+  BeanProviderIndex *index;
+  gchar *tmp_dir, *cache_dir, *filename, *module_filename;
+  GError *error = NULL;
+
+  tmp_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  cache_dir = g_build_filename (tmp_dir, "cache", NULL);
+  filename = g_build_filename (tmp_dir, "indexed.plugin", NULL);
+  module_filename = g_build_filename (tmp_dir, "indexed.py", NULL);
+  write_plugin_file (tmp_dir, "indexed", "Indexed");
+  write_module_file (module_filename, "# Indexed\n");
+
+  index = bean_provider_index_new ();
+  bean_provider_index_record (index, filename, module_filename,
+                              "BeanActivatable", TRUE);
+  bean_provider_index_record (index, filename, module_filename,
+                              "IntrospectionBase", FALSE);
+  g_assert (bean_provider_index_save (index, cache_dir));
+
+  /* Only saved again once something changed */
+  g_assert (!bean_provider_index_save (index, cache_dir));
+  bean_provider_index_free (index);
+
+  index = bean_provider_index_new ();
+  bean_provider_index_load (index, cache_dir);
+  g_assert_cmpint (bean_provider_index_lookup (index, filename,
+                                               module_filename,
+                                               "BeanActivatable"),
+                   ==, BEAN_PROVIDER_PROVIDED);
+  g_assert_cmpint (bean_provider_index_lookup (index, filename,
+                                               module_filename,
+                                               "IntrospectionBase"),
+                   ==, BEAN_PROVIDER_NOT_PROVIDED);
+  g_assert_cmpint (bean_provider_index_lookup (index, filename,
+                                               module_filename,
+                                               "IntrospectionCallable"),
+                   ==, BEAN_PROVIDER_UNKNOWN);
+  g_assert (!bean_provider_index_save (index, cache_dir));
+  bean_provider_index_free (index);
+
+  /* Forgotten once the module is modified */
+  write_module_file (module_filename, "# Indexed Again\n");
+
+  index = bean_provider_index_new ();
+  bean_provider_index_load (index, cache_dir);
+  g_assert_cmpint (bean_provider_index_lookup (index, filename,
+                                               module_filename,
+                                               "IntrospectionBase"),
+                   ==, BEAN_PROVIDER_UNKNOWN);
+  bean_provider_index_record (index, filename, module_filename,
+                              "BeanActivatable", TRUE);
+  g_assert (bean_provider_index_save (index, cache_dir));
+  bean_provider_index_free (index);
+
+  /* Forgotten once the plugin file is modified */
+  write_plugin_file (tmp_dir, "indexed", "Indexed Again");
+
+  index = bean_provider_index_new ();
+  bean_provider_index_load (index, cache_dir);
+  g_assert_cmpint (bean_provider_index_lookup (index, filename,
+                                               module_filename,
+                                               "BeanActivatable"),
+                   ==, BEAN_PROVIDER_UNKNOWN);
+  bean_provider_index_free (index);
+
+  remove_dir_recursive (tmp_dir);
+
+  g_free (module_filename);
+  g_free (filename);
+  g_free (cache_dir);
+  g_free (tmp_dir);
+}
+
+static gboolean
+loadable_provides_activatable (const gchar *cache_dir)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  gboolean provided;
+
+  engine = testing_engine_new ();
+  g_object_set (engine, "cache-dir", cache_dir, NULL);
+
+  info = bean_engine_get_plugin_info (engine, "loadable");
+  g_assert (bean_engine_load_plugin (engine, info));
+
+  provided = bean_engine_provides_extension (engine, info,
+                                             BEAN_TYPE_ACTIVATABLE);
+
+  testing_engine_free (engine);
+
+  return provided;
+}
+
+static void
+test_engine_provider_index_module (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  BeanProviderIndex *index;
+  gchar *tmp_dir, *cache_dir, *filename;
+  gchar *module_filename, *old_module_filename;
+  GError *error = NULL;
+
+  tmp_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  cache_dir = g_build_filename (tmp_dir, "cache", NULL);
+  old_module_filename = g_build_filename (tmp_dir, "old-module", NULL);
+  write_module_file (old_module_filename, "");
+
+  engine = testing_engine_new ();
+  info = bean_engine_get_plugin_info (engine, "loadable");
+  filename = g_strdup (info->filename);
+  module_filename = _bean_plugin_info_get_module_filename (info);
+  g_assert (g_file_test (module_filename, G_FILE_TEST_IS_REGULAR));
+  testing_engine_free (engine);
+
+  /* A recorded answer is trusted while the module is unchanged */
+  index = bean_provider_index_new ();
+  bean_provider_index_record (index, filename, module_filename,
+                              "BeanActivatable", FALSE);
+  g_assert (bean_provider_index_save (index, cache_dir));
+  bean_provider_index_free (index);
+
+  g_assert (!loadable_provides_activatable (cache_dir));
+
+  /* As if the module was upgraded without touching the plugin file */
+  index = bean_provider_index_new ();
+  bean_provider_index_load (index, cache_dir);
+  bean_provider_index_record (index, filename, old_module_filename,
+                              "BeanActivatable", FALSE);
+  g_assert (bean_provider_index_save (index, cache_dir));
+  bean_provider_index_free (index);
+
+  g_assert (loadable_provides_activatable (cache_dir));
+
+  /* The engine recorded the new answer */
+  index = bean_provider_index_new ();
+  bean_provider_index_load (index, cache_dir);
+  g_assert_cmpint (bean_provider_index_lookup (index, filename,
+                                               module_filename,
+                                               "BeanActivatable"),
+                   ==, BEAN_PROVIDER_PROVIDED);
+  bean_provider_index_free (index);
+
+  remove_dir_recursive (tmp_dir);
+
+  g_free (old_module_filename);
+  g_free (module_filename);
+  g_free (filename);
+  g_free (cache_dir);
+  g_free (tmp_dir);
+}
+
+static void
+test_engine_load_profile (void)
+{
+  BeanEngine *engine;
+  BeanLoadProfile *profile;
+  gchar *tmp_dir, *filename;
+  const gchar *plugin_names[] = { "has-dep", NULL };
+  GError *error = NULL;
+
+  tmp_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  filename = g_build_filename (tmp_dir, "profile", "load.profile", NULL);
+
+  /* Records the plugins as they are loaded and saves on dispose */
+  engine = testing_engine_new ();
+  g_object_set (engine, "load-profile", filename, NULL);
+  bean_engine_set_loaded_plugins (engine, plugin_names);
+  testing_engine_free (engine);
+
+  g_assert (g_file_test (filename, G_FILE_TEST_IS_REGULAR));
+
+  profile = bean_load_profile_new ();
+  bean_load_profile_load (profile, filename);
+  g_assert (!bean_load_profile_is_empty (profile));
+  g_assert_cmpint (bean_load_profile_get_position (profile, "loadable"),
+                   ==, 0);
+  g_assert_cmpint (bean_load_profile_get_position (profile, "has-dep"),
+                   ==, 1);
+  g_assert_cmpint (bean_load_profile_get_duration (profile, "has-dep"),
+                   >=, 0);
+  g_assert_cmpint (bean_load_profile_get_phase_duration (profile, "has-dep",
+                                                         BEAN_LOAD_PHASE_MODULE_OPEN),
+                   >=, 0);
+  g_assert_cmpint (bean_load_profile_get_phase_duration (profile, "has-dep",
+                                                         BEAN_LOAD_PHASE_REGISTER_TYPES),
+                   >=, 0);
+
+  /* A C plugin has nothing to import */
+  g_assert_cmpint (bean_load_profile_get_phase_duration (profile, "has-dep",
+                                                         BEAN_LOAD_PHASE_IMPORT),
+                   ==, 0);
+  g_assert_cmpint (bean_load_profile_get_phase_duration (profile, "builtin",
+                                                         BEAN_LOAD_PHASE_IMPORT),
+                   ==, -1);
+  g_assert_cmpint (bean_load_profile_get_position (profile, "builtin"),
+                   ==, -1);
+
+  /* Nothing was recorded, so the previous profile is kept */
+  g_assert (!bean_load_profile_save (profile, filename));
+  bean_load_profile_free (profile);
+
+  /* Replays the profile of the previous run */
+  engine = testing_engine_new ();
+  g_object_set (engine, "load-profile", filename, NULL);
+  bean_engine_set_loaded_plugins (engine, plugin_names);
+  g_assert (bean_plugin_info_is_loaded (bean_engine_get_plugin_info (engine,
+                                                                     "has-dep")));
+  testing_engine_free (engine);
+
+  remove_dir_recursive (tmp_dir);
+
+  g_free (filename);
+  g_free (tmp_dir);
+}
+
+static void
+test_engine_prefetch_modules (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  GPtrArray *loaded;
+  gint i;
+  const gchar *load_plugins[] = { "self-dep", "has-dep", NULL };
+  const gchar *no_plugins[] = { NULL };
+
+  engine = testing_engine_new ();
+  g_object_set (engine, "prefetch-modules", TRUE, NULL);
+
+  loaded = g_ptr_array_new ();
+  g_signal_connect_after (engine, "load-plugin",
+                          G_CALLBACK (record_load_plugin_cb), loaded);
+
+  /* Still loads the same plugins in the same order */
+  bean_engine_set_loaded_plugins (engine, load_plugins);
+
+  g_assert_cmpuint (loaded->len, ==, 3);
+  g_assert_cmpstr (g_ptr_array_index (loaded, 0), ==, "loadable");
+  g_assert_cmpstr (g_ptr_array_index (loaded, 1), ==, "has-dep");
+  g_assert_cmpstr (g_ptr_array_index (loaded, 2), ==, "self-dep");
+
+  /* Each call stops the previous prefetch */
+  for (i = 0; i < 10; ++i)
+    {
+      bean_engine_set_loaded_plugins (engine, no_plugins);
+      bean_engine_set_loaded_plugins (engine, load_plugins);
+    }
+
+  g_assert (bean_plugin_info_is_loaded (bean_engine_get_plugin_info (engine,
+                                                                     "has-dep")));
+
+  /* Disposing while prefetching waits for it to stop,
+   * so it no longer holds a reference to the plugins
+   */
+  bean_engine_set_loaded_plugins (engine, no_plugins);
+  info = _bean_plugin_info_ref (bean_engine_get_plugin_info (engine,
+                                                             "has-dep"));
+  bean_engine_set_loaded_plugins (engine, load_plugins);
+  testing_engine_free (engine);
+
+  g_assert_cmpint (g_atomic_int_get (&info->refcount), ==, 1);
+  _bean_plugin_info_unref (info);
+
+  g_ptr_array_unref (loaded);
+}
+
+static void
+test_engine_lazy_load_loader (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  gchar *plugin_dir, *filename;
+  GError *error = NULL;
+
+  plugin_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  filename = g_build_filename (plugin_dir, "deferred.plugin", NULL);
+  g_file_set_contents (filename,
+                       "[Plugin]\n"
+                       "Module=deferred\n"
+                       "Loader=lua5.1\n"
+                       "Name=Deferred\n"
+                       "X-Provides=BeanActivatable;\n", -1, &error);
+  g_assert_no_error (error);
+
+  engine = BEAN_ENGINE (g_object_new (BEAN_TYPE_ENGINE,
+                                      "lazy-load", TRUE,
+                                      NULL));
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+
+  /* The loader was not enabled, looking it up would warn */
+  info = bean_engine_get_plugin_info (engine, "deferred");
+  g_assert (bean_engine_load_plugin (engine, info));
+  g_assert (info->deferred);
+
+  g_assert (bean_engine_unload_plugin (engine, info));
+  g_assert (!info->deferred);
+
+  g_object_unref (engine);
+  remove_dir_recursive (plugin_dir);
+  g_free (filename);
+  g_free (plugin_dir);
+}
+
+static void
+test_engine_parallel_scan (void)
+{
+  gchar *plugin_dir, *filename;
+  gchar **sequential, **parallel;
+  guint i;
+  GError *error = NULL;
+
+  plugin_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  for (i = 0; i < 64; ++i)
+    {
+      gchar *module_name = g_strdup_printf ("parallel-%u", i);
+
+      write_plugin_file (plugin_dir, module_name, module_name);
+      g_free (module_name);
+    }
+
+  filename = g_build_filename (plugin_dir, "invalid.plugin", NULL);
+  g_file_set_contents (filename, "[Plugin]\nModule=invalid\n", -1, &error);
+  g_assert_no_error (error);
+  g_free (filename);
+
+  sequential = scan_plugin_dir (plugin_dir, FALSE);
+  parallel = scan_plugin_dir (plugin_dir, TRUE);
+
+  g_assert_cmpuint (g_strv_length (sequential), ==, 64);
+  g_assert (g_strv_equal ((const gchar * const *) sequential,
+                          (const gchar * const *) parallel));
+
+  remove_dir_recursive (plugin_dir);
+
+  g_strfreev (parallel);
+  g_strfreev (sequential);
+  g_free (plugin_dir);
+}
+
+static void
+remove_plugin_file (const gchar *plugin_dir,
+                    const gchar *module_name)
+{
+  gchar *basename, *filename;
+
+  basename = g_strconcat (module_name, ".plugin", NULL);
+  filename = g_build_filename (plugin_dir, basename, NULL);
+
+  g_assert_cmpint (g_remove (filename), ==, 0);
+
+  g_free (filename);
+  g_free (basename);
+}
+
+static void
+test_engine_rescan_plugins (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  GList *unchanged_link;
+  const gchar **dependencies;
+  gchar *plugin_dir, *filename;
+  GError *error = NULL;
+
+  plugin_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  write_plugin_file (plugin_dir, "unchanged", "Unchanged");
+  write_plugin_file (plugin_dir, "modified", "Modified");
+  write_plugin_file (plugin_dir, "removed", "Removed");
+
+  engine = bean_engine_new ();
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+
+  /* Nothing changed so the plugin infos are kept */
+  info = bean_engine_get_plugin_info (engine, "unchanged");
+  bean_engine_rescan_plugins (engine);
+  g_assert (bean_engine_get_plugin_info (engine, "unchanged") == info);
+
+  /* The plugin list is updated in place */
+  unchanged_link = g_list_find ((GList *) bean_engine_get_plugin_list (engine),
+                                info);
+  g_assert (unchanged_link != NULL);
+
+  /* The dependencies are not read lazily, unlike the name */
+  filename = g_build_filename (plugin_dir, "modified.plugin", NULL);
+  g_file_set_contents (filename,
+                       "[Plugin]\n"
+                       "Module=modified\n"
+                       "Name=Modified Again\n"
+                       "Depends=unchanged\n", -1, &error);
+  g_assert_no_error (error);
+
+  write_plugin_file (plugin_dir, "added", "Added");
+  remove_plugin_file (plugin_dir, "removed");
+
+  /* Only new plugins are added unless the search paths are monitored */
+  bean_engine_rescan_plugins (engine);
+
+  g_assert (bean_engine_get_plugin_info (engine, "added") != NULL);
+  g_assert (bean_engine_get_plugin_info (engine, "removed") != NULL);
+
+  dependencies = bean_plugin_info_get_dependencies (
+        bean_engine_get_plugin_info (engine, "modified"));
+  g_assert (dependencies[0] == NULL);
+
+  g_object_set (engine, "monitor-search-paths", TRUE, NULL);
+  bean_engine_rescan_plugins (engine);
+
+  g_assert (bean_engine_get_plugin_info (engine, "unchanged") == info);
+  g_assert (unchanged_link->data == info);
+  g_assert (g_list_position ((GList *) bean_engine_get_plugin_list (engine),
+                             unchanged_link) != -1);
+  g_assert (bean_engine_get_plugin_info (engine, "added") != NULL);
+  g_assert (bean_engine_get_plugin_info (engine, "removed") == NULL);
+
+  info = bean_engine_get_plugin_info (engine, "modified");
+  g_assert (info != NULL);
+  g_assert_cmpstr (bean_plugin_info_get_name (info), ==, "Modified Again");
+
+  dependencies = bean_plugin_info_get_dependencies (info);
+  g_assert_cmpuint (g_strv_length ((gchar **) dependencies), ==, 1);
+  g_assert_cmpstr (dependencies[0], ==, "unchanged");
+
+  /* Its strings are freed with it rather than with the engine */
+  g_assert (info->strings !=
+            bean_engine_get_plugin_info (engine, "unchanged")->strings);
+
+  g_assert_cmpuint (g_list_length ((GList *) bean_engine_get_plugin_list (engine)),
+                    ==, 3);
+
+  /* The modified plugin must still be removable */
+  g_assert_cmpint (g_remove (filename), ==, 0);
+  bean_engine_rescan_plugins (engine);
+
+  g_assert (bean_engine_get_plugin_info (engine, "modified") == NULL);
+  g_assert_cmpuint (g_list_length ((GList *) bean_engine_get_plugin_list (engine)),
+                    ==, 2);
+
+  g_object_unref (engine);
+  remove_dir_recursive (plugin_dir);
+  g_free (filename);
+  g_free (plugin_dir);
+}
+
+static void
+rescan_plugins_cb (BeanEngine    *engine G_GNUC_UNUSED,
+                   GAsyncResult  *result,
+                   GAsyncResult **result_out)
+{
+  *result_out = g_object_ref (result);
+}
+
+static gboolean
+rescan_plugins_sync (BeanEngine    *engine,
+                     GCancellable  *cancellable,
+                     GError       **error)
+{
+  GAsyncResult *result = NULL;
+  gboolean retval;
+
+  bean_engine_rescan_plugins_async (engine, cancellable,
+                                    (GAsyncReadyCallback) rescan_plugins_cb,
+                                    &result);
+
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  retval = bean_engine_rescan_plugins_finish (engine, result, error);
+  g_object_unref (result);
+
+  return retval;
+}
+
+static void
+test_engine_rescan_plugins_async (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  GCancellable *cancellable;
+  gchar *plugin_dir;
+  GError *error = NULL;
+
+  plugin_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  write_plugin_file (plugin_dir, "modified", "Modified");
+  write_plugin_file (plugin_dir, "removed", "Removed");
+
+  engine = bean_engine_new ();
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+
+  write_plugin_file (plugin_dir, "modified", "Modified Again");
+  write_plugin_file (plugin_dir, "added", "Added");
+  remove_plugin_file (plugin_dir, "removed");
+
+  /* Removed and modified plugins are only handled while monitoring,
+   * which starts after the changes so that only the rescan sees them
+   */
+  g_object_set (engine, "monitor-search-paths", TRUE, NULL);
+
+  /* Nothing is applied when cancelled */
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+
+  g_assert (!rescan_plugins_sync (engine, cancellable, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&error);
+
+  g_assert (bean_engine_get_plugin_info (engine, "added") == NULL);
+  g_assert (bean_engine_get_plugin_info (engine, "removed") != NULL);
+
+  g_assert (rescan_plugins_sync (engine, NULL, &error));
+  g_assert_no_error (error);
+
+  g_assert (bean_engine_get_plugin_info (engine, "added") != NULL);
+  g_assert (bean_engine_get_plugin_info (engine, "removed") == NULL);
+
+  info = bean_engine_get_plugin_info (engine, "modified");
+  g_assert (info != NULL);
+  g_assert_cmpstr (bean_plugin_info_get_name (info), ==, "Modified Again");
+
+  g_object_unref (cancellable);
+  g_object_unref (engine);
+  remove_dir_recursive (plugin_dir);
+  g_free (plugin_dir);
+}
+
+/* Waits until the plugin has the name, or is gone if name is %NULL */
+static gboolean
+wait_for_plugin (BeanEngine  *engine,
+                 const gchar *module_name,
+                 const gchar *name)
+{
+  gint64 end_time = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+
+  while (g_get_monotonic_time () < end_time)
+    {
+      BeanPluginInfo *info;
+
+      info = bean_engine_get_plugin_info (engine, module_name);
+
+      if (name == NULL && info == NULL)
+        return TRUE;
+
+      if (name != NULL && info != NULL &&
+          g_strcmp0 (bean_plugin_info_get_name (info), name) == 0)
+        return TRUE;
+
+      if (!g_main_context_iteration (NULL, FALSE))
+        g_usleep (10 * 1000);
+    }
+
+  return FALSE;
+}
+
+static void
+test_engine_monitor_search_paths (void)
+{
+  BeanEngine *engine;
+  gchar *plugin_dir;
+  GError *error = NULL;
+
+  plugin_dir = g_dir_make_tmp ("libbean-engine-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  engine = BEAN_ENGINE (g_object_new (BEAN_TYPE_ENGINE,
+                                      "monitor-search-paths", TRUE,
+                                      NULL));
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+  g_assert (bean_engine_get_plugin_list (engine) == NULL);
+
+  write_plugin_file (plugin_dir, "monitored", "Monitored");
+  g_assert (wait_for_plugin (engine, "monitored", "Monitored"));
+
+  write_plugin_file (plugin_dir, "monitored", "Monitored Again");
+  g_assert (wait_for_plugin (engine, "monitored", "Monitored Again"));
+
+  remove_plugin_file (plugin_dir, "monitored");
+  g_assert (wait_for_plugin (engine, "monitored", NULL));
+
+  g_object_unref (engine);
+  remove_dir_recursive (plugin_dir);
+  g_free (plugin_dir);
+}
+
 static void
 test_engine_shutdown (void)
 {
@@ -488,13 +1639,29 @@ main (int    argc,
   TEST ("not-loadable-plugin", not_loadable_plugin);
 
   TEST ("plugin-list", plugin_list);
+  TEST ("plugin-dependants", plugin_dependants);
   TEST ("loaded-plugins", loaded_plugins);
+  TEST ("set-loaded-plugins-order", set_loaded_plugins_order);
+  TEST ("parallel-load", parallel_load);
+  TEST ("load-plugins-async", load_plugins_async);
+  TEST ("batch", batch);
 
   TEST ("enable-unkown-loader", enable_unkown_loader);
   TEST ("enable-loader-multiple-times", enable_loader_multiple_times);
 
   TEST ("nonexistent-search-path", nonexistent_search_path);
 
+  TEST_FUNC ("plugin-cache", plugin_cache);
+  TEST_FUNC ("provider-index", provider_index);
+  TEST_FUNC ("provider-index-module", provider_index_module);
+  TEST_FUNC ("load-profile", load_profile);
+  TEST_FUNC ("prefetch-modules", prefetch_modules);
+  TEST_FUNC ("lazy-load-loader", lazy_load_loader);
+  TEST_FUNC ("parallel-scan", parallel_scan);
+  TEST_FUNC ("rescan-plugins", rescan_plugins);
+  TEST_FUNC ("rescan-plugins-async", rescan_plugins_async);
+  TEST_FUNC ("monitor-search-paths", monitor_search_paths);
+
   TEST_FUNC ("shutdown", shutdown);
   TEST ("shutdown/subprocess", shutdown_subprocess);
 
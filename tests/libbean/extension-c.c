@@ -28,6 +28,8 @@
 
 #include "testing/testing-extension.h"
 #include "introspection/introspection-base.h"
+#include "introspection/introspection-callable.h"
+#include "introspection/introspection-unimplemented.h"
 #include "plugins/embedded/embedded-plugin.h"
 #include "plugins/embedded/embedded-resources.h"
 
@@ -174,6 +176,50 @@ test_extension_c_missing_symbol (BeanEngine *engine)
   g_assert (!bean_engine_load_plugin (engine, info));
 }
 
+static void
+test_extension_c_lazy_load (BeanEngine     *engine,
+                            BeanPluginInfo *info)
+{
+  BeanPluginInfo *nonexistent_info;
+  BeanExtension *extension;
+
+  g_assert (bean_engine_unload_plugin (engine, info));
+  g_object_set (engine, "lazy-load", TRUE, NULL);
+
+  /* Only loaded by the loader when first used */
+  g_assert (bean_engine_load_plugin (engine, info));
+  g_assert (bean_plugin_info_is_loaded (info));
+  g_assert (info->deferred);
+
+  g_assert (!bean_engine_provides_extension (engine, info,
+                                             INTROSPECTION_TYPE_UNIMPLEMENTED));
+  g_assert (info->deferred);
+
+  extension = bean_engine_create_extension (engine, info,
+                                            INTROSPECTION_TYPE_BASE,
+                                            NULL);
+  g_assert (BEAN_IS_EXTENSION (extension));
+  g_assert (!info->deferred);
+  g_object_unref (extension);
+
+  /* The missing module is only noticed when it is needed */
+  nonexistent_info = bean_engine_get_plugin_info (engine,
+                                                  "extension-c-nonexistent");
+
+  g_assert (bean_engine_load_plugin (engine, nonexistent_info));
+  g_assert (!bean_engine_provides_extension (engine, nonexistent_info,
+                                             INTROSPECTION_TYPE_BASE));
+  g_assert (bean_plugin_info_is_loaded (nonexistent_info));
+
+  testing_util_push_log_hook ("Failed to load module 'extension-c-nonexistent'*");
+  testing_util_push_log_hook ("Error loading plugin 'extension-c-nonexistent'");
+
+  g_assert (!bean_engine_provides_extension (engine, nonexistent_info,
+                                             INTROSPECTION_TYPE_CALLABLE));
+  g_assert (!bean_plugin_info_is_loaded (nonexistent_info));
+  g_assert (!bean_plugin_info_is_available (nonexistent_info, NULL));
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -197,6 +243,7 @@ main (int   argc,
   EXTENSION_TEST (c, "nonexistent", nonexistent);
   EXTENSION_TEST (c, "local-linkage", local_linkage);
   EXTENSION_TEST (c, "missing-symbol", missing_symbol);
+  EXTENSION_TEST (c, "lazy-load", lazy_load);
 
   return testing_extension_run_tests ();
 }
@@ -354,6 +354,41 @@ test_extension_set_call_valid (BeanEngine *engine)
   g_object_unref (extension_set);
 }
 
+static void
+n_activate_calls_cb (BeanExtensionSet *set G_GNUC_UNUSED,
+                     BeanPluginInfo   *info G_GNUC_UNUSED,
+                     BeanExtension    *extension,
+                     gint             *n_calls)
+{
+  g_assert_cmpint (GPOINTER_TO_INT (g_object_get_data (G_OBJECT (extension),
+                                                       "testing-n-activate-calls")),
+                   ==, *n_calls);
+}
+
+static void
+test_extension_set_call_each (BeanEngine *engine)
+{
+  gint n_calls = 0;
+  BeanExtensionSet *extension_set;
+
+  extension_set = testing_extension_set_new (engine, NULL);
+
+  bean_extension_set_foreach (extension_set,
+                              (BeanExtensionSetForeachFunc) n_activate_calls_cb,
+                              &n_calls);
+
+  /* Every extension is called once per call of the set */
+  for (n_calls = 1; n_calls <= 2; ++n_calls)
+    {
+      g_assert (bean_extension_set_call (extension_set, "activate", NULL));
+      bean_extension_set_foreach (extension_set,
+                                  (BeanExtensionSetForeachFunc) n_activate_calls_cb,
+                                  &n_calls);
+    }
+
+  g_object_unref (extension_set);
+}
+
 static void
 test_extension_set_call_invalid (BeanEngine *engine)
 {
@@ -454,6 +489,7 @@ main (int    argc,
 
   TEST ("call-valid", call_valid);
   TEST ("call-invalid", call_invalid);
+  TEST ("call-each", call_each);
 
   TEST ("foreach", foreach);
 
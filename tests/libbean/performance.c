@@ -0,0 +1,813 @@
+/*
+ * performance.c
+ * This file is part of libbean
+ *
+ * Copyright (C) 2026 - libbean contributors
+ *
+ * libbean is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libbean is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.
+ */
+
+/* These are only run when -m perf is passed, for instance:
+ *   meson test test-performance --test-args '-m perf'
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#ifdef HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libbean/bean.h>
+
+#include "libbean/bean-plugin-parser.h"
+
+#include "testing/testing.h"
+
+#include "introspection-callable.h"
+
+#define N_PLUGINS 10000
+#define N_PARSES 20000
+#define N_MIXED_PLUGINS 2000
+#define N_DIFF_PLUGINS 5000
+#define N_DIFF_REQUESTED 2000
+#define N_PREFETCH_PLUGINS 200
+#define PREFETCH_MODULE_SIZE (512 * 1024)
+#define N_CALLS 200000
+#define N_CREATES 1000000
+
+/* Like the plugin files which are installed by applications */
+static const gchar real_plugin_file[] =
+  "[Plugin]\n"
+  "Loader=python3\n"
+  "Module=quickhighlight\n"
+  "IAge=3\n"
+  "Name=Quick Highlight\n"
+  "Name[de]=Schnelle Hervorhebung\n"
+  "Name[es]=Resaltado rápido\n"
+  "Name[fr]=Surlignage rapide\n"
+  "Name[ja]=クイックハイライト\n"
+  "Name[pt_BR]=Destaque rápido\n"
+  "Description=Highlights every occurrence of the selected text.\n"
+  "Description[de]=Hebt alle Vorkommen des ausgewählten Textes hervor.\n"
+  "Description[es]=Resalta todas las apariciones del texto seleccionado.\n"
+  "Description[fr]=Surligne toutes les occurrences du texte sélectionné.\n"
+  "Description[ja]=選択したテキストのすべての出現箇所を強調表示します。\n"
+  "Description[pt_BR]=Destaca todas as ocorrências do texto selecionado.\n"
+  "# Not translated\n"
+  "Icon=edit-find-symbolic\n"
+  "Authors=Libbean Authors <libbean-list@gnome.org>;Someone Else\n"
+  "Copyright=Copyright © 2026 Libbean Authors\n"
+  "Website=https://wiki.gnome.org/Projects/Libbean\n"
+  "Version=3.38.0\n"
+  "Builtin=true\n";
+
+static gchar *
+plugin_name (guint i)
+{
+  return g_strdup_printf ("perf-%05u", i);
+}
+
+/* The plugin depends on the previous n_deps plugins */
+static GString *
+plugin_contents (guint i,
+                 guint n_deps)
+{
+  GString *contents;
+  guint j;
+
+  contents = g_string_new ("[Plugin]\n");
+  g_string_append_printf (contents, "Module=perf-%05u\n", i);
+  g_string_append_printf (contents, "Name=Performance %u\n", i);
+  g_string_append (contents, "Description=Used to measure libbean\n");
+  g_string_append (contents, "Authors=Libbean Authors\n");
+  g_string_append (contents, "Copyright=Copyright © 2026 Libbean Authors\n");
+  g_string_append (contents, "Website=https://wiki.gnome.org/Projects/Libbean\n");
+  g_string_append (contents, "X-Category=performance\n");
+
+  /* Lets lazy-load defer them, as they have no module */
+  g_string_append (contents, "X-Provides=BeanActivatable;\n");
+
+  g_string_append (contents, "Depends=");
+  for (j = i > n_deps ? i - n_deps : 0; j < i; ++j)
+    g_string_append_printf (contents, "perf-%05u;", j);
+  g_string_append (contents, "\n");
+
+  return contents;
+}
+
+static gchar *
+create_plugin_dir (guint n_plugins,
+                   guint n_deps)
+{
+  gchar *plugin_dir;
+  guint i;
+  GError *error = NULL;
+
+  plugin_dir = g_dir_make_tmp ("libbean-performance-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  for (i = 0; i < n_plugins; ++i)
+    {
+      GString *contents;
+      gchar *module_name, *basename, *filename;
+
+      module_name = plugin_name (i);
+      contents = plugin_contents (i, n_deps);
+
+      basename = g_strconcat (module_name, ".plugin", NULL);
+      filename = g_build_filename (plugin_dir, basename, NULL);
+
+      g_file_set_contents (filename, contents->str, contents->len, &error);
+      g_assert_no_error (error);
+
+      g_free (filename);
+      g_free (basename);
+      g_free (module_name);
+      g_string_free (contents, TRUE);
+    }
+
+  return plugin_dir;
+}
+
+/* Like an application's plugin directory, where the plugin
+ * files are next to their modules and data files
+ */
+static void
+add_other_files (const gchar *plugin_dir,
+                 guint        n_plugins)
+{
+  static const gchar * const suffixes[] = { ".so", ".py", ".ui", ".gresource" };
+  guint i, j;
+  GError *error = NULL;
+
+  for (i = 0; i < n_plugins; ++i)
+    {
+      for (j = 0; j < G_N_ELEMENTS (suffixes); ++j)
+        {
+          gchar *basename, *filename;
+
+          basename = g_strdup_printf ("perf-%05u%s", i, suffixes[j]);
+          filename = g_build_filename (plugin_dir, basename, NULL);
+
+          g_file_set_contents (filename, "", 0, &error);
+          g_assert_no_error (error);
+
+          g_free (filename);
+          g_free (basename);
+        }
+    }
+}
+
+static void
+remove_plugin_dir (gchar *plugin_dir)
+{
+  GDir *dir;
+  const gchar *name;
+
+  dir = g_dir_open (plugin_dir, 0, NULL);
+  g_assert (dir != NULL);
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *filename = g_build_filename (plugin_dir, name, NULL);
+
+      g_assert_cmpint (g_remove (filename), ==, 0);
+      g_free (filename);
+    }
+
+  g_dir_close (dir);
+  g_assert_cmpint (g_rmdir (plugin_dir), ==, 0);
+  g_free (plugin_dir);
+}
+
+static gboolean
+skip_unless_perf (void)
+{
+  if (g_test_perf ())
+    return FALSE;
+
+  g_test_skip ("Performance tests are only run with -m perf");
+  return TRUE;
+}
+
+static void
+test_performance_scan (void)
+{
+  BeanEngine *engine;
+  gchar *plugin_dir;
+  gdouble elapsed;
+  guint i;
+
+  if (skip_unless_perf ())
+    return;
+
+  plugin_dir = create_plugin_dir (N_PLUGINS, 2);
+
+  engine = bean_engine_new ();
+
+  g_test_timer_start ();
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpuint (g_list_length ((GList *) bean_engine_get_plugin_list (engine)),
+                    ==, N_PLUGINS);
+  g_test_minimized_result (elapsed, "Scanned %u plugins in %.3f seconds",
+                           N_PLUGINS, elapsed);
+
+  /* This is what loading does for every dependency */
+  g_test_timer_start ();
+
+  for (i = 0; i < N_PLUGINS; ++i)
+    {
+      gchar *module_name = plugin_name (i);
+
+      g_assert (bean_engine_get_plugin_info (engine, module_name) != NULL);
+      g_free (module_name);
+    }
+
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed, "Looked up %u plugins in %.3f seconds",
+                           N_PLUGINS, elapsed);
+
+  g_object_unref (engine);
+  remove_plugin_dir (plugin_dir);
+}
+
+static void
+test_performance_load_dependencies (void)
+{
+  BeanEngine *engine;
+  gchar *plugin_dir;
+  gchar **plugin_names;
+  gchar *last_name;
+  gdouble elapsed;
+  guint i;
+
+  if (skip_unless_perf ())
+    return;
+
+  plugin_dir = create_plugin_dir (N_PLUGINS, 2);
+
+  /* The plugins are deferred, so this measures resolving
+   * and loading their dependencies, not their loader
+   */
+  engine = bean_engine_new ();
+  g_object_set (engine, "lazy-load", TRUE, NULL);
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+
+  plugin_names = g_new0 (gchar *, N_PLUGINS + 1);
+  for (i = 0; i < N_PLUGINS; ++i)
+    plugin_names[i] = plugin_name (i);
+
+  g_test_timer_start ();
+  bean_engine_set_loaded_plugins (engine, (const gchar **) plugin_names);
+  elapsed = g_test_timer_elapsed ();
+
+  last_name = plugin_name (N_PLUGINS - 1);
+  g_assert (bean_plugin_info_is_loaded (bean_engine_get_plugin_info (engine,
+                                                                     last_name)));
+  g_test_minimized_result (elapsed,
+                           "Loaded %u plugins with their dependencies "
+                           "in %.3f seconds", N_PLUGINS, elapsed);
+
+  /* Each plugin's dependants are unloaded first */
+  g_test_timer_start ();
+  bean_engine_set_loaded_plugins (engine, NULL);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert (!bean_plugin_info_is_loaded (bean_engine_get_plugin_info (engine,
+                                                                      last_name)));
+  g_test_minimized_result (elapsed,
+                           "Unloaded %u plugins with their dependants "
+                           "in %.3f seconds", N_PLUGINS, elapsed);
+
+  g_free (last_name);
+  g_strfreev (plugin_names);
+  g_object_unref (engine);
+  remove_plugin_dir (plugin_dir);
+}
+
+static void
+test_performance_scan_mixed (void)
+{
+  BeanEngine *engine;
+  gchar *plugin_dir;
+  gdouble elapsed;
+  guint i;
+
+  if (skip_unless_perf ())
+    return;
+
+  plugin_dir = create_plugin_dir (N_MIXED_PLUGINS, 0);
+  add_other_files (plugin_dir, N_MIXED_PLUGINS);
+
+  engine = bean_engine_new ();
+
+  g_test_timer_start ();
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpuint (g_list_length ((GList *) bean_engine_get_plugin_list (engine)),
+                    ==, N_MIXED_PLUGINS);
+  g_test_minimized_result (elapsed,
+                           "Scanned %u plugins among %u files in %.3f seconds",
+                           N_MIXED_PLUGINS, N_MIXED_PLUGINS * 5, elapsed);
+
+  /* Nothing changed, so this is only the directory walk */
+  g_test_timer_start ();
+
+  for (i = 0; i < 10; ++i)
+    bean_engine_rescan_plugins (engine);
+
+  elapsed = g_test_timer_elapsed () / 10;
+  g_test_minimized_result (elapsed,
+                           "Rescanned %u files in %.3f seconds",
+                           N_MIXED_PLUGINS * 5, elapsed);
+
+  g_object_unref (engine);
+  remove_plugin_dir (plugin_dir);
+}
+
+static void
+stop_emission_cb (BeanEngine     *engine,
+                  BeanPluginInfo *info G_GNUC_UNUSED,
+                  guint          *n_emissions)
+{
+  ++(*n_emissions);
+  g_signal_stop_emission_by_name (engine, "load-plugin");
+}
+
+static void
+test_performance_set_loaded_plugins (void)
+{
+  BeanEngine *engine;
+  gchar *plugin_dir;
+  gchar **plugin_names;
+  gdouble elapsed;
+  guint n_emissions = 0;
+  guint i;
+
+  if (skip_unless_perf ())
+    return;
+
+  plugin_dir = create_plugin_dir (N_DIFF_PLUGINS, 2);
+
+  engine = bean_engine_new ();
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+
+  /* Every other plugin from the end, the load-plugin
+   * emissions are stopped so that only the diff is measured
+   */
+  plugin_names = g_new0 (gchar *, N_DIFF_REQUESTED + 1);
+  for (i = 0; i < N_DIFF_REQUESTED; ++i)
+    plugin_names[i] = plugin_name (N_DIFF_PLUGINS - 1 - i * 2);
+
+  g_signal_connect (engine, "load-plugin",
+                    G_CALLBACK (stop_emission_cb), &n_emissions);
+
+  /* Sorts the plugins */
+  bean_engine_set_loaded_plugins (engine, NULL);
+
+  g_test_timer_start ();
+
+  for (i = 0; i < 10; ++i)
+    bean_engine_set_loaded_plugins (engine, (const gchar **) plugin_names);
+
+  elapsed = g_test_timer_elapsed () / 10;
+
+  g_assert_cmpuint (n_emissions, ==, N_DIFF_REQUESTED * 10);
+  g_test_minimized_result (elapsed,
+                           "Set %u of %u plugins as loaded in %.3f seconds",
+                           N_DIFF_REQUESTED, N_DIFF_PLUGINS, elapsed);
+
+  g_strfreev (plugin_names);
+  g_object_unref (engine);
+  remove_plugin_dir (plugin_dir);
+}
+
+#ifdef HAVE_POSIX_FADVISE
+/* Drops the file from the page cache, as if it was never read */
+static void
+evict_file (const gchar *filename)
+{
+  gint fd;
+
+  fd = g_open (filename, O_RDONLY, 0);
+  g_assert_cmpint (fd, >=, 0);
+
+  /* Only clean pages are dropped */
+  fsync (fd);
+  posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+  close (fd);
+}
+
+/* Loads the plugins like the C loader would if the modules were real,
+ * the sleep stands for the module registering its types
+ */
+static gdouble
+measure_load (const gchar  *plugin_dir,
+              gchar       **plugin_names,
+              gchar       **module_paths,
+              gboolean      prefetch)
+{
+  BeanEngine *engine;
+  gdouble elapsed;
+  guint n_emissions = 0;
+  guint i;
+
+  engine = bean_engine_new ();
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+  g_object_set (engine, "prefetch-modules", prefetch, NULL);
+
+  g_signal_connect (engine, "load-plugin",
+                    G_CALLBACK (stop_emission_cb), &n_emissions);
+
+  for (i = 0; module_paths[i] != NULL; ++i)
+    evict_file (module_paths[i]);
+
+  g_test_timer_start ();
+
+  bean_engine_set_loaded_plugins (engine, (const gchar **) plugin_names);
+
+  for (i = 0; module_paths[i] != NULL; ++i)
+    {
+      gchar *contents;
+      gsize length;
+      GError *error = NULL;
+
+      g_file_get_contents (module_paths[i], &contents, &length, &error);
+      g_assert_no_error (error);
+      g_free (contents);
+
+      g_usleep (G_USEC_PER_SEC / 1000);
+    }
+
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpuint (n_emissions, ==, N_PREFETCH_PLUGINS);
+  g_object_unref (engine);
+
+  return elapsed;
+}
+#endif
+
+static void
+test_performance_prefetch_modules (void)
+{
+#ifdef HAVE_POSIX_FADVISE
+  gchar *plugin_dir;
+  gchar **plugin_names, **module_paths;
+  gchar *contents;
+  gdouble elapsed, prefetch_elapsed;
+  guint i;
+  GError *error = NULL;
+
+  if (skip_unless_perf ())
+    return;
+
+  plugin_dir = create_plugin_dir (N_PREFETCH_PLUGINS, 0);
+
+  plugin_names = g_new0 (gchar *, N_PREFETCH_PLUGINS + 1);
+  module_paths = g_new0 (gchar *, N_PREFETCH_PLUGINS + 1);
+  contents = g_malloc0 (PREFETCH_MODULE_SIZE);
+
+  /* In the order they are loaded */
+  for (i = 0; i < N_PREFETCH_PLUGINS; ++i)
+    {
+      plugin_names[i] = plugin_name (i);
+      module_paths[i] = g_module_build_path (plugin_dir, plugin_names[i]);
+
+      g_file_set_contents (module_paths[i], contents,
+                           PREFETCH_MODULE_SIZE, &error);
+      g_assert_no_error (error);
+    }
+
+  elapsed = measure_load (plugin_dir, plugin_names, module_paths, FALSE);
+  g_test_minimized_result (elapsed,
+                           "Loaded %u uncached modules in %.3f seconds",
+                           N_PREFETCH_PLUGINS, elapsed);
+
+  prefetch_elapsed = measure_load (plugin_dir, plugin_names,
+                                   module_paths, TRUE);
+  g_test_minimized_result (prefetch_elapsed,
+                           "Loaded %u uncached prefetched modules "
+                           "in %.3f seconds (%.1fx faster)",
+                           N_PREFETCH_PLUGINS, prefetch_elapsed,
+                           elapsed / MAX (prefetch_elapsed, 1e-9));
+
+  g_free (contents);
+  g_strfreev (module_paths);
+  g_strfreev (plugin_names);
+  remove_plugin_dir (plugin_dir);
+#else
+  g_test_skip ("Files cannot be dropped from the page cache");
+#endif
+}
+
+/* Reads the same keys as _bean_plugin_info_new() */
+static void
+parse_plugin_file (GBytes                *bytes,
+                   BeanPluginParserFlags  flags)
+{
+  BeanPluginParser *parser;
+  gchar **keys;
+  guint i;
+  GError *error = NULL;
+
+  parser = bean_plugin_parser_new (bytes, flags, &error);
+  g_assert_no_error (error);
+
+  g_free (bean_plugin_parser_get_string (parser, "Module"));
+  g_free (bean_plugin_parser_get_locale_string (parser, "Name"));
+  g_free (bean_plugin_parser_get_string (parser, "Loader"));
+  g_free (bean_plugin_parser_get_string (parser, "Embedded"));
+  g_strfreev (bean_plugin_parser_get_string_list (parser, "Depends"));
+  g_free (bean_plugin_parser_get_locale_string (parser, "Description"));
+  g_free (bean_plugin_parser_get_locale_string (parser, "Icon"));
+  g_strfreev (bean_plugin_parser_get_string_list (parser, "Authors"));
+  g_strfreev (bean_plugin_parser_get_string_list (parser, "Copyright"));
+  g_free (bean_plugin_parser_get_string (parser, "Website"));
+  g_free (bean_plugin_parser_get_string (parser, "Version"));
+  g_free (bean_plugin_parser_get_string (parser, "Help"));
+  bean_plugin_parser_get_boolean (parser, "Builtin");
+  bean_plugin_parser_get_boolean (parser, "Hidden");
+
+  keys = bean_plugin_parser_get_keys (parser);
+  for (i = 0; keys[i] != NULL; ++i)
+    {
+      if (g_str_has_prefix (keys[i], "X-"))
+        g_free (bean_plugin_parser_get_string (parser, keys[i]));
+    }
+
+  g_strfreev (keys);
+  bean_plugin_parser_free (parser);
+}
+
+static void
+measure_parsers (const gchar *kind,
+                 GBytes      *bytes)
+{
+  BeanPluginParser *parser;
+  gdouble key_file_elapsed, elapsed;
+  guint i;
+
+  /* Otherwise this would measure GKeyFile twice */
+  parser = bean_plugin_parser_new (bytes, BEAN_PLUGIN_PARSER_NONE, NULL);
+  g_assert (!bean_plugin_parser_uses_key_file (parser));
+  bean_plugin_parser_free (parser);
+
+  g_test_timer_start ();
+
+  for (i = 0; i < N_PARSES; ++i)
+    parse_plugin_file (bytes, BEAN_PLUGIN_PARSER_USE_KEY_FILE);
+
+  key_file_elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (key_file_elapsed,
+                           "Parsed %u %s plugin files with GKeyFile "
+                           "in %.3f seconds",
+                           N_PARSES, kind, key_file_elapsed);
+
+  g_test_timer_start ();
+
+  for (i = 0; i < N_PARSES; ++i)
+    parse_plugin_file (bytes, BEAN_PLUGIN_PARSER_NONE);
+
+  elapsed = g_test_timer_elapsed ();
+  g_test_minimized_result (elapsed,
+                           "Parsed %u %s plugin files in %.3f seconds "
+                           "(%.1fx faster)",
+                           N_PARSES, kind, elapsed,
+                           key_file_elapsed / MAX (elapsed, 1e-9));
+}
+
+static void
+test_performance_parse (void)
+{
+  GBytes *bytes;
+  GString *contents;
+
+  if (skip_unless_perf ())
+    return;
+
+  bytes = g_bytes_new_static (real_plugin_file, strlen (real_plugin_file));
+  measure_parsers ("real", bytes);
+  g_bytes_unref (bytes);
+
+  contents = plugin_contents (N_PLUGINS, 5);
+  bytes = g_string_free_to_bytes (contents);
+  measure_parsers ("synthetic", bytes);
+  g_bytes_unref (bytes);
+}
+
+static void
+test_performance_extension_call (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  BeanExtension *extension;
+  gchar *return_val = NULL;
+  gdouble elapsed;
+  guint i;
+
+  if (skip_unless_perf ())
+    return;
+
+  engine = testing_engine_new ();
+  info = bean_engine_get_plugin_info (engine, "extension-c");
+  g_assert (bean_engine_load_plugin (engine, info));
+
+  extension = bean_engine_create_extension (engine, info,
+                                            INTROSPECTION_TYPE_CALLABLE,
+                                            NULL);
+
+  /* Resolves the methods */
+  g_assert (bean_extension_call (extension, "call_no_args"));
+  g_assert (bean_extension_call (extension, "call_with_return", &return_val));
+  g_free (return_val);
+
+  g_test_timer_start ();
+
+  for (i = 0; i < N_CALLS; ++i)
+    {
+      bean_extension_call (extension, "call_with_return", &return_val);
+      g_free (return_val);
+    }
+
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed,
+                           "Called an extension method %u times "
+                           "in %.3f seconds", N_CALLS, elapsed);
+
+  g_object_unref (extension);
+  testing_engine_free (engine);
+}
+
+static GObject *
+create_object_factory (guint         n_properties G_GNUC_UNUSED,
+                       const gchar **prop_names G_GNUC_UNUSED,
+                       GValue       *prop_values G_GNUC_UNUSED,
+                       gpointer      user_data)
+{
+  /* Only the lookup of the factory is measured */
+  return g_object_ref (user_data);
+}
+
+static GType
+extension_type (guint i)
+{
+  static const GTypeInfo info = { sizeof (GTypeInterface) };
+  gchar *type_name;
+  GType type;
+
+  type_name = g_strdup_printf ("PerfExtension%u", i);
+  type = g_type_from_name (type_name);
+
+  if (type == G_TYPE_INVALID)
+    type = g_type_register_static (G_TYPE_INTERFACE, type_name, &info, 0);
+
+  g_free (type_name);
+  return type;
+}
+
+static void
+measure_create_object (guint n_types)
+{
+  BeanObjectModule *module;
+  GObject *object;
+  GType last_type = G_TYPE_INVALID;
+  gdouble elapsed;
+  guint i;
+
+  module = bean_object_module_new_embedded ("perf-module",
+                                            "perf_register_types");
+  object = g_object_new (G_TYPE_OBJECT, NULL);
+
+  for (i = 0; i < n_types; ++i)
+    {
+      last_type = extension_type (i);
+      bean_object_module_register_extension_factory (module, last_type,
+                                                     create_object_factory,
+                                                     object, NULL);
+    }
+
+  g_test_timer_start ();
+
+  /* The last one registered is the slowest to scan for */
+  for (i = 0; i < N_CREATES; ++i)
+    g_object_unref (bean_object_module_create_object (module, last_type,
+                                                      0, NULL, NULL));
+
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed,
+                           "Created %u objects from a module with "
+                           "%u extension types in %.3f seconds",
+                           N_CREATES, n_types, elapsed);
+
+  g_object_unref (object);
+  g_object_unref (module);
+}
+
+static void
+test_performance_create_object (void)
+{
+  if (skip_unless_perf ())
+    return;
+
+  measure_create_object (1);
+  measure_create_object (10);
+  measure_create_object (100);
+}
+
+static void
+test_performance_extension_factory (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  BeanExtensionFactory *factory;
+  gdouble elapsed, factory_elapsed;
+  guint i;
+
+  if (skip_unless_perf ())
+    return;
+
+  engine = testing_engine_new ();
+  info = bean_engine_get_plugin_info (engine, "extension-c");
+  g_assert (bean_engine_load_plugin (engine, info));
+
+  g_test_timer_start ();
+
+  for (i = 0; i < N_CALLS; ++i)
+    {
+      g_object_unref (bean_engine_create_extension (engine, info,
+                                                    INTROSPECTION_TYPE_CALLABLE,
+                                                    NULL));
+    }
+
+  elapsed = g_test_timer_elapsed ();
+
+  factory = bean_engine_create_extension_factory (engine, info,
+                                                  INTROSPECTION_TYPE_CALLABLE);
+  g_assert (factory != NULL);
+
+  g_test_timer_start ();
+
+  for (i = 0; i < N_CALLS; ++i)
+    g_object_unref (bean_extension_factory_create (factory, 0, NULL, NULL));
+
+  factory_elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed,
+                           "Created %u extensions from the engine "
+                           "in %.3f seconds", N_CALLS, elapsed);
+  g_test_minimized_result (factory_elapsed,
+                           "Created %u extensions from a factory "
+                           "in %.3f seconds", N_CALLS, factory_elapsed);
+
+  bean_extension_factory_unref (factory);
+  testing_engine_free (engine);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  testing_init (&argc, &argv);
+
+#define TEST_FUNC(path, ftest) \
+  g_test_add_func ("/performance/" path, test_performance_##ftest)
+
+  TEST_FUNC ("scan", scan);
+  TEST_FUNC ("load-dependencies", load_dependencies);
+  TEST_FUNC ("scan-mixed", scan_mixed);
+  TEST_FUNC ("set-loaded-plugins", set_loaded_plugins);
+  TEST_FUNC ("prefetch-modules", prefetch_modules);
+  TEST_FUNC ("parse", parse);
+  TEST_FUNC ("extension-call", extension_call);
+  TEST_FUNC ("create-object", create_object);
+  TEST_FUNC ("extension-factory", extension_factory);
+
+#undef TEST_FUNC
+
+  return testing_run_tests ();
+}
@@ -24,10 +24,15 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <libbean/bean.h>
 
+#include "libbean/bean-plugin-info-priv.h"
+#include "libbean/bean-plugin-parser.h"
+
 #include "testing/testing.h"
 
 typedef struct _TestFixture TestFixture;
@@ -176,6 +181,221 @@ test_plugin_info_os_dependant_help (BeanEngine *engine)
 #endif
 }
 
+static void
+test_plugin_info_lazy_details (BeanEngine *engine)
+{
+  BeanPluginInfo *info;
+
+  info = bean_engine_get_plugin_info (engine, "min-info");
+
+  /* Finding and sorting the plugins does not need the details */
+  g_assert (bean_engine_get_plugin_list (engine) != NULL);
+  g_assert (info->details == NULL);
+
+  g_assert_cmpstr (bean_plugin_info_get_name (info), ==, "Min Info");
+  g_assert (info->details != NULL);
+}
+
+static void
+test_plugin_info_changed_details (BeanEngine *engine)
+{
+  BeanPluginInfo *info;
+  gchar *plugin_dir, *filename;
+  GError *error = NULL;
+
+  plugin_dir = g_dir_make_tmp ("libbean-plugin-info-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  filename = g_build_filename (plugin_dir, "changed.plugin", NULL);
+  g_file_set_contents (filename,
+                       "[Plugin]\n"
+                       "Module=changed\n"
+                       "Name=Changed\n"
+                       "Description=Before the change\n", -1, &error);
+  g_assert_no_error (error);
+
+  bean_engine_add_search_path (engine, plugin_dir, NULL);
+  info = bean_engine_get_plugin_info (engine, "changed");
+  g_assert (info != NULL);
+
+  /* Now describes another plugin, which is only found by a rescan */
+  g_file_set_contents (filename,
+                       "[Plugin]\n"
+                       "Module=other\n"
+                       "Depends=changed\n"
+                       "Name=Other\n"
+                       "Description=After the change\n", -1, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpstr (bean_plugin_info_get_module_name (info), ==, "changed");
+  g_assert_cmpstr (bean_plugin_info_get_name (info), ==, "changed");
+  g_assert_cmpstr (bean_plugin_info_get_description (info), ==, NULL);
+  g_assert_cmpint (g_strv_length ((gchar **) bean_plugin_info_get_dependencies (info)),
+                   ==, 0);
+
+  g_assert_cmpint (g_remove (filename), ==, 0);
+  g_assert_cmpint (g_rmdir (plugin_dir), ==, 0);
+
+  g_free (filename);
+  g_free (plugin_dir);
+}
+
+static void
+test_plugin_info_shared_strings (void)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info1, *info2;
+
+  engine = testing_engine_new ();
+  info1 = bean_engine_get_plugin_info (engine, "min-info");
+  info2 = bean_engine_get_plugin_info (engine, "full-info");
+
+  /* Strings which are the same are only stored once */
+  g_assert (bean_plugin_info_get_module_dir (info1) ==
+            bean_plugin_info_get_module_dir (info2));
+
+  /* And they outlive the engine */
+  _bean_plugin_info_ref (info1);
+  testing_engine_free (engine);
+
+  g_assert (g_str_has_suffix (bean_plugin_info_get_module_dir (info1),
+                              "/tests/plugins"));
+  g_assert_cmpstr (bean_plugin_info_get_name (info1), ==, "Min Info");
+
+  _bean_plugin_info_unref (info1);
+}
+
+static void
+assert_strv_equal (gchar **a,
+                   gchar **b)
+{
+  if (a == NULL || b == NULL)
+    g_assert (a == b);
+  else
+    g_assert (g_strv_equal ((const gchar * const *) a,
+                            (const gchar * const *) b));
+
+  g_strfreev (a);
+  g_strfreev (b);
+}
+
+static void
+test_plugin_info_parser (void)
+{
+  guint i, j;
+  const gchar *keys[] = {
+    "Module", "Name", "Depends", "Builtin", "Hidden", "X-External", "Missing"
+  };
+  const struct {
+    const gchar *contents;
+    gboolean uses_key_file;
+  } files[] = {
+    { "[Plugin]\n"
+      "Module=full-info\n"
+      "Depends=something;something-else\n"
+      "Builtin=true\n"
+      "Name=Full Info\n"
+      "X-External=external data\n", FALSE },
+    { "# Comment\n"
+      "[Other Group]\n"
+      "Module=other\n"
+      "[Plugin]  \r\n"
+      "  Module = spaces  \r\n"
+      "Name=Untranslated\r\n"
+      "Name[de]=Übersetzt\r\n"
+      "Name[C]=C Locale\r\n"
+      "Depends=first;;second;\r\n"
+      "Hidden=1\r\n"
+      "Builtin=false\r\n"
+      "X-External=", FALSE },
+    { "[Plugin]\n"
+      "Module=escapes\n"
+      "Name=Line\\nBreak\n"
+      "Depends=semi\\;colon;other\n", TRUE },
+    { "[Plugin]\n"
+      "Module=merged\n"
+      "[Plugin]\n"
+      "Name=Merged\n", TRUE },
+    { "[Plugin]\n"
+      "Module=duplicate\n"
+      "Module=duplicate-again\n", TRUE },
+    { "[Plugin]\n"
+      "Module=unicode-locale\n"
+      "Name[ünicode]=Unicode\n", TRUE },
+  };
+
+  for (i = 0; i < G_N_ELEMENTS (files); ++i)
+    {
+      GBytes *bytes;
+      BeanPluginParser *fast, *key_file;
+      GError *error = NULL;
+
+      bytes = g_bytes_new_static (files[i].contents,
+                                  strlen (files[i].contents));
+
+      fast = bean_plugin_parser_new (bytes, BEAN_PLUGIN_PARSER_NONE, &error);
+      g_assert_no_error (error);
+      key_file = bean_plugin_parser_new (bytes,
+                                         BEAN_PLUGIN_PARSER_USE_KEY_FILE,
+                                         &error);
+      g_assert_no_error (error);
+
+      g_assert_cmpint (bean_plugin_parser_uses_key_file (fast),
+                       ==, files[i].uses_key_file);
+      g_assert (bean_plugin_parser_uses_key_file (key_file));
+
+      for (j = 0; j < G_N_ELEMENTS (keys); ++j)
+        {
+          gchar *a, *b;
+
+          a = bean_plugin_parser_get_string (fast, keys[j]);
+          b = bean_plugin_parser_get_string (key_file, keys[j]);
+          g_assert_cmpstr (a, ==, b);
+          g_free (a);
+          g_free (b);
+
+          a = bean_plugin_parser_get_locale_string (fast, keys[j]);
+          b = bean_plugin_parser_get_locale_string (key_file, keys[j]);
+          g_assert_cmpstr (a, ==, b);
+          g_free (a);
+          g_free (b);
+
+          assert_strv_equal (bean_plugin_parser_get_string_list (fast,
+                                                                 keys[j]),
+                             bean_plugin_parser_get_string_list (key_file,
+                                                                 keys[j]));
+
+          g_assert_cmpint (bean_plugin_parser_get_boolean (fast, keys[j]),
+                           ==,
+                           bean_plugin_parser_get_boolean (key_file, keys[j]));
+        }
+
+      assert_strv_equal (bean_plugin_parser_get_keys (fast),
+                         bean_plugin_parser_get_keys (key_file));
+
+      bean_plugin_parser_free (key_file);
+      bean_plugin_parser_free (fast);
+      g_bytes_unref (bytes);
+    }
+}
+
+static void
+test_plugin_info_parser_invalid (void)
+{
+  GBytes *bytes;
+  BeanPluginParser *parser;
+  GError *error = NULL;
+
+  bytes = g_bytes_new_static ("This is not a GKeyFile.\n", 24);
+
+  parser = bean_plugin_parser_new (bytes, BEAN_PLUGIN_PARSER_NONE, &error);
+  g_assert (parser == NULL);
+  g_assert_error (error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_PARSE);
+
+  g_error_free (error);
+  g_bytes_unref (bytes);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -197,7 +417,19 @@ main (int    argc,
 
   TEST ("os-dependant-help", os_dependant_help);
 
+  TEST ("lazy-details", lazy_details);
+  TEST ("changed-details", changed_details);
+
 #undef TEST
 
+#define TEST_FUNC(path, ftest) \
+  g_test_add_func ("/plugin-info/" path, test_plugin_info_##ftest)
+
+  TEST_FUNC ("parser", parser);
+  TEST_FUNC ("parser-invalid", parser_invalid);
+  TEST_FUNC ("shared-strings", shared_strings);
+
+#undef TEST_FUNC
+
   return testing_run_tests ();
 }
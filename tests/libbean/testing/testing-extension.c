@@ -397,6 +397,50 @@ test_extension_abstract (BeanEngine     *engine,
   g_object_unref (extension);
 }
 
+static void
+test_extension_factory (BeanEngine     *engine,
+                        BeanPluginInfo *info)
+{
+  gint i;
+  BeanExtensionFactory *factory;
+  BeanExtension *extension;
+  IntrospectionAbstract *abstract;
+  const gchar *prop_names[] = { "abstract-property" };
+  GValue prop_values[1] = { G_VALUE_INIT };
+
+  g_assert (bean_engine_load_plugin (engine, info));
+
+  /* Not provided, without warning about it */
+  factory = bean_engine_create_extension_factory (engine, info,
+                                                  INTROSPECTION_TYPE_UNIMPLEMENTED);
+  g_assert (factory == NULL);
+
+  factory = bean_engine_create_extension_factory (engine, info,
+                                                  INTROSPECTION_TYPE_ABSTRACT);
+  g_assert (factory != NULL);
+
+  g_value_init (&prop_values[0], G_TYPE_INT);
+
+  /* The second instance must not be affected by the first one */
+  for (i = 0; i < 2; ++i)
+    {
+      g_value_set_int (&prop_values[0], 47 + i);
+
+      extension = bean_extension_factory_create (factory, 1,
+                                                 prop_names, prop_values);
+
+      g_assert (INTROSPECTION_IS_ABSTRACT (extension));
+
+      abstract = INTROSPECTION_ABSTRACT (extension);
+      g_assert_cmpint (introspection_abstract_get_value (abstract), ==, 47 + i);
+
+      g_object_unref (extension);
+    }
+
+  g_value_unset (&prop_values[0]);
+  bean_extension_factory_unref (factory);
+}
+
 static gint
 run_in_multiple_threads (GFunc    func,
                          gpointer user_data)
@@ -474,6 +518,46 @@ test_extension_multiple_threads_nonglobal_loaders (BeanEngine     *engine G_GNUC
                            GINT_TO_POINTER (TRUE));
 }
 
+static void
+preinit_loaders_in_thread (guint    nth_thread G_GNUC_UNUSED,
+                           gpointer user_data G_GNUC_UNUSED)
+{
+  BeanEngine *engine;
+  BeanPluginInfo *info;
+  GObject *extension;
+
+  /* The loader is handed over while the plugin is being loaded */
+  engine = testing_engine_new_full (TRUE);
+  g_object_set (engine, "preinit-loaders", TRUE, NULL);
+  bean_engine_enable_loader (engine, loader);
+
+  info = bean_engine_get_plugin_info (engine, extension_plugin);
+  g_assert (info != NULL);
+  g_assert (bean_engine_load_plugin (engine, info));
+
+  extension = bean_engine_create_extension (engine, info,
+                                            INTROSPECTION_TYPE_BASE,
+                                            NULL);
+
+  g_assert (extension != NULL);
+  g_object_unref (extension);
+
+  testing_engine_free (engine);
+
+  /* Disposing waits for the initialization */
+  engine = testing_engine_new_full (TRUE);
+  g_object_set (engine, "preinit-loaders", TRUE, NULL);
+  bean_engine_enable_loader (engine, loader);
+  testing_engine_free (engine);
+}
+
+static void
+test_extension_preinit_loaders (BeanEngine     *engine G_GNUC_UNUSED,
+                                BeanPluginInfo *info G_GNUC_UNUSED)
+{
+  run_in_multiple_threads ((GFunc) preinit_loaders_in_thread, NULL);
+}
+
 static void
 multiple_threads_callbacks_in_thread (guint            nth_thread G_GNUC_UNUSED,
                                       BeanActivatable *activatable)
@@ -697,12 +781,15 @@ testing_extension_basic (const gchar *loader_)
   _EXTENSION_TEST (loader, "get-settings", get_settings);
 
   _EXTENSION_TEST (loader, "abstract", abstract);
+  _EXTENSION_TEST (loader, "factory", factory);
 
   _EXTENSION_TEST (loader, "multiple-threads/global-loaders",
                    multiple_threads_global_loaders);
   _EXTENSION_TEST (loader, "multiple-threads/nonglobal-loaders",
                    multiple_threads_nonglobal_loaders);
 
+  _EXTENSION_TEST (loader, "preinit-loaders", preinit_loaders);
+
   /* Not needed for C plugins as they are independent of libbean */
   if (g_strcmp0 (loader, "c") != 0)
     {
@@ -113,8 +113,14 @@ testing_loadable_plugin_init (TestingLoadablePlugin *plugin G_GNUC_UNUSED)
 }
 
 static void
-testing_loadable_plugin_activate (BeanActivatable *activatable G_GNUC_UNUSED)
+testing_loadable_plugin_activate (BeanActivatable *activatable)
 {
+  gint n_calls;
+
+  n_calls = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (activatable),
+                                                "testing-n-activate-calls"));
+  g_object_set_data (G_OBJECT (activatable), "testing-n-activate-calls",
+                     GINT_TO_POINTER (n_calls + 1));
 }
 
 static void